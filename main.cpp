@@ -1,11 +1,16 @@
 #include <iostream>
 #include <string>
 #include "src/head/lang/Processor.h"
+#include "src/head/lang/Benchmarks.h"
 #include <windows.h>
 #include <bitset>
 
-int main() {
-    ProcessorTests::runTests();
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        ProcessorBenchmarks::runBenchmarks();
+    } else {
+        ProcessorTests::runTests();
+    }
     std::cout << "Press ENTER to continue..." << std::endl;
     std::cin.get();
     
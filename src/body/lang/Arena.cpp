@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <new>
+#include "../../head/lang/Arena.h"
+
+namespace Nodes {
+    void* Arena::allocateSlow(std::size_t size, std::size_t alignment) {
+        // Oversized requests get a block of their own. It is linked for freeing but does not become the current
+        // block, so small nodes keep filling the rest of the regular block.
+        bool oversized = size + alignment > blockSize;
+        std::size_t payload = oversized ? size + alignment : blockSize;
+        char* memory = static_cast<char*>(std::malloc(sizeof(Block) + alignof(std::max_align_t) + payload));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        Block* block = reinterpret_cast<Block*>(memory);
+        block->next = blocks;
+        blocks = block;
+        reserved += payload;
+        char* start = memory + sizeof(Block) + alignof(std::max_align_t);
+        if (oversized) {
+            uintptr_t aligned = (reinterpret_cast<uintptr_t>(start) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+            used += aligned + size - reinterpret_cast<uintptr_t>(start);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        if (cursor) {
+            used += static_cast<std::size_t>(cursor - currentStart);
+        }
+        currentStart = start;
+        cursor = currentStart;
+        limit = currentStart + payload;
+        return allocate(size, alignment);
+    }
+
+    void Arena::reset() {
+        // Objects are destroyed newest first, the reverse of construction order.
+        for (Cleanup* cleanup = cleanups; cleanup; cleanup = cleanup->next) {
+            cleanup->run(cleanup->object);
+        }
+        cleanups = nullptr;
+        while (blocks) {
+            Block* next = blocks->next;
+            std::free(blocks);
+            blocks = next;
+        }
+        currentStart = cursor = limit = nullptr;
+        used = reserved = objects = 0;
+    }
+}
@@ -0,0 +1,178 @@
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include "../../head/lang/AstCache.h"
+#include "../../head/lang/Processor.h"
+#include "../../head/lang/SourceLoader.h"
+
+namespace AstCache {
+    namespace {
+        constexpr char magic[4] = {'H', 'Y', 'P', 'C'};
+
+        void appendText(std::string& out, std::string_view text) {
+            uint32_t length = static_cast<uint32_t>(text.size());
+            out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.append(text.data(), text.size());
+        }
+    }
+
+    void Writer::symbol(Symbols::SymbolId id) {
+        auto [it, added] = symbolIndex.emplace(id, static_cast<uint32_t>(symbols.size()));
+        if (added) {
+            symbols.push_back(id);
+        }
+        u32(it->second);
+    }
+    void Writer::string(std::string_view text) {
+        auto [it, added] = stringIndex.emplace(std::string(text), static_cast<uint32_t>(strings.size()));
+        if (added) {
+            strings.emplace_back(text);
+        }
+        u32(it->second);
+    }
+    std::string Writer::image(uint64_t sourceHash, uint64_t sourceSize) const {
+        Header header = {};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.grammar = grammarVersion;
+        header.sourceHash = sourceHash;
+        header.sourceSize = sourceSize;
+        header.symbolCount = static_cast<uint32_t>(symbols.size());
+        header.stringCount = static_cast<uint32_t>(strings.size());
+        header.nodeBytes = static_cast<uint32_t>(nodes.size());
+
+        std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (Symbols::SymbolId id : symbols) {
+            appendText(out, Symbols::name(id));
+        }
+        for (const std::string& text : strings) {
+            appendText(out, text);
+        }
+        out += nodes;
+        return out;
+    }
+
+    void Reader::raw(void* out, std::size_t size) {
+        if (static_cast<std::size_t>(end - cursor) < size) {
+            throw std::runtime_error("Truncated AST cache.");
+        }
+        std::memcpy(out, cursor, size);
+        cursor += size;
+    }
+    std::string_view Reader::text() {
+        uint32_t length = u32();
+        if (static_cast<std::size_t>(end - cursor) < length) {
+            throw std::runtime_error("Truncated AST cache.");
+        }
+        std::string_view view(cursor, length);
+        cursor += length;
+        return view;
+    }
+    void Reader::readPools(uint32_t symbolCount, uint32_t stringCount) {
+        symbols.reserve(symbolCount);
+        for (uint32_t i = 0; i < symbolCount; i++) {
+            symbols.push_back(Symbols::intern(text()));
+        }
+        strings.reserve(stringCount);
+        for (uint32_t i = 0; i < stringCount; i++) {
+            strings.push_back(text());
+        }
+    }
+    Symbols::SymbolId Reader::symbol() {
+        uint32_t index = u32();
+        if (index >= symbols.size()) {
+            throw std::runtime_error("Invalid symbol index in AST cache.");
+        }
+        return symbols[index];
+    }
+    std::string_view Reader::string() {
+        uint32_t index = u32();
+        if (index >= strings.size()) {
+            throw std::runtime_error("Invalid string index in AST cache.");
+        }
+        return strings[index];
+    }
+
+    uint64_t hashSource(std::string_view source) {
+        // Eight bytes per step, so hashing stays far cheaper than lexing.
+        const char* p = source.data();
+        std::size_t remaining = source.size();
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ remaining;
+        while (remaining >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+            p += 8;
+            remaining -= 8;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, p, remaining);
+        h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+        return h ^ (h >> 29);
+    }
+
+    std::string cachePath(const std::string& sourcePath) {
+        return sourcePath + "c";
+    }
+
+    void save(const Nodes::Program& program, std::string_view source, const std::string& path) {
+        Writer writer;
+        program.body->serialize(writer);
+        std::string image = writer.image(hashSource(source), source.size());
+
+        // Write next to the target and rename over it, so a reader never sees a half written cache.
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(image.data(), static_cast<std::streamsize>(image.size()));
+            if (!file) {
+                throw std::runtime_error("Could not write AST cache '" + temporary + "'.");
+            }
+        }
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not replace AST cache '" + path + "'.");
+        }
+    }
+
+    bool load(Nodes::Program& program, std::string_view source, const std::string& path) {
+        if (std::FILE* probe = std::fopen(path.c_str(), "rb")) {
+            std::fclose(probe);
+        } else {
+            return false; // No cache yet
+        }
+        Sources::MappedFile file(path);
+        std::string_view image = file.view();
+        Header header;
+        if (image.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, image.data(), sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion
+            || header.grammar != grammarVersion || header.sourceSize != source.size()
+            || header.sourceHash != hashSource(source)) {
+            return false; // Another format or grammar, or the source changed since the cache was written
+        }
+        try {
+            Reader reader(image.data() + sizeof(header), image.data() + image.size());
+            reader.readPools(header.symbolCount, header.stringCount);
+            program.body->deserialize(program.arena, reader);
+            if (!reader.atEnd()) {
+                throw std::runtime_error("Trailing data in AST cache.");
+            }
+        } catch (const std::runtime_error&) {
+            // Nodes read so far stay in the arena until the program is destroyed, but are unreachable.
+            program.body->stmts.clear();
+            return false;
+        }
+        program.resolve();
+        return true;
+    }
+}
@@ -0,0 +1,498 @@
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdio>
+#include "../../head/lang/Benchmarks.h"
+#include "../../head/lang/Tokenizer.h"
+#include "../../head/lang/Processor.h"
+#include "../../head/lang/AstCache.h"
+#include "../../head/lang/Jit.h"
+#include "../../head/lang/TypedArrays.h"
+#include "../../head/lang/GarbageCollector.h"
+#include "../../head/lang/scanner.h"
+#include "../../head/util/ThreadPool.h"
+
+namespace ProcessorBenchmarks {
+    std::string generateScript(std::size_t bytes) {
+        static const char* lines[] = {
+            "if (health <= damage * 2 + armor_bonus) { health = 0; }\n",
+            "// Adjust the spawn timer for the next wave of enemies\n",
+            "name = \"Level boss with a fairly long descriptive name string\";\n",
+            "/* Multiline comment describing the physics step.\n   Velocity is integrated before positions are clamped. */\n",
+            "position = [1.5, 2.25, 3.125, position_x * 0.5, position_y * 0.5];\n",
+            "table = {1: \"one\", 2: \"two\", 3: \"three\", 4: \"four\"};\n",
+            "if (!(alive && visible) || timer >= 1000) { timer = timer - 1000; }\n",
+        };
+        const std::size_t lineCount = sizeof(lines) / sizeof(lines[0]);
+        std::string script;
+        script.reserve(bytes + 128);
+        for (std::size_t i = 0; script.size() < bytes; i++) {
+            script += lines[(i * 5 + i / lineCount) % lineCount];
+        }
+        return script;
+    }
+
+    std::string generateNestedScript(std::size_t depth) {
+        std::string script;
+        script.reserve(depth * 64);
+        for (std::size_t i = 0; i < depth; i++) {
+            script += "if ((level + 1) * 2 >= limit && !(done)) {\n";
+            script += "total = total + level % 7;\n";
+        }
+        for (std::size_t i = 0; i < depth; i++) {
+            script += "}\n";
+        }
+        return script;
+    }
+
+    void report(const std::string& label, double ms, std::size_t bytes) {
+        double megabytes = bytes / (1024.0 * 1024.0);
+        printf("  %-36s %9.2f ms  %8.1f MB/s\n", label.c_str(), ms, megabytes / (ms / 1000.0));
+    }
+
+    void benchTokenizer() {
+        printf("Benchmarking Tokenizer...\n");
+        std::string script = generateScript(8 * 1024 * 1024);
+        printf("  %.1f MB generated script\n", script.size() / (1024.0 * 1024.0));
+
+        report("legacy Tokenizer::process", bestOf(3, [&] {
+            std::vector<std::string> tokens = Tokenizer::process(script);
+        }), script.size());
+
+        Scanner::Level detected = Scanner::detectedLevel();
+        for (int level = 0; level <= static_cast<int>(detected); level++) {
+            Scanner::setLevel(static_cast<Scanner::Level>(level));
+            report(std::string("Tokenizer::lex (") + Scanner::levelName(Scanner::activeLevel()) + ")", bestOf(5, [&] {
+                Tokens::TokenStream tokens = Tokenizer::lex(script);
+            }), script.size());
+        }
+        Scanner::setLevel(detected);
+    }
+
+    void benchParallelTokenizer() {
+        printf("Benchmarking Parallel Tokenizer...\n");
+        std::string script = generateScript(128 * 1024 * 1024);
+        printf("  %.1f MB generated script, %u hardware threads\n", script.size() / (1024.0 * 1024.0), ThreadPool::shared().size());
+
+        double sequential = bestOf(3, [&] {
+            Tokens::TokenStream tokens = Tokenizer::lex(script);
+        });
+        report("Tokenizer::lex", sequential, script.size());
+        for (unsigned threads = 2; threads <= 16; threads *= 2) {
+            double ms = bestOf(3, [&] {
+                Tokens::TokenStream tokens = Tokenizer::lexParallel(script, threads);
+            });
+            report("Tokenizer::lexParallel (" + std::to_string(threads) + " threads)", ms, script.size());
+            printf("  %-36s %9.2fx\n", "  speedup", sequential / ms);
+        }
+    }
+
+    void benchNestedParser() {
+        printf("Benchmarking Nested Parser...\n");
+        // Throughput should stay flat as depth grows; a parser that re-scans each block would slow down linearly.
+        for (std::size_t depth : {250, 500, 1000, 2000}) {
+            std::string script = generateNestedScript(depth);
+            Tokens::TokenStream tokens = Tokenizer::lex(script);
+            report("Program::process (depth " + std::to_string(depth) + ")", bestOf(5, [&] {
+                Nodes::Program program;
+                program.process(tokens);
+            }), script.size());
+        }
+    }
+
+    void benchAstCache() {
+        printf("Benchmarking AST Cache...\n");
+        std::string script = generateScript(8 * 1024 * 1024);
+        std::string path = "bench_ast_cache.hypec";
+        report("lex + parse", bestOf(3, [&] {
+            Nodes::Program program;
+            program.process(Tokenizer::lex(script));
+        }), script.size());
+        {
+            Nodes::Program program;
+            program.process(Tokenizer::lex(script));
+            AstCache::save(program, script, path);
+        }
+        report("AstCache::load", bestOf(3, [&] {
+            Nodes::Program program;
+            AstCache::load(program, script, path);
+        }), script.size());
+        report("AstCache::hashSource", bestOf(5, [&] {
+            volatile uint64_t hash = AstCache::hashSource(script);
+            (void)hash;
+        }), script.size());
+        std::remove(path.c_str());
+    }
+
+    void benchOperators() {
+        printf("Benchmarking Operators...\n");
+        const int iterations = 2000000;
+        const std::pair<const char*, const char*> cases[] = {
+            {"int arithmetic", "x = (a + b * 3) % 7 - (a << 2) + b / 5;"},
+            {"mixed int/double", "x = (a + c * 3) - (b * 0.5) / c + a % 7;"},
+            {"comparisons", "x = a < b && c >= 1.5 || !(a == b);"},
+        };
+        for (const auto& [label, source] : cases) {
+            Nodes::Program program;
+            program.body->setVar("a", DataTypes::Int(17));
+            program.body->setVar("b", DataTypes::Int(42));
+            program.body->setVar("c", DataTypes::Double(2.25));
+            program.process(Tokenizer::lex(source));
+            Nodes::Expression* expression = program.body->stmts[0]->expression;
+            double ms = bestOf(3, [&] {
+                for (int i = 0; i < iterations; i++) {
+                    expression->evaluate();
+                }
+            });
+            printf("  %-36s %9.2f ms  %8.1f ns/eval\n", label, ms, ms * 1e6 / iterations);
+        }
+        printf("  %zu sites specialized, %zu guard failures, %zu generalized\n", Nodes::specializationStats.specialized,
+            Nodes::specializationStats.guardFailures, Nodes::specializationStats.generalized);
+    }
+
+    void benchExecutionModes() {
+        printf("Benchmarking Execution Modes...\n");
+        static const char* lines[] = {
+            "total = total + step * 3 - (total % 7);\n",
+            "if (total > 100000) { total = total - 100000; wraps += 1; }\n",
+            "scale = scale * 0.5 + ratio / 4.0;\n",
+            "if (step < 10 && !(total == 0)) { step = step + 1; }\n",
+            "mask = (total & 255) | (step << 4);\n",
+        };
+        std::string script;
+        for (int i = 0; i < 400; i++) {
+            script += lines[i % 5];
+        }
+        const int runs = 500;
+        const char* labels[] = {"tree (evaluate)", "closures", Jit::supported ? "bytecode (jit once hot)" : "bytecode"};
+        for (Nodes::ExecutionMode mode : {Nodes::ExecutionMode::Tree, Nodes::ExecutionMode::Closures, Nodes::ExecutionMode::Bytecode}) {
+            Nodes::Program program;
+            program.mode = mode;
+            program.body->setVar("total", DataTypes::Int(1));
+            program.body->setVar("step", DataTypes::Int(1));
+            program.body->setVar("wraps", DataTypes::Int(0));
+            program.body->setVar("scale", DataTypes::Double(1.0));
+            program.body->setVar("ratio", DataTypes::Double(0.75));
+            program.process(Tokenizer::lex(script));
+            program.run(); // Compiles, or specializes the tree
+            double ms = bestOf(3, [&] {
+                for (int i = 0; i < runs; i++) {
+                    program.run();
+                }
+            });
+            printf("  %-36s %9.2f ms  %8.1f ns/statement\n", labels[static_cast<int>(mode)],
+                ms, ms * 1e6 / (runs * 400.0));
+        }
+        printf("  %zu chunks compiled to native code, %zu rejected, %zu deopts\n", Jit::stats.compiled,
+            Jit::stats.rejected, Jit::stats.deopts);
+    }
+
+    void benchContainers() {
+        printf("Benchmarking Containers...\n");
+        const int size = 1000000;
+        DataTypes::ArrayList items;
+        items.reserve(size);
+        for (int i = 0; i < size; i++) {
+            items.push_back(DataTypes::Var(DataTypes::Int(i)));
+        }
+        DataTypes::Var array(DataTypes::Array(std::move(items)));
+        long long sum = 0;
+        double ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                sum += array.getProperty(DataTypes::Int(i)).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "arr[i] over 1M elements", ms, ms * 1e6 / size);
+        // Passing the array around only shares it.
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                DataTypes::Var alias = array;
+                sum += alias.getProperty(DataTypes::Int(i)).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "alias then arr[i]", ms, ms * 1e6 / size);
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                array.data.mutableArray()[i] = DataTypes::Var(DataTypes::Int(i + 1));
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/write\n", "arr[i] = x, unshared", ms, ms * 1e6 / size);
+        DataTypes::Var alias = array;
+        ms = bestOf(1, [&] {
+            array.data.mutableArray()[0] = DataTypes::Var(DataTypes::Int(0));
+        });
+        printf("  %-36s %9.2f ms\n", "first write to a shared 1M array", ms);
+
+        DataTypes::Var dict{DataTypes::Dict()};
+        ms = bestOf(1, [&] {
+            DataTypes::Dictionary& entries = dict.data.mutableDict();
+            for (int i = 0; i < size; i++) {
+                entries[DataTypes::Int(i)] = DataTypes::Var(DataTypes::Int(i));
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/insert\n", "dict[k] = x, 1M new keys", ms, ms * 1e6 / size);
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                sum += dict.getProperty(DataTypes::Int(i)).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "dict[k] over 1M keys, in order", ms, ms * 1e6 / size);
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                sum += dict.getProperty(DataTypes::Int(static_cast<int>(i * 7919LL % size))).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "dict[k] over 1M keys, scattered", ms, ms * 1e6 / size);
+        std::vector<DataTypes::String> names;
+        for (int i = 0; i < 64; i++) {
+            names.emplace_back("field" + std::to_string(i));
+        }
+        DataTypes::Dictionary small;
+        for (const DataTypes::String& name : names) {
+            small[name] = DataTypes::Var(DataTypes::Int(1));
+        }
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < size; i++) {
+                sum += small.find(names[i & 63])->second.data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "string keys, 64 entry dict", ms, ms * 1e6 / size);
+        printf("  (checksum %lld)\n", sum);
+    }
+
+    void benchTypedArrays() {
+        printf("Benchmarking Typed Arrays...\n");
+        const int size = 1000000;
+        DataTypes::ArrayList items;
+        items.reserve(size);
+        for (int i = 0; i < size; i++) {
+            items.push_back(DataTypes::Var(DataTypes::Float(static_cast<float>(i % 1000) * 0.001f)));
+        }
+        DataTypes::Var array(DataTypes::Array(std::move(items)));
+        DataTypes::TypedArray floats(DataTypes::ElementKind::Float32, array.data.asArray());
+        printf("  1M floats: %.1f MB as an array, %.1f MB packed\n", size * sizeof(DataTypes::Var) / (1024.0 * 1024.0),
+            size * sizeof(float) / (1024.0 * 1024.0));
+        double total = 0;
+        double ms = bestOf(3, [&] {
+            DataTypes::Data sum = DataTypes::Float(0.0f);
+            for (int i = 0; i < size; i++) {
+                sum = sum + array.getProperty(DataTypes::Int(i)).data;
+            }
+            total += sum.toDouble();
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "sum, array of values", ms, ms * 1e6 / size);
+        ms = bestOf(3, [&] {
+            total += TypedArrays::sum(floats).toDouble();
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "sum, float32", ms, ms * 1e6 / size);
+        DataTypes::TypedArray velocities(std::vector<float>(size, 0.25f));
+        DataTypes::TypedArray masses(std::vector<float>(size, 2.0f));
+        ms = bestOf(3, [&] {
+            TypedArrays::fma(floats, velocities, masses);
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "fma, float32", ms, ms * 1e6 / size);
+        ms = bestOf(3, [&] {
+            TypedArrays::clamp(floats, DataTypes::Double(0.0), DataTypes::Double(100.0));
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "clamp, float32", ms, ms * 1e6 / size);
+        DataTypes::TypedArray positions(std::vector<double>(size, 1.5));
+        ms = bestOf(3, [&] {
+            total += TypedArrays::dot(positions, positions).toDouble();
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "dot, float64", ms, ms * 1e6 / size);
+        DataTypes::TypedArray counts(std::vector<int32_t>(size, 3));
+        ms = bestOf(3, [&] {
+            total += TypedArrays::max(counts).toDouble();
+        });
+        printf("  %-36s %9.2f ms  %8.2f ns/element\n", "max, int32", ms, ms * 1e6 / size);
+        printf("  (checksum %.1f)\n", total);
+    }
+
+    void benchPropertyAccess() {
+        printf("Benchmarking Property Access...\n");
+        static DataTypes::Class entity("Entity");
+        for (const char* name : {"x", "y", "z", "vx", "vy", "vz", "hp", "armor"}) {
+            entity.addProperty(name, DataTypes::Int(1));
+        }
+        DataTypes::ClassInstance enemy(entity);
+        const int iterations = 2000000;
+        Symbols::SymbolId hp = Symbols::intern("hp");
+        long long sum = 0;
+        double ms = bestOf(3, [&] {
+            for (int i = 0; i < iterations; i++) {
+                sum += enemy.getProperty(hp).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "lookup by name", ms, ms * 1e6 / iterations);
+        Nodes::PropertyCache cache;
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < iterations; i++) {
+                sum += cache.read(enemy, hp).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "inline cache, monomorphic", ms, ms * 1e6 / iterations);
+        // Four shapes of the same class, read in turn.
+        std::vector<DataTypes::Data> shapes;
+        for (int i = 0; i < 4; i++) {
+            DataTypes::ClassInstance variant(entity);
+            variant.get().set(Symbols::intern("tag" + std::to_string(i)), DataTypes::Null());
+            shapes.push_back(variant);
+        }
+        Nodes::PropertyCache polymorphic;
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < iterations; i++) {
+                sum += polymorphic.read(shapes[i & 3], hp).data.integer;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/read\n", "inline cache, 4 shapes", ms, ms * 1e6 / iterations);
+        std::string script;
+        for (int i = 0; i < 100; i++) {
+            script += "total = total + e.hp * e.armor - e.x;\n";
+        }
+        const int runs = 2000;
+        for (Nodes::ExecutionMode mode : {Nodes::ExecutionMode::Tree, Nodes::ExecutionMode::Closures}) {
+            Nodes::Program program;
+            program.mode = mode;
+            program.body->setVar("total", DataTypes::Int(0));
+            program.body->setVar("e", enemy);
+            program.process(Tokenizer::lex(script));
+            ms = bestOf(3, [&] {
+                for (int i = 0; i < runs; i++) {
+                    program.run();
+                }
+            });
+            printf("  %-36s %9.2f ms  %8.1f ns/read\n", mode == Nodes::ExecutionMode::Tree ? "script reads, tree" : "script reads, closures",
+                ms, ms * 1e6 / (runs * 300.0));
+        }
+        printf("  %zu misses, %zu polymorphic sites, %zu megamorphic  (checksum %lld)\n", Nodes::propertyCacheStats.misses,
+            Nodes::propertyCacheStats.polymorphic, Nodes::propertyCacheStats.megamorphic, sum);
+    }
+
+    void benchMethodLookup() {
+        printf("Benchmarking Method Lookup...\n");
+        // A chain of classes, each adding two methods, so the first method is inherited from the deepest parent.
+        std::vector<std::shared_ptr<DataTypes::Class>> chain;
+        for (int depth = 0; depth < 16; depth++) {
+            chain.push_back(std::make_shared<DataTypes::Class>("Level" + std::to_string(depth),
+                std::unordered_map<Symbols::SymbolId, DataTypes::Data>{}, depth ? chain.back() : nullptr));
+            chain.back()->addMethod(DataTypes::Function("method" + std::to_string(depth * 2), {}, nullptr));
+            chain.back()->addMethod(DataTypes::Function("method" + std::to_string(depth * 2 + 1), {}, nullptr));
+        }
+        Symbols::SymbolId root = Symbols::intern("method0");
+        const int iterations = 2000000;
+        std::size_t found = 0;
+        for (int depth : {1, 4, 16}) {
+            DataTypes::Class& type = *chain[depth - 1];
+            double ms = bestOf(3, [&] {
+                for (int i = 0; i < iterations; i++) {
+                    found += type.getProperty(root).data.object != nullptr;
+                }
+            });
+            char label[64];
+            snprintf(label, sizeof(label), "class lookup, depth %d", depth);
+            printf("  %-36s %9.2f ms  %8.1f ns/lookup\n", label, ms, ms * 1e6 / iterations);
+        }
+        DataTypes::ClassInstance instance(*chain.back());
+        double ms = bestOf(3, [&] {
+            for (int i = 0; i < iterations; i++) {
+                found += instance.getProperty(root).data.object != nullptr;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/lookup\n", "instance lookup, depth 16", ms, ms * 1e6 / iterations);
+        Nodes::PropertyCache cache;
+        ms = bestOf(3, [&] {
+            for (int i = 0; i < iterations; i++) {
+                found += cache.read(instance, root).data.object != nullptr;
+            }
+        });
+        printf("  %-36s %9.2f ms  %8.1f ns/lookup\n", "inline cache, depth 16", ms, ms * 1e6 / iterations);
+        printf("  (found %zu)\n", found);
+    }
+
+    void benchGarbageCollector() {
+        printf("Benchmarking Garbage Collector...\n");
+        // Game frames: every frame spawns enemies that target each other and drops them at the end, while a few
+        // hundred long-lived entities stay in the world.
+        static DataTypes::Class enemy("Enemy");
+        Symbols::SymbolId target = Symbols::intern("target");
+        std::vector<DataTypes::Data> world;
+        for (int i = 0; i < 500; i++) {
+            world.push_back(DataTypes::ClassInstance(enemy));
+        }
+        GarbageCollector::collect();
+        GarbageCollector::Stats before = GarbageCollector::stats();
+        const int frames = 200;
+        const int spawned = 1000;
+        double longestFrame = 0;
+        double total = bestOf(1, [&] {
+            for (int frame = 0; frame < frames; frame++) {
+                double ms = bestOf(1, [&] {
+                    std::vector<DataTypes::ClassInstance> wave;
+                    wave.reserve(spawned);
+                    for (int i = 0; i < spawned; i++) {
+                        wave.emplace_back(enemy);
+                        wave.back().get().set(target, i ? wave[i - 1] : wave.back());
+                    }
+                    wave[0].get().set(target, wave.back());
+                });
+                longestFrame = ms > longestFrame ? ms : longestFrame;
+            }
+        });
+        GarbageCollector::Stats after = GarbageCollector::stats();
+        printf("  %-36s %9.2f ms  %8.1f ns/object\n", "frames of 1000 cyclic instances", total, total * 1e6 / (frames * spawned));
+        printf("  %-36s %9.2f ms\n", "longest frame", longestFrame);
+        printf("  %zu young and %zu full collections, %zu objects freed\n", after.youngCollections - before.youngCollections,
+            after.fullCollections - before.fullCollections, after.freed - before.freed);
+        printf("  pauses: %.3f ms longest, %.3f ms total; %zu young and %zu old objects live\n", after.longestPauseMs,
+            after.totalPauseMs - before.totalPauseMs, after.youngObjects, after.oldObjects);
+    }
+
+    void benchObjectPools() {
+        printf("Benchmarking Object Pools...\n");
+        // Particles: a burst is spawned, lives for a frame and is dropped.
+        static DataTypes::Class particle("Particle");
+        for (const char* name : {"x", "y", "vx", "vy", "life", "color"}) {
+            particle.addProperty(name, DataTypes::Double(0.0));
+        }
+        Symbols::SymbolId life = Symbols::intern("life");
+        const int frames = 500;
+        const int burst = 1000;
+        std::vector<DataTypes::ClassInstance> alive;
+        alive.reserve(burst);
+        double checksum = 0;
+        for (std::size_t capacity : {std::size_t(0), std::size_t(burst)}) {
+            particle.setPool(capacity);
+            double ms = bestOf(3, [&] {
+                for (int frame = 0; frame < frames; frame++) {
+                    for (int i = 0; i < burst; i++) {
+                        alive.emplace_back(particle);
+                        alive.back().get().set(life, DataTypes::Double(1.0));
+                    }
+                    checksum += alive.back().getProperty(life).data.real;
+                    alive.clear();
+                }
+            });
+            printf("  %-36s %9.2f ms  %8.1f ns/instance\n", capacity ? "spawn and drop, pooled" : "spawn and drop, allocated",
+                ms, ms * 1e6 / (frames * burst));
+        }
+        DataTypes::PoolStats stats = particle.poolStats();
+        printf("  hit rate %.4f, high water %zu, %zu bytes retained  (checksum %.1f)\n", stats.hitRate(), stats.highWater,
+            stats.bytes, checksum);
+        particle.setPool(0);
+    }
+
+    void runBenchmarks() {
+        benchTokenizer();
+        benchParallelTokenizer();
+        benchNestedParser();
+        benchAstCache();
+        benchOperators();
+        benchExecutionModes();
+        benchContainers();
+        benchTypedArrays();
+        benchPropertyAccess();
+        benchMethodLookup();
+        benchGarbageCollector();
+        benchObjectPools();
+    }
+}
@@ -0,0 +1,357 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "../../head/lang/Bytecode.h"
+#include "../../head/lang/Jit.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BYTECODE_COMPUTED_GOTO 1
+#else
+#define BYTECODE_COMPUTED_GOTO 0
+#endif
+
+namespace Bytecode {
+    const char* opName(Op op) {
+        switch (op) {
+            #define BYTECODE_NAME(name) case Op::name: return #name;
+            BYTECODE_OPS(BYTECODE_NAME)
+            #undef BYTECODE_NAME
+        }
+        return "?";
+    }
+
+    Register Compiler::allocate() {
+        if (next >= maxRegisters) {
+            throw std::runtime_error("Expression needs more than 256 registers.");
+        }
+        Register r = static_cast<Register>(next++);
+        chunk.registerCount = std::max(chunk.registerCount, next);
+        return r;
+    }
+    uint16_t Compiler::constant(const DataTypes::Data& value) {
+        // Keyed by type and payload bits, so 1 and 1.0 stay separate constants.
+        std::string key(1, static_cast<char>(value.type));
+        if (value.is(DataTypes::Type::String)) {
+            key += value.asString();
+        } else if (!value.isHeap()) {
+            key.append(reinterpret_cast<const char*>(&value.real), sizeof(value.real));
+        } else {
+            key.append(reinterpret_cast<const char*>(&value.object), sizeof(value.object)); // By identity
+        }
+        auto it = constantIndex.find(key);
+        if (it != constantIndex.end()) {
+            return it->second;
+        }
+        if (chunk.constants.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many constants for one chunk.");
+        }
+        uint16_t index = static_cast<uint16_t>(chunk.constants.size());
+        chunk.constants.push_back(value);
+        constantIndex.emplace(std::move(key), index);
+        return index;
+    }
+    uint16_t Compiler::slot(Nodes::Base* site, Symbols::SymbolId symbol, const Nodes::Address& address) {
+        Nodes::Base* scope = site->parent;
+        while (scope && !dynamic_cast<Nodes::Block*>(scope)) {
+            scope = scope->parent;
+        }
+        std::unordered_map<Symbols::SymbolId, uint16_t>& index = slotIndex[scope];
+        auto it = index.find(symbol);
+        if (it != index.end()) {
+            return it->second;
+        }
+        if (chunk.slots.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many variables for one chunk.");
+        }
+        uint16_t id = static_cast<uint16_t>(chunk.slots.size());
+        chunk.slots.emplace_back(site, symbol, address);
+        index.emplace(symbol, id);
+        return id;
+    }
+    uint16_t Compiler::node(Nodes::Expression* expression) {
+        if (chunk.nodes.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many evaluated nodes for one chunk.");
+        }
+        chunk.nodes.push_back(expression);
+        return static_cast<uint16_t>(chunk.nodes.size() - 1);
+    }
+    void Compiler::patch(std::size_t index) {
+        std::size_t offset = chunk.code.size() - (index + 1);
+        if (offset > INT16_MAX) {
+            throw std::runtime_error("Jump spans more than 32767 instructions.");
+        }
+        Instruction jump = chunk.code[index];
+        chunk.code[index] = encodeBx(opOf(jump), argA(jump), static_cast<uint16_t>(offset));
+    }
+
+    Chunk compile(Nodes::Block& body) {
+        Compiler compiler;
+        body.emit(compiler);
+        compiler.emit(encode(Op::Return, 0));
+        return std::move(compiler.chunk);
+    }
+
+    void VM::run(Chunk& chunk) {
+        resume(chunk, 0, {});
+    }
+    void VM::resume(Chunk& chunk, std::size_t pc, const std::vector<DataTypes::Data>& live) {
+        std::size_t base = frames.empty() ? 0 : frames.back().base + frames.back().chunk->registerCount;
+        if (registers.size() < base + chunk.registerCount) {
+            registers.resize(base + chunk.registerCount);
+        }
+        std::copy(live.begin(), live.end(), registers.begin() + base);
+        frames.push_back(Frame{&chunk, chunk.code.data() + pc, base});
+        auto leave = [&] {
+            // Registers drop their values, so strings and containers do not outlive the run.
+            std::fill(registers.begin() + base, registers.begin() + base + chunk.registerCount, DataTypes::Data());
+            frames.pop_back();
+        };
+        try {
+            execute();
+        } catch (...) {
+            leave();
+            throw;
+        }
+        leave();
+    }
+
+    void VM::execute() {
+        namespace K = Operators::Kernels;
+        using DataTypes::Data;
+        using DataTypes::Type;
+
+        Chunk& chunk = *frames.back().chunk;
+        const std::size_t base = frames.back().base;
+        const Instruction* pc = frames.back().pc;
+        const Data* constants = chunk.constants.data();
+        Data* R = registers.data() + base;
+        Instruction i;
+
+// One handler per opcode. With computed goto every handler jumps straight to the next one through the label
+// table, which gives each its own indirect branch to predict. The switch version shares a single one.
+#if BYTECODE_COMPUTED_GOTO
+        static const void* const labels[] = {
+            #define BYTECODE_LABEL(name) &&op_##name,
+            BYTECODE_OPS(BYTECODE_LABEL)
+            #undef BYTECODE_LABEL
+        };
+        #define CASE(name) op_##name:
+        #define DISPATCH() do { i = *pc++; goto *labels[i & 0xFF]; } while (0)
+        DISPATCH();
+#else
+        #define CASE(name) case Op::name:
+        #define DISPATCH() break
+        for (;;) {
+            i = *pc++;
+            switch (opOf(i)) {
+#endif
+
+        // Binary operators go through the kernel table, the common int pairs are inlined.
+        #define BINARY(name) \
+            CASE(name) { \
+                const Data& left = R[argB(i)]; \
+                const Data& right = R[argC(i)]; \
+                Operators::Kernel kernel = Operators::lookup(Operators::Opcode::name, left.type, right.type); \
+                if (!kernel) { \
+                    Operators::unsupported(Operators::Opcode::name, left, right); \
+                } \
+                R[argA(i)] = kernel(left, right); \
+                DISPATCH(); \
+            }
+        #define BINARY_INT(name) \
+            CASE(name) { \
+                const Data& left = R[argB(i)]; \
+                const Data& right = R[argC(i)]; \
+                if (left.type == Type::Int && right.type == Type::Int) { \
+                    R[argA(i)] = K::numeric<K::name, Type::Int, Type::Int>(left, right); \
+                    DISPATCH(); \
+                } \
+                Operators::Kernel kernel = Operators::lookup(Operators::Opcode::name, left.type, right.type); \
+                if (!kernel) { \
+                    Operators::unsupported(Operators::Opcode::name, left, right); \
+                } \
+                R[argA(i)] = kernel(left, right); \
+                DISPATCH(); \
+            }
+        #define UNARY(name) \
+            CASE(name) { \
+                const Data& operand = R[argB(i)]; \
+                Operators::UnaryKernel kernel = Operators::lookup(Operators::UnaryOpcode::name, operand.type); \
+                if (!kernel) { \
+                    Operators::unsupported(Operators::UnaryOpcode::name, operand); \
+                } \
+                R[argA(i)] = kernel(operand); \
+                DISPATCH(); \
+            }
+
+        CASE(LoadConst) {
+            R[argA(i)] = constants[argBx(i)];
+            DISPATCH();
+        }
+        CASE(Move) {
+            R[argA(i)] = R[argB(i)];
+            DISPATCH();
+        }
+        CASE(GetVar) {
+            R[argA(i)] = chunk.slots[argBx(i)].read();
+            DISPATCH();
+        }
+        CASE(SetVar) {
+            chunk.slots[argBx(i)].write().data = R[argA(i)];
+            DISPATCH();
+        }
+        BINARY_INT(Add)
+        BINARY_INT(Subtract)
+        BINARY_INT(Multiply)
+        BINARY(Divide)
+        BINARY(Modulo)
+        BINARY(BitAnd)
+        BINARY(BitOr)
+        BINARY(BitXor)
+        BINARY(ShiftLeft)
+        BINARY(ShiftRight)
+        BINARY_INT(Equal)
+        BINARY_INT(NotEqual)
+        BINARY_INT(Less)
+        BINARY_INT(Greater)
+        BINARY_INT(LessEqual)
+        BINARY_INT(GreaterEqual)
+        BINARY(And)
+        BINARY(Or)
+        UNARY(Negate)
+        UNARY(Not)
+        UNARY(BitNot)
+        CASE(NewArray) {
+            DataTypes::ArrayList items;
+            items.reserve(argC(i));
+            for (uint8_t k = 0; k < argC(i); k++) {
+                items.push_back(DataTypes::Var(R[argB(i) + k]));
+            }
+            R[argA(i)] = DataTypes::Array(std::move(items));
+            DISPATCH();
+        }
+        CASE(NewDict) {
+            DataTypes::Dictionary entries;
+            entries.reserve(argC(i));
+            for (uint8_t k = 0; k < argC(i); k++) {
+                DataTypes::Primitive key(R[argB(i) + 2 * k]); // Throws for keys that are not primitives
+                entries[key] = DataTypes::Var(R[argB(i) + 2 * k + 1]);
+            }
+            R[argA(i)] = DataTypes::Dict(std::move(entries));
+            DISPATCH();
+        }
+        CASE(Jump) {
+            pc += argSBx(i);
+            DISPATCH();
+        }
+        CASE(JumpIfFalse) {
+            if (!R[argA(i)].truthy()) {
+                pc += argSBx(i);
+            }
+            DISPATCH();
+        }
+        CASE(Evaluate) {
+            Data value = chunk.nodes[argBx(i)]->evaluate();
+            R = registers.data() + base; // The node may have run other code on this VM
+            R[argA(i)] = std::move(value);
+            DISPATCH();
+        }
+        CASE(Return) {
+            return;
+        }
+
+#if !BYTECODE_COMPUTED_GOTO
+            }
+        }
+#endif
+        #undef BINARY
+        #undef BINARY_INT
+        #undef UNARY
+        #undef CASE
+        #undef DISPATCH
+    }
+
+    namespace {
+        std::string quoted(const DataTypes::Data& value) {
+            if (value.is(DataTypes::Type::String)) {
+                return "\"" + value.asString() + "\"";
+            }
+            return value.toString();
+        }
+    }
+
+    std::string disassemble(const Chunk& chunk) {
+        std::string out;
+        char line[160];
+        std::snprintf(line, sizeof(line), "; %zu instructions, %zu constants, %zu slots, %zu registers\n",
+            chunk.code.size(), chunk.constants.size(), chunk.slots.size(), chunk.registerCount);
+        out += line;
+        for (std::size_t index = 0; index < chunk.code.size(); index++) {
+            Instruction i = chunk.code[index];
+            Op op = opOf(i);
+            std::string operands;
+            std::string comment;
+            char buffer[64];
+            switch (op) {
+                case Op::LoadConst:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, k%d", argA(i), argBx(i));
+                    comment = quoted(chunk.constants[argBx(i)]);
+                    break;
+                case Op::GetVar:
+                case Op::SetVar:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, s%d", argA(i), argBx(i));
+                    comment = Symbols::toString(chunk.slots[argBx(i)].symbol);
+                    break;
+                case Op::Move:
+                case Op::Negate:
+                case Op::Not:
+                case Op::BitNot:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, r%d", argA(i), argB(i));
+                    break;
+                case Op::NewArray:
+                case Op::NewDict:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, r%d, %d", argA(i), argB(i), argC(i));
+                    break;
+                case Op::Jump:
+                    std::snprintf(buffer, sizeof(buffer), "%+d", argSBx(i));
+                    comment = "-> " + std::to_string(index + 1 + argSBx(i));
+                    break;
+                case Op::JumpIfFalse:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, %+d", argA(i), argSBx(i));
+                    comment = "-> " + std::to_string(index + 1 + argSBx(i));
+                    break;
+                case Op::Evaluate:
+                    std::snprintf(buffer, sizeof(buffer), "r%d, n%d", argA(i), argBx(i));
+                    comment = chunk.nodes[argBx(i)]->toString();
+                    break;
+                case Op::Return:
+                    buffer[0] = '\0';
+                    break;
+                default: // Binary operators
+                    std::snprintf(buffer, sizeof(buffer), "r%d, r%d, r%d", argA(i), argB(i), argC(i));
+                    break;
+            }
+            operands = buffer;
+            std::snprintf(line, sizeof(line), "%04zu  %-13s %s", index, opName(op), operands.c_str());
+            out += line;
+            if (!comment.empty()) {
+                out += std::string(std::max<int>(1, 20 - static_cast<int>(operands.size())), ' ') + "; " + comment;
+            }
+            out += "\n";
+        }
+        return out;
+    }
+}
+
+void Nodes::Program::runBytecode() {
+    if (!chunk) {
+        chunk = std::make_shared<Bytecode::Chunk>(Bytecode::compile(*body));
+    }
+    static thread_local Bytecode::VM vm;
+    if (!Jit::run(*chunk, vm)) {
+        vm.run(*chunk);
+    }
+}
@@ -0,0 +1,668 @@
+#include <string>
+#include <stdexcept>
+#include <functional>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include "../../head/lang/Processor.h"
+#include "../../head/lang/Operators.h"
+
+namespace DataTypes {
+    const char* typeName(Type type) {
+        switch (type) {
+            case Type::Null: return "null";
+            case Type::Bool: return "bool";
+            case Type::Int: return "int";
+            case Type::Float: return "float";
+            case Type::Double: return "double";
+            case Type::String: return "string";
+            case Type::Array: return "array";
+            case Type::Dict: return "dict";
+            case Type::Function: return "function";
+            case Type::ClassInstance: return "class_instance";
+            case Type::TypedArray: return "typed_array";
+        }
+        return "unknown";
+    }
+
+    namespace {
+        bool bothNumeric(const Data& left, const Data& right) {
+            return left.isNumeric() && right.isNumeric();
+        }
+        Var dictProperty(const Dictionary& dict, const Primitive& label) {
+            auto it = dict.find(label);
+            if (it != dict.end()) {
+                return it->second;
+            }
+            throw std::runtime_error("Property not found in dictionary.");
+        }
+        std::size_t checkIndex(const Primitive& label, std::size_t size) {
+            if (label.type != Type::Int) {
+                throw std::runtime_error("Index must be an integer.");
+            }
+            if (label.integer < 0 || static_cast<std::size_t>(label.integer) >= size) {
+                throw std::runtime_error("Index out of bounds.");
+            }
+            return static_cast<std::size_t>(label.integer);
+        }
+        Var arrayProperty(const ArrayList& array, const Primitive& label) {
+            return array[checkIndex(label, array.size())];
+        }
+        Var typedArrayProperty(const TypedArrayObject& array, const Primitive& label) {
+            return array.at(checkIndex(label, array.size()));
+        }
+        Var instanceProperty(InstanceObject& instance, Symbols::SymbolId id) {
+            if (Var* property = instance.find(id)) {
+                return *property;
+            }
+            // Methods are looked up on the class
+            if (const Function* method = instance.classType->findMethod(id)) {
+                return Var(*method);
+            }
+            throw std::runtime_error("Property not found in class instance.");
+        }
+    }
+
+    double Data::toDouble() const {
+        switch (type) {
+            case Type::Bool: return boolean ? 1.0 : 0.0;
+            case Type::Int: return integer;
+            case Type::Float: return single;
+            case Type::Double: return real;
+            default: throw std::runtime_error(std::string("Expected a number, got ") + typeName(type) + ".");
+        }
+    }
+    int Data::toInt() const {
+        switch (type) {
+            case Type::Bool: return boolean ? 1 : 0;
+            case Type::Int: return integer;
+            case Type::Float: return static_cast<int>(single);
+            case Type::Double: return static_cast<int>(real);
+            default: throw std::runtime_error(std::string("Expected a number, got ") + typeName(type) + ".");
+        }
+    }
+    bool Data::truthy() const {
+        switch (type) {
+            case Type::Null: return false;
+            case Type::Bool: return boolean;
+            case Type::Int: return integer != 0;
+            case Type::Float: return single != 0.0f;
+            case Type::Double: return real != 0.0;
+            case Type::String: return !asString().empty();
+            case Type::Array: return !asArray().empty();
+            case Type::Dict: return !asDict().empty();
+            case Type::TypedArray: return asTypedArray().size() != 0;
+            default: return true;
+        }
+    }
+    const std::string& Data::asString() const {
+        if (type != Type::String) {
+            throw std::runtime_error(std::string("Expected a string, got ") + typeName(type) + ".");
+        }
+        return static_cast<StringObject*>(object)->text;
+    }
+    const ArrayList& Data::asArray() const {
+        if (type != Type::Array) {
+            throw std::runtime_error(std::string("Expected an array, got ") + typeName(type) + ".");
+        }
+        return static_cast<ArrayObject*>(object)->items;
+    }
+    const Dictionary& Data::asDict() const {
+        if (type != Type::Dict) {
+            throw std::runtime_error(std::string("Expected a dict, got ") + typeName(type) + ".");
+        }
+        return static_cast<DictObject*>(object)->entries;
+    }
+    ArrayList& Data::mutableArray() {
+        const ArrayList& items = asArray();
+        if (object->references > 1) {
+            *this = Data(Type::Array, new ArrayObject(items));
+        }
+        return static_cast<ArrayObject*>(object)->items;
+    }
+    Dictionary& Data::mutableDict() {
+        const Dictionary& entries = asDict();
+        if (object->references > 1) {
+            *this = Data(Type::Dict, new DictObject(entries));
+        }
+        return static_cast<DictObject*>(object)->entries;
+    }
+    const TypedArrayObject& Data::asTypedArray() const {
+        if (type != Type::TypedArray) {
+            throw std::runtime_error(std::string("Expected a typed array, got ") + typeName(type) + ".");
+        }
+        return *static_cast<TypedArrayObject*>(object);
+    }
+    TypedArrayObject& Data::mutableTypedArray() {
+        const TypedArrayObject& array = asTypedArray();
+        if (object->references > 1) {
+            *this = Data(Type::TypedArray, new TypedArrayObject(array.elements));
+        }
+        return *static_cast<TypedArrayObject*>(object);
+    }
+
+    const std::string Data::toString() const {
+        switch (type) {
+            case Type::Null: return "null";
+            case Type::Bool: return boolean ? "true" : "false";
+            case Type::Int: return std::to_string(integer);
+            case Type::Float: return std::to_string(single);
+            case Type::Double: return std::to_string(real);
+            case Type::String: return asString();
+            case Type::Function: return static_cast<FunctionObject*>(object)->name;
+            case Type::ClassInstance: return static_cast<InstanceObject*>(object)->classType->name;
+            default: return typeName(type);
+        }
+    }
+    const JsonObject Data::toJSON() const {
+        JsonObject json;
+        json.add("type", std::string(typeName(type)));
+        switch (type) {
+            case Type::Null: json.add("value", NullObject()); break;
+            case Type::Bool: json.add("value", boolean); break;
+            case Type::Int: json.add("value", integer); break;
+            case Type::Float: json.add("value", static_cast<double>(single)); break;
+            case Type::Double: json.add("value", real); break;
+            case Type::String: json.add("value", asString()); break;
+            case Type::Array: {
+                JsonArray items;
+                for (const Var& item : asArray()) {
+                    items.append(item.data.toJSON());
+                }
+                json.add("value", items);
+                break;
+            }
+            case Type::Dict: {
+                JsonObject entries;
+                for (const auto& [key, value] : asDict()) {
+                    entries.add(key.toString(), value.data.toJSON());
+                }
+                json.add("value", entries);
+                break;
+            }
+            case Type::Function: json.add("value", static_cast<FunctionObject*>(object)->name); break;
+            case Type::ClassInstance: {
+                const InstanceObject& instance = *static_cast<InstanceObject*>(object);
+                json.add("class", instance.classType->toJSON());
+                JsonObject propertiesObject;
+                const std::vector<Symbols::SymbolId>& names = instance.shape->properties();
+                for (std::size_t slot = 0; slot < names.size(); slot++) {
+                    propertiesObject.add(Symbols::toString(names[slot]), instance.slots[slot].data.toJSON());
+                }
+                json.add("properties", propertiesObject);
+                break;
+            }
+            case Type::TypedArray: {
+                const TypedArrayObject& array = asTypedArray();
+                json.add("kind", std::string(elementKindName(array.kind())));
+                JsonArray elements;
+                for (std::size_t i = 0; i < array.size(); i++) {
+                    elements.append(array.at(i).toJSON());
+                }
+                json.add("value", elements);
+                break;
+            }
+        }
+        return json;
+    }
+    std::size_t Data::hash() const {
+        switch (type) {
+            case Type::Null: return 0;
+            case Type::Bool: return std::hash<bool>()(boolean);
+            case Type::Int: return std::hash<long long>()(integer);
+            case Type::Float:
+            case Type::Double: {
+                // Equal numbers must hash alike across types, so whole floats hash as the int they equal.
+                double value = toDouble();
+                if (value == std::trunc(value) && std::fabs(value) < 9.0e18) {
+                    return std::hash<long long>()(static_cast<long long>(value));
+                }
+                return std::hash<double>()(value);
+            }
+            case Type::String: return std::hash<std::string>()(asString());
+            default: return std::hash<const void*>()(object);
+        }
+    }
+    bool Data::equals(const Data& other) const {
+        if (type != other.type) {
+            return bothNumeric(*this, other) && type != Type::Bool && other.type != Type::Bool && toDouble() == other.toDouble();
+        }
+        switch (type) {
+            case Type::Null: return true;
+            case Type::Bool: return boolean == other.boolean;
+            case Type::Int: return integer == other.integer;
+            case Type::Float: return single == other.single;
+            case Type::Double: return real == other.real;
+            case Type::String: return asString() == other.asString();
+            default: return object == other.object; // Containers and objects compare by identity
+        }
+    }
+
+    // The operators are shorthands for the operator engine, see Operators.h for the promotion rules.
+    Data Data::operator+(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Add, *this, other);
+    }
+    Data Data::operator-(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Subtract, *this, other);
+    }
+    Data Data::operator*(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Multiply, *this, other);
+    }
+    Data Data::operator/(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Divide, *this, other);
+    }
+    Data Data::operator%(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Modulo, *this, other);
+    }
+    Data Data::operator&(const Data& other) const {
+        return Operators::apply(Operators::Opcode::BitAnd, *this, other);
+    }
+    Data Data::operator|(const Data& other) const {
+        return Operators::apply(Operators::Opcode::BitOr, *this, other);
+    }
+    Data Data::operator^(const Data& other) const {
+        return Operators::apply(Operators::Opcode::BitXor, *this, other);
+    }
+    Data Data::operator<<(const Data& other) const {
+        return Operators::apply(Operators::Opcode::ShiftLeft, *this, other);
+    }
+    Data Data::operator>>(const Data& other) const {
+        return Operators::apply(Operators::Opcode::ShiftRight, *this, other);
+    }
+    Data Data::operator==(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Equal, *this, other);
+    }
+    Data Data::operator!=(const Data& other) const {
+        return Operators::apply(Operators::Opcode::NotEqual, *this, other);
+    }
+    Data Data::operator<(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Less, *this, other);
+    }
+    Data Data::operator>(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Greater, *this, other);
+    }
+    Data Data::operator<=(const Data& other) const {
+        return Operators::apply(Operators::Opcode::LessEqual, *this, other);
+    }
+    Data Data::operator>=(const Data& other) const {
+        return Operators::apply(Operators::Opcode::GreaterEqual, *this, other);
+    }
+    Data Data::operator&&(const Data& other) const {
+        return Operators::apply(Operators::Opcode::And, *this, other);
+    }
+    Data Data::operator||(const Data& other) const {
+        return Operators::apply(Operators::Opcode::Or, *this, other);
+    }
+    Data Data::operator-() const {
+        return Operators::apply(Operators::UnaryOpcode::Negate, *this);
+    }
+    Data Data::operator!() const {
+        return Operators::apply(Operators::UnaryOpcode::Not, *this);
+    }
+    Data Data::operator~() const {
+        return Operators::apply(Operators::UnaryOpcode::BitNot, *this);
+    }
+
+    Var Var::getProperty(const Primitive& label) {
+        // Dicts, Arrays and Classes are the only types that can have properties
+        switch (data.type) {
+            case Type::ClassInstance: return instanceProperty(*static_cast<InstanceObject*>(data.object), Symbols::intern(label.asString()));
+            case Type::Dict: return dictProperty(data.asDict(), label);
+            case Type::Array: return arrayProperty(data.asArray(), label);
+            case Type::TypedArray: return typedArrayProperty(data.asTypedArray(), label);
+            default: throw std::runtime_error("Property not found in variable.");
+        }
+    }
+
+    Primitive::Primitive(const Data& data) : Data(data) {
+        if (isHeap() && type != Type::String) {
+            throw std::runtime_error(std::string("A ") + typeName(type) + " cannot be used as a key.");
+        }
+    }
+
+    Var Dict::getProperty(const Primitive& label) {
+        return dictProperty(entries(), label);
+    }
+    Var Array::getProperty(const Primitive& label) {
+        return arrayProperty(items(), label);
+    }
+
+    const char* elementKindName(ElementKind kind) {
+        switch (kind) {
+            case ElementKind::Int32: return "int32";
+            case ElementKind::Int64: return "int64";
+            case ElementKind::Float32: return "float32";
+            case ElementKind::Float64: return "float64";
+        }
+        return "unknown";
+    }
+    template<typename T>
+    T toElement(const Data& value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(value.toDouble());
+        } else {
+            if (value.type == Type::Int || value.type == Type::Bool) {
+                return static_cast<T>(value.toInt());
+            }
+            // Doubles of 2^31 and 2^63 do not fit, so the range check is exclusive at the top.
+            double number = value.toDouble();
+            constexpr double limit = static_cast<double>(std::numeric_limits<T>::max()) + 1.0;
+            if (!(number >= -limit && number < limit)) {
+                throw std::runtime_error(std::to_string(number) + " does not fit in an " + (sizeof(T) == 4 ? "int32" : "int64") + " element.");
+            }
+            return static_cast<T>(number);
+        }
+    }
+    template int32_t toElement<int32_t>(const Data& value);
+    template int64_t toElement<int64_t>(const Data& value);
+    template float toElement<float>(const Data& value);
+    template double toElement<double>(const Data& value);
+    Data elementValue(int32_t element) {
+        return Int(element);
+    }
+    Data elementValue(int64_t element) {
+        if (element >= INT32_MIN && element <= INT32_MAX) {
+            return Int(static_cast<int>(element));
+        }
+        return Double(static_cast<double>(element));
+    }
+    Data elementValue(float element) {
+        return Float(element);
+    }
+    Data elementValue(double element) {
+        return Double(element);
+    }
+
+    TypedArrayObject::TypedArrayObject(ElementKind kind, std::size_t length) {
+        switch (kind) {
+            case ElementKind::Int32: elements = std::vector<int32_t>(length); break;
+            case ElementKind::Int64: elements = std::vector<int64_t>(length); break;
+            case ElementKind::Float32: elements = std::vector<float>(length); break;
+            case ElementKind::Float64: elements = std::vector<double>(length); break;
+        }
+    }
+    Data TypedArrayObject::at(std::size_t index) const {
+        return std::visit([index](const auto& values) { return elementValue(values[index]); }, elements);
+    }
+    void TypedArrayObject::set(std::size_t index, const Data& value) {
+        std::visit([index, &value](auto& values) {
+            values[index] = toElement<typename std::decay_t<decltype(values)>::value_type>(value);
+        }, elements);
+    }
+    TypedArray::TypedArray(ElementKind kind, const ArrayList& items) : TypedArray(kind, items.size()) {
+        TypedArrayObject& array = mutableElements();
+        for (std::size_t i = 0; i < items.size(); i++) {
+            array.set(i, items[i].data);
+        }
+    }
+    Var TypedArray::getProperty(const Primitive& label) {
+        return typedArrayProperty(elements(), label);
+    }
+
+    JsonObject Class::toJSON() const {
+        JsonObject json;
+        json.add("name", name);
+        JsonArray methodsArray;
+        for (const auto& method : methods) {
+            methodsArray.append(method.toJSON());
+        }
+        json.add("methods", methodsArray);
+        JsonObject propertiesObject;
+        for (const auto& [key, value] : properties) {
+            propertiesObject.add(Symbols::toString(key), value.toJSON());
+        }
+        json.add("properties", propertiesObject);
+        if (!parent.expired()) {
+            json.add("parent", parent.lock()->toJSON());
+        }
+        else {
+            json.add("parent", std::string("null"));
+        }
+        return json;
+    }
+    Var Class::getProperty(const Primitive& label) {
+        return getProperty(Symbols::intern(label.asString()));
+    }
+    Var Class::getProperty(Symbols::SymbolId id) {
+        // Check if the property exists in the class (properties and methods)
+        auto it = properties.find(id);
+        if (it != properties.end()) {
+            return Var(it->second);
+        }
+        if (const Function* method = findMethod(id)) {
+            return Var(*method);
+        }
+        // Check if the property exists in the parent class (if any)
+        if (!parent.expired()) {
+            return parent.lock()->getProperty(id);
+        }
+        throw std::runtime_error("Property not found in class (or superclass).");
+    }
+    void Class::buildMethodTable() const {
+        uint64_t epoch = methodEpoch.load(std::memory_order_relaxed);
+        if (std::shared_ptr<Class> base = parent.lock()) {
+            table = base->methodTable();
+            tableSlots = base->tableSlots;
+        } else {
+            table.clear();
+            tableSlots.clear();
+        }
+        for (const Function& method : methods) {
+            auto [slot, added] = tableSlots.insert({method.symbol(), static_cast<uint32_t>(table.size())});
+            if (added) {
+                table.push_back(method);
+            } else {
+                table[slot->second] = method;
+            }
+        }
+        tableEpoch = epoch;
+    }
+    Data Class::instantiate() {
+        return ClassInstance(*this);
+    }
+    Class::~Class() {
+        trimPool(0);
+        if (id != noType && id >= builtinTypeCount) {
+            TypeRegistry::instance().remove(*this);
+        }
+    }
+    void Class::buildTemplate() {
+        const Shape* layout = rootShape();
+        templateSlots.clear();
+        templateSlots.reserve(properties.size());
+        for (const auto& [key, value] : properties) {
+            layout = layout->with(key);
+            templateSlots.emplace_back(value);
+        }
+        templateShape = layout;
+    }
+    void Class::setPool(std::size_t capacity) {
+        poolCapacity = capacity;
+        trimPool(capacity);
+    }
+    void Class::trimPool(std::size_t size) {
+        while (pool.size() > size) {
+            delete pool.back();
+            pool.pop_back();
+        }
+    }
+    PoolStats Class::poolStats() const {
+        PoolStats stats = pooling;
+        stats.retained = pool.size();
+        stats.bytes = 0;
+        for (const InstanceObject* instance : pool) {
+            stats.bytes += sizeof(InstanceObject) + instance->slots.capacity() * sizeof(Var);
+        }
+        return stats;
+    }
+    InstanceObject* Class::makeInstance() {
+        if (!pool.empty()) {
+            InstanceObject* instance = pool.back();
+            pool.pop_back();
+            pooling.hits++;
+            return instance;
+        }
+        if (poolCapacity != 0) {
+            pooling.misses++;
+        }
+        if (templateShape == nullptr) {
+            buildTemplate();
+        }
+        InstanceObject* instance = new InstanceObject(this);
+        instance->pooled = poolCapacity != 0;
+        instance->shape = templateShape;
+        instance->slots = templateSlots;
+        return instance;
+    }
+    void Class::recycle(InstanceObject* instance) {
+        if (pool.size() >= poolCapacity) {
+            delete instance;
+            return;
+        }
+        if (templateShape == nullptr) {
+            buildTemplate();
+        }
+        // Resetting drops the old values, which can recycle other instances into the pool first.
+        instance->slots.assign(templateSlots.begin(), templateSlots.end());
+        instance->shape = templateShape;
+        if (pool.size() >= poolCapacity) {
+            delete instance;
+            return;
+        }
+        pool.push_back(instance);
+        if (pool.size() > pooling.highWater) {
+            pooling.highWater = pool.size();
+        }
+    }
+    void freeInstance(Object* instance) {
+        InstanceObject* object = static_cast<InstanceObject*>(instance);
+        if (!object->pooled) {
+            delete object;
+            return;
+        }
+        object->classType->recycle(object);
+    }
+
+    const Shape* Shape::with(Symbols::SymbolId id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Shape>& next = transitions[id];
+        if (!next) {
+            next = std::make_unique<Shape>();
+            next->names = names;
+            next->names.push_back(id);
+            next->slots = slots;
+            next->slots.emplace(id, static_cast<uint32_t>(names.size()));
+        }
+        return next.get();
+    }
+    void InstanceObject::set(Symbols::SymbolId id, const Data& value) {
+        if (Var* property = find(id)) {
+            property->data = value;
+            return;
+        }
+        shape = shape->with(id);
+        slots.emplace_back(value);
+    }
+
+    namespace {
+        void traceValue(const Data& value, std::vector<TracedObject*>& children) {
+            if (value.is(Type::Array) || value.is(Type::Dict) || value.is(Type::ClassInstance)) {
+                children.push_back(static_cast<TracedObject*>(value.object));
+            }
+        }
+    }
+    void ArrayObject::trace(std::vector<TracedObject*>& children) const {
+        for (const Var& item : items) {
+            traceValue(item.data, children);
+        }
+    }
+    void ArrayObject::clearReferences() {
+        items.clear();
+    }
+    // Keys are primitives and never point to traced objects.
+    void DictObject::trace(std::vector<TracedObject*>& children) const {
+        for (const auto& [key, value] : entries) {
+            traceValue(value.data, children);
+        }
+    }
+    void DictObject::clearReferences() {
+        entries.clear();
+    }
+    void InstanceObject::trace(std::vector<TracedObject*>& children) const {
+        for (const Var& slot : slots) {
+            traceValue(slot.data, children);
+        }
+    }
+    void InstanceObject::clearReferences() {
+        slots.clear();
+    }
+
+    TypeRegistry::TypeRegistry() {
+        static NullClassType nullType;
+        static BoolClassType boolType;
+        static IntClassType intType;
+        static FloatClassType floatType;
+        static DoubleClassType doubleType;
+        static StringClassType stringType;
+        static ArrayClassType arrayType;
+        static DictClassType dictType;
+        builtins = {&nullType, &boolType, &intType, &floatType, &doubleType, &stringType, &arrayType, &dictType};
+        for (TypeId id = 0; id < builtinTypeCount; id++) {
+            builtins[id]->id = id;
+            builtinNames.emplace(Symbols::intern(builtins[id]->name), id);
+        }
+    }
+    // Never destroyed, so classes held by statics can still unregister themselves at exit.
+    TypeRegistry& TypeRegistry::instance() {
+        static TypeRegistry* registry = new TypeRegistry();
+        return *registry;
+    }
+    TypeId TypeRegistry::find(Symbols::SymbolId name) const {
+        auto it = builtinNames.find(name);
+        return it == builtinNames.end() ? noType : it->second;
+    }
+    Class& TypeRegistry::get(TypeId id) const {
+        if (id < builtinTypeCount) {
+            return *builtins[id];
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id - builtinTypeCount >= users.size() || !users[id - builtinTypeCount]) {
+            throw std::runtime_error("Unknown type id " + std::to_string(id) + ".");
+        }
+        return *users[id - builtinTypeCount];
+    }
+    TypeId TypeRegistry::add(Class& classType) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (classType.id == noType) {
+            classType.id = builtinTypeCount + static_cast<TypeId>(users.size());
+            users.push_back(&classType);
+        }
+        return classType.id;
+    }
+    void TypeRegistry::remove(Class& classType) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (classType.id - builtinTypeCount < users.size() && users[classType.id - builtinTypeCount] == &classType) {
+            users[classType.id - builtinTypeCount] = nullptr;
+        }
+    }
+    std::size_t TypeRegistry::size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return builtinTypeCount + users.size();
+    }
+    TypeId typeIdOf(const Data& value) {
+        switch (value.type) {
+            case Type::Function:
+            case Type::TypedArray: return noType;
+            case Type::ClassInstance: return static_cast<InstanceObject*>(value.object)->classType->id;
+            default: return static_cast<TypeId>(value.type);
+        }
+    }
+
+    ClassInstance::ClassInstance(Class& c) : Data(Type::ClassInstance, c.makeInstance()) {}
+    Var ClassInstance::getProperty(const Primitive& label) {
+        return getProperty(Symbols::intern(label.asString()));
+    }
+    Var ClassInstance::getProperty(Symbols::SymbolId id) {
+        return instanceProperty(get(), id);
+    }
+}
@@ -0,0 +1,192 @@
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "../../head/lang/GarbageCollector.h"
+
+using DataTypes::TracedObject;
+
+namespace GarbageCollector {
+    namespace {
+        struct Generation {
+            TracedObject* head = nullptr;
+            std::size_t size = 0;
+
+            void link(TracedObject* object) {
+                object->previous = nullptr;
+                object->next = head;
+                if (head) {
+                    head->previous = object;
+                }
+                head = object;
+                size++;
+            }
+            void unlink(TracedObject* object) {
+                if (object->previous) {
+                    object->previous->next = object->next;
+                } else {
+                    head = object->next;
+                }
+                if (object->next) {
+                    object->next->previous = object->previous;
+                }
+                size--;
+            }
+        };
+        struct Heap {
+            std::mutex mutex; // Guards the generations, objects can be made while other threads parse
+            Generation young;
+            Generation old;
+            std::size_t youngLimit = 4096;
+            std::size_t promoted = 0; // Objects moved to the old generation since it was last collected
+            bool collecting = false;
+            Stats stats{};
+
+            Generation& of(const TracedObject* object) {
+                return object->generation ? old : young;
+            }
+        };
+        // Never destroyed, so objects held by statics can still unlink themselves at exit.
+        Heap& heap() {
+            static Heap* instance = new Heap();
+            return *instance;
+        }
+
+        // Finds the unreachable objects of `set`, which are retained once so freeing one cannot free another
+        // before its turn. With `promote` the reachable ones move to the old generation.
+        std::vector<TracedObject*> findGarbage(Heap& heap, Generation& set, bool promote) {
+            std::vector<TracedObject*> children;
+            for (TracedObject* object = set.head; object; object = object->next) {
+                object->collectorReferences = object->references;
+                object->collecting = true;
+                object->reachable = false;
+            }
+            // Take away the references that come from inside the set; what is left comes from outside.
+            for (TracedObject* object = set.head; object; object = object->next) {
+                children.clear();
+                object->trace(children);
+                for (TracedObject* child : children) {
+                    if (child->collecting) {
+                        child->collectorReferences--;
+                    }
+                }
+            }
+            // Objects referenced from outside are live, and so are objects no value points to yet: counting frees
+            // anything whose last reference is dropped, so those are still being made.
+            std::vector<TracedObject*> pending;
+            for (TracedObject* object = set.head; object; object = object->next) {
+                if (object->collectorReferences > 0 || object->references == 0) {
+                    object->reachable = true;
+                    pending.push_back(object);
+                }
+            }
+            while (!pending.empty()) {
+                TracedObject* object = pending.back();
+                pending.pop_back();
+                children.clear();
+                object->trace(children);
+                for (TracedObject* child : children) {
+                    if (child->collecting && !child->reachable) {
+                        child->reachable = true;
+                        pending.push_back(child);
+                    }
+                }
+            }
+            std::vector<TracedObject*> garbage;
+            for (TracedObject* object = set.head, *next; object; object = next) {
+                next = object->next;
+                object->collecting = false;
+                if (!object->reachable) {
+                    object->references++;
+                    garbage.push_back(object);
+                } else if (promote) {
+                    set.unlink(object);
+                    heap.old.link(object);
+                    object->generation = 1;
+                    heap.promoted++;
+                }
+            }
+            return garbage;
+        }
+    }
+
+    std::size_t collect(bool full) {
+        Heap& heap = GarbageCollector::heap();
+        auto start = std::chrono::steady_clock::now();
+        std::vector<TracedObject*> garbage;
+        {
+            std::lock_guard<std::mutex> lock(heap.mutex);
+            if (heap.collecting) {
+                return 0;
+            }
+            heap.collecting = true;
+            if (full) {
+                while (TracedObject* object = heap.young.head) {
+                    heap.young.unlink(object);
+                    heap.old.link(object);
+                    object->generation = 1;
+                }
+                heap.promoted = 0;
+                garbage = findGarbage(heap, heap.old, false);
+            } else {
+                garbage = findGarbage(heap, heap.young, true);
+            }
+        }
+        // Freeing runs destructors, which unlink the objects, so it happens outside the lock.
+        for (TracedObject* object : garbage) {
+            object->clearReferences();
+        }
+        for (TracedObject* object : garbage) {
+            if (--object->references == 0) {
+                delete object;
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(heap.mutex);
+        heap.collecting = false;
+        (full ? heap.stats.fullCollections : heap.stats.youngCollections)++;
+        heap.stats.freed += garbage.size();
+        heap.stats.lastPauseMs = ms;
+        heap.stats.totalPauseMs += ms;
+        if (ms > heap.stats.longestPauseMs) {
+            heap.stats.longestPauseMs = ms;
+        }
+        return garbage.size();
+    }
+    Stats stats() {
+        Heap& heap = GarbageCollector::heap();
+        std::lock_guard<std::mutex> lock(heap.mutex);
+        Stats stats = heap.stats;
+        stats.youngObjects = heap.young.size;
+        stats.oldObjects = heap.old.size;
+        return stats;
+    }
+    void setYoungLimit(std::size_t objects) {
+        Heap& heap = GarbageCollector::heap();
+        std::lock_guard<std::mutex> lock(heap.mutex);
+        heap.youngLimit = objects;
+    }
+}
+
+namespace DataTypes {
+    TracedObject::TracedObject() {
+        GarbageCollector::Heap& heap = GarbageCollector::heap();
+        bool due = false;
+        bool full = false;
+        {
+            std::lock_guard<std::mutex> lock(heap.mutex);
+            due = heap.youngLimit != 0 && heap.young.size >= heap.youngLimit && !heap.collecting;
+            full = heap.promoted > heap.old.size / 4;
+        }
+        // Collect before this object is linked, so it is never part of the collection it started.
+        if (due) {
+            GarbageCollector::collect(full);
+        }
+        std::lock_guard<std::mutex> lock(heap.mutex);
+        heap.young.link(this);
+    }
+    TracedObject::~TracedObject() {
+        GarbageCollector::Heap& heap = GarbageCollector::heap();
+        std::lock_guard<std::mutex> lock(heap.mutex);
+        heap.of(this).unlink(this);
+    }
+}
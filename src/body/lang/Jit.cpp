@@ -0,0 +1,534 @@
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include "../../head/lang/Jit.h"
+#if JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using DataTypes::Data;
+using DataTypes::Type;
+using Bytecode::Op;
+
+namespace Jit {
+    Code::~Code() {
+#if JIT_X86_64
+        if (memory) {
+            munmap(memory, mapped);
+        }
+#endif
+    }
+
+    namespace {
+        // Rebuilds a value from its raw register.
+        Data materialize(Type type, uint64_t raw) {
+            switch (type) {
+                case Type::Bool: return DataTypes::Bool(raw != 0);
+                case Type::Int: return DataTypes::Int(static_cast<int>(static_cast<uint32_t>(raw)));
+                case Type::Double: {
+                    double value;
+                    std::memcpy(&value, &raw, sizeof(value));
+                    return DataTypes::Double(value);
+                }
+                default: return DataTypes::Null();
+            }
+        }
+    }
+
+    bool run(Bytecode::Chunk& chunk, Bytecode::VM& vm) {
+        if (!supported || chunk.interpretOnly) {
+            return false;
+        }
+        if (!chunk.native) {
+            if (++chunk.runs < hotThreshold) {
+                return false;
+            }
+            chunk.native = compile(chunk);
+            if (!chunk.native) {
+                chunk.interpretOnly = true;
+                stats.rejected++;
+                return false;
+            }
+            stats.compiled++;
+        }
+        std::shared_ptr<Code> code = chunk.native; // Kept alive if the chunk drops it during the run
+        uint32_t exit = code->entry(code->frame.data(), code->slots.data());
+        if (exit == 0) {
+            return true;
+        }
+        if (exit == 1) {
+            // A variable changed type since the code was compiled. Nothing ran, the interpreter does the run.
+            stats.guardFailures++;
+            chunk.native.reset();
+            chunk.runs = 0;
+            if (++chunk.recompiles > recompileLimit) {
+                chunk.interpretOnly = true;
+            }
+            return false;
+        }
+        const DeoptPoint& point = code->deopts[exit - 1];
+        std::vector<Data> live;
+        live.reserve(point.registers.size());
+        for (std::size_t r = 0; r < point.registers.size(); r++) {
+            live.push_back(materialize(point.registers[r], code->frame[r]));
+        }
+        stats.deopts++;
+        vm.resume(chunk, point.pc, live);
+        return true;
+    }
+
+#if !JIT_X86_64
+    std::shared_ptr<Code> compile(Bytecode::Chunk& chunk) {
+        return nullptr;
+    }
+#else
+    namespace {
+        // Just enough of an x86-64 encoder for the code below. Registers of the bytecode live in the frame
+        // array at rdi, the slot table is at rsi. eax/ecx/edx and xmm0/xmm1 are scratch.
+        class Assembler {
+            public:
+                std::vector<uint8_t> bytes;
+
+                void emit(std::initializer_list<uint8_t> code) {
+                    bytes.insert(bytes.end(), code);
+                }
+                void u32(uint32_t value) {
+                    for (int i = 0; i < 4; i++) {
+                        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+                    }
+                }
+                void u64(uint64_t value) {
+                    for (int i = 0; i < 8; i++) {
+                        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+                    }
+                }
+                static uint32_t offset(Bytecode::Register r) {
+                    return 8u * r;
+                }
+
+                // Frame access. `reg` is 0 for eax/rax/xmm0 and 1 for ecx/rcx/xmm1.
+                void load32(uint8_t reg, Bytecode::Register r) { // mov e?x, [rdi + 8r]
+                    emit({0x8B, static_cast<uint8_t>(0x87 | (reg << 3))});
+                    u32(offset(r));
+                }
+                void load64(uint8_t reg, Bytecode::Register r) { // mov r?x, [rdi + 8r]
+                    emit({0x48, 0x8B, static_cast<uint8_t>(0x87 | (reg << 3))});
+                    u32(offset(r));
+                }
+                void store64(Bytecode::Register r) { // mov [rdi + 8r], rax
+                    emit({0x48, 0x89, 0x87});
+                    u32(offset(r));
+                }
+                void loadDouble(uint8_t xmm, Bytecode::Register r) { // movsd xmm?, [rdi + 8r]
+                    emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x87 | (xmm << 3))});
+                    u32(offset(r));
+                }
+                void convertInt(uint8_t xmm, Bytecode::Register r) { // cvtsi2sd xmm?, dword [rdi + 8r]
+                    emit({0xF2, 0x0F, 0x2A, static_cast<uint8_t>(0x87 | (xmm << 3))});
+                    u32(offset(r));
+                }
+                void storeDouble(Bytecode::Register r) { // movsd [rdi + 8r], xmm0
+                    emit({0xF2, 0x0F, 0x11, 0x87});
+                    u32(offset(r));
+                }
+                void slotAddress(uint16_t slot) { // mov rax, [rsi + 8slot]
+                    emit({0x48, 0x8B, 0x86});
+                    u32(8u * slot);
+                }
+                // setcc al, then movzx eax, al
+                void setFlag(uint8_t condition) {
+                    emit({0x0F, condition, 0xC0, 0x0F, 0xB6, 0xC0});
+                }
+                // Conditional or plain jump with a 32-bit displacement. Returns where the displacement goes.
+                std::size_t jump(uint8_t condition = 0) {
+                    if (condition) {
+                        emit({0x0F, condition});
+                    } else {
+                        emit({0xE9});
+                    }
+                    u32(0);
+                    return bytes.size() - 4;
+                }
+                void patch(std::size_t at, std::size_t target) {
+                    uint32_t displacement = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+                    std::memcpy(&bytes[at], &displacement, 4);
+                }
+        };
+
+        // Condition codes, as the second byte of setcc (0F 9x). Jcc is the same minus 0x10.
+        enum Condition : uint8_t {
+            Below = 0x92, AboveEqual = 0x93, Equal = 0x94, NotEqual = 0x95, Above = 0x97,
+            Parity = 0x9A, NoParity = 0x9B, Less = 0x9C, GreaterEqual = 0x9D, LessEqual = 0x9E, Greater = 0x9F,
+        };
+        constexpr uint8_t jcc(Condition condition) {
+            return static_cast<uint8_t>(condition - 0x10);
+        }
+
+        bool integral(Type type) {
+            return type == Type::Bool || type == Type::Int;
+        }
+        bool numeric(Type type) {
+            return integral(type) || type == Type::Double;
+        }
+
+        // The result type of a binary instruction on these operand types, or Null where the JIT does not follow
+        // the operator engine (strings, floats, double modulo, bool equality with other numbers).
+        Type resultType(Op op, Type left, Type right) {
+            if (!numeric(left) || !numeric(right)) {
+                return Type::Null;
+            }
+            bool bothIntegral = integral(left) && integral(right);
+            switch (op) {
+                case Op::Add:
+                case Op::Subtract:
+                case Op::Multiply:
+                case Op::Divide:
+                    return bothIntegral ? Type::Int : Type::Double;
+                case Op::Modulo:
+                case Op::BitAnd:
+                case Op::BitOr:
+                case Op::BitXor:
+                case Op::ShiftLeft:
+                case Op::ShiftRight:
+                    return bothIntegral ? Type::Int : Type::Null;
+                case Op::Equal:
+                case Op::NotEqual:
+                    return (left == Type::Bool) == (right == Type::Bool) ? Type::Bool : Type::Null;
+                case Op::Less:
+                case Op::Greater:
+                case Op::LessEqual:
+                case Op::GreaterEqual:
+                    return Type::Bool;
+                case Op::And:
+                case Op::Or:
+                    return bothIntegral ? Type::Bool : Type::Null;
+                default:
+                    return Type::Null;
+            }
+        }
+
+        class Translator {
+            public:
+                Bytecode::Chunk& chunk;
+                Code& code;
+                Assembler a;
+                std::vector<Type> types; // Register types at the current instruction, Null when not known
+                std::vector<std::size_t> starts; // Native offset of each instruction
+                std::vector<std::pair<std::size_t, std::size_t>> jumps; // (displacement, target instruction)
+                std::vector<std::pair<std::size_t, std::size_t>> exits; // (displacement, deopt point)
+
+                Translator(Bytecode::Chunk& c, Code& out)
+                    : chunk(c), code(out), types(c.registerCount, Type::Null) {}
+
+                bool translate() {
+                    if (!bindSlots()) {
+                        return false;
+                    }
+                    code.deopts.push_back(DeoptPoint{0, {}});
+                    guardSlots();
+                    // Jumps only go forward and registers do not live across statements, so one pass in order
+                    // sees every register written before it is read. Jump targets start with nothing known.
+                    std::vector<bool> targets(chunk.code.size() + 1, false);
+                    for (std::size_t pc = 0; pc < chunk.code.size(); pc++) {
+                        Op op = Bytecode::opOf(chunk.code[pc]);
+                        if (op == Op::Jump || op == Op::JumpIfFalse) {
+                            long target = static_cast<long>(pc) + 1 + Bytecode::argSBx(chunk.code[pc]);
+                            if (target <= static_cast<long>(pc) || target > static_cast<long>(chunk.code.size())) {
+                                return false;
+                            }
+                            targets[target] = true;
+                        }
+                    }
+                    for (std::size_t pc = 0; pc < chunk.code.size(); pc++) {
+                        if (targets[pc]) {
+                            std::fill(types.begin(), types.end(), Type::Null);
+                        }
+                        starts.push_back(a.bytes.size());
+                        if (!instruction(pc, chunk.code[pc])) {
+                            return false;
+                        }
+                    }
+                    starts.push_back(a.bytes.size());
+                    for (const auto& [at, target] : jumps) {
+                        a.patch(at, starts[target]);
+                    }
+                    // Exit stubs: eax = 1 + deopt point, then back to the caller.
+                    std::vector<std::size_t> stubs;
+                    for (std::size_t point = 0; point < code.deopts.size(); point++) {
+                        stubs.push_back(a.bytes.size());
+                        a.emit({0xB8});
+                        a.u32(static_cast<uint32_t>(point + 1));
+                        a.emit({0xC3});
+                    }
+                    for (const auto& [at, point] : exits) {
+                        a.patch(at, stubs[point]);
+                    }
+                    return true;
+                }
+
+            private:
+                // Every slot must already have its variable, with a type the JIT compiles for.
+                bool bindSlots() {
+                    for (Nodes::VariableSlot& slot : chunk.slots) {
+                        if (!slot.var) {
+                            slot.var = slot.find();
+                        }
+                        if (!slot.var || !numeric(slot.var->data.type)) {
+                            return false;
+                        }
+                        code.slots.push_back(&slot.var->data);
+                        code.slotTypes.push_back(slot.var->data.type);
+                    }
+                    return true;
+                }
+                // cmp byte [rax], type / jne entry exit, for every slot
+                void guardSlots() {
+                    for (std::size_t s = 0; s < code.slots.size(); s++) {
+                        a.slotAddress(static_cast<uint16_t>(s));
+                        a.emit({0x80, 0x38, static_cast<uint8_t>(code.slotTypes[s])});
+                        exits.emplace_back(a.jump(jcc(NotEqual)), 0);
+                    }
+                }
+                std::size_t deoptPoint(std::size_t pc) {
+                    code.deopts.push_back(DeoptPoint{pc, types});
+                    return code.deopts.size() - 1;
+                }
+
+                // Loads an operand into xmm0 or xmm1 as a double.
+                void loadAsDouble(uint8_t xmm, Bytecode::Register r) {
+                    if (types[r] == Type::Double) {
+                        a.loadDouble(xmm, r);
+                    } else {
+                        a.convertInt(xmm, r);
+                    }
+                }
+
+                bool instruction(std::size_t pc, Bytecode::Instruction i) {
+                    Op op = Bytecode::opOf(i);
+                    Bytecode::Register A = Bytecode::argA(i);
+                    Bytecode::Register B = Bytecode::argB(i);
+                    Bytecode::Register C = Bytecode::argC(i);
+                    switch (op) {
+                        case Op::LoadConst: {
+                            const Data& value = chunk.constants[Bytecode::argBx(i)];
+                            uint64_t raw = 0;
+                            if (value.is(Type::Int)) {
+                                raw = static_cast<uint32_t>(value.integer);
+                            } else if (value.is(Type::Bool)) {
+                                raw = value.boolean ? 1 : 0;
+                            } else if (value.is(Type::Double)) {
+                                std::memcpy(&raw, &value.real, sizeof(raw));
+                            } else {
+                                return false;
+                            }
+                            a.emit({0x48, 0xB8}); // mov rax, imm64
+                            a.u64(raw);
+                            a.store64(A);
+                            types[A] = value.type;
+                            return true;
+                        }
+                        case Op::Move:
+                            if (types[B] == Type::Null) {
+                                return false;
+                            }
+                            a.load64(0, B);
+                            a.store64(A);
+                            types[A] = types[B];
+                            return true;
+                        case Op::GetVar: {
+                            uint16_t slot = Bytecode::argBx(i);
+                            a.slotAddress(slot);
+                            a.emit({0x48, 0x8B, 0x40, 0x08}); // mov rax, [rax + 8]
+                            a.store64(A);
+                            types[A] = code.slotTypes[slot];
+                            return true;
+                        }
+                        case Op::SetVar: {
+                            uint16_t slot = Bytecode::argBx(i);
+                            if (types[A] != code.slotTypes[slot]) {
+                                return false; // The variable would change type, which the guards do not cover
+                            }
+                            a.load64(1, A);
+                            a.slotAddress(slot);
+                            a.emit({0x48, 0x89, 0x48, 0x08}); // mov [rax + 8], rcx
+                            return true;
+                        }
+                        case Op::Negate:
+                            if (types[B] == Type::Int) {
+                                a.load32(0, B);
+                                a.emit({0xF7, 0xD8}); // neg eax
+                            } else if (types[B] == Type::Double) {
+                                a.load64(0, B);
+                                a.emit({0x48, 0x0F, 0xBA, 0xF8, 0x3F}); // btc rax, 63
+                            } else {
+                                return false;
+                            }
+                            a.store64(A);
+                            types[A] = types[B];
+                            return true;
+                        case Op::Not:
+                            if (!integral(types[B])) {
+                                return false;
+                            }
+                            a.load32(0, B);
+                            a.emit({0x85, 0xC0}); // test eax, eax
+                            a.setFlag(Equal);
+                            a.store64(A);
+                            types[A] = Type::Bool;
+                            return true;
+                        case Op::BitNot:
+                            if (!integral(types[B])) {
+                                return false;
+                            }
+                            a.load32(0, B);
+                            a.emit({0xF7, 0xD0}); // not eax
+                            a.store64(A);
+                            types[A] = Type::Int;
+                            return true;
+                        case Op::Jump:
+                            jumps.emplace_back(a.jump(), pc + 1 + Bytecode::argSBx(i));
+                            return true;
+                        case Op::JumpIfFalse:
+                            if (!integral(types[A])) {
+                                return false;
+                            }
+                            a.load32(0, A);
+                            a.emit({0x85, 0xC0}); // test eax, eax
+                            jumps.emplace_back(a.jump(jcc(Equal)), pc + 1 + Bytecode::argSBx(i));
+                            return true;
+                        case Op::Return:
+                            a.emit({0x31, 0xC0, 0xC3}); // xor eax, eax / ret
+                            return true;
+                        case Op::NewArray:
+                        case Op::NewDict:
+                        case Op::Evaluate:
+                            return false;
+                        default:
+                            return binary(pc, op, A, B, C);
+                    }
+                }
+
+                bool binary(std::size_t pc, Op op, Bytecode::Register A, Bytecode::Register B, Bytecode::Register C) {
+                    Type result = resultType(op, types[B], types[C]);
+                    if (result == Type::Null) {
+                        return false;
+                    }
+                    bool floating = types[B] == Type::Double || types[C] == Type::Double;
+                    if (floating) {
+                        loadAsDouble(0, B);
+                        loadAsDouble(1, C);
+                        switch (op) {
+                            case Op::Add: a.emit({0xF2, 0x0F, 0x58, 0xC1}); break; // addsd xmm0, xmm1
+                            case Op::Subtract: a.emit({0xF2, 0x0F, 0x5C, 0xC1}); break;
+                            case Op::Multiply: a.emit({0xF2, 0x0F, 0x59, 0xC1}); break;
+                            case Op::Divide: a.emit({0xF2, 0x0F, 0x5E, 0xC1}); break;
+                            default:
+                                compareDoubles(op);
+                                a.store64(A);
+                                types[A] = Type::Bool;
+                                return true;
+                        }
+                        a.storeDouble(A);
+                        types[A] = Type::Double;
+                        return true;
+                    }
+                    a.load32(0, B);
+                    a.load32(1, C);
+                    switch (op) {
+                        case Op::Add: a.emit({0x01, 0xC8}); break; // add eax, ecx
+                        case Op::Subtract: a.emit({0x29, 0xC8}); break;
+                        case Op::Multiply: a.emit({0x0F, 0xAF, 0xC1}); break; // imul eax, ecx
+                        case Op::BitAnd: a.emit({0x21, 0xC8}); break;
+                        case Op::BitOr: a.emit({0x09, 0xC8}); break;
+                        case Op::BitXor: a.emit({0x31, 0xC8}); break;
+                        case Op::ShiftLeft: a.emit({0xD3, 0xE0}); break; // shl eax, cl, which masks the count to 5 bits
+                        case Op::ShiftRight: a.emit({0xD3, 0xF8}); break; // sar eax, cl
+                        case Op::Divide:
+                        case Op::Modulo: {
+                            // idiv faults on 0 and on INT_MIN / -1, the interpreter handles both divisors.
+                            std::size_t point = deoptPoint(pc);
+                            a.emit({0x85, 0xC9}); // test ecx, ecx
+                            exits.emplace_back(a.jump(jcc(Equal)), point);
+                            a.emit({0x83, 0xF9, 0xFF}); // cmp ecx, -1
+                            exits.emplace_back(a.jump(jcc(Equal)), point);
+                            a.emit({0x99, 0xF7, 0xF9}); // cdq / idiv ecx
+                            if (op == Op::Modulo) {
+                                a.emit({0x89, 0xD0}); // mov eax, edx
+                            }
+                            break;
+                        }
+                        case Op::And:
+                        case Op::Or:
+                            a.emit({0x85, 0xC0, 0x0F, Condition::NotEqual, 0xC0}); // test eax, eax / setne al
+                            a.emit({0x85, 0xC9, 0x0F, Condition::NotEqual, 0xC1}); // test ecx, ecx / setne cl
+                            a.emit({static_cast<uint8_t>(op == Op::And ? 0x20 : 0x08), 0xC8}); // and/or al, cl
+                            a.emit({0x0F, 0xB6, 0xC0}); // movzx eax, al
+                            break;
+                        default:
+                            a.emit({0x39, 0xC8}); // cmp eax, ecx
+                            a.setFlag(op == Op::Equal ? Equal : op == Op::NotEqual ? NotEqual : op == Op::Less ? Less
+                                : op == Op::Greater ? Greater : op == Op::LessEqual ? LessEqual : GreaterEqual);
+                            break;
+                    }
+                    a.store64(A);
+                    types[A] = result;
+                    return true;
+                }
+
+                // Compares xmm0 with xmm1 into eax. Comparisons with NaN are false, except !=.
+                void compareDoubles(Op op) {
+                    switch (op) {
+                        case Op::Equal:
+                        case Op::NotEqual:
+                            a.emit({0x66, 0x0F, 0x2E, 0xC1}); // ucomisd xmm0, xmm1
+                            if (op == Op::Equal) {
+                                a.emit({0x0F, Condition::Equal, 0xC0, 0x0F, Condition::NoParity, 0xC1, 0x20, 0xC8}); // sete al / setnp cl / and al, cl
+                            } else {
+                                a.emit({0x0F, Condition::NotEqual, 0xC0, 0x0F, Condition::Parity, 0xC1, 0x08, 0xC8}); // setne al / setp cl / or al, cl
+                            }
+                            a.emit({0x0F, 0xB6, 0xC0});
+                            return;
+                        case Op::Greater:
+                        case Op::GreaterEqual:
+                            a.emit({0x66, 0x0F, 0x2E, 0xC1}); // ucomisd xmm0, xmm1
+                            a.setFlag(op == Op::Greater ? Above : AboveEqual);
+                            return;
+                        default: // Less and LessEqual, as xmm1 > xmm0 so that NaN is false
+                            a.emit({0x66, 0x0F, 0x2E, 0xC8}); // ucomisd xmm1, xmm0
+                            a.setFlag(op == Op::Less ? Above : AboveEqual);
+                            return;
+                    }
+                }
+        };
+    }
+
+    std::shared_ptr<Code> compile(Bytecode::Chunk& chunk) {
+        auto code = std::make_shared<Code>();
+        Translator translator(chunk, *code);
+        if (!translator.translate()) {
+            return nullptr;
+        }
+        const std::vector<uint8_t>& bytes = translator.a.bytes;
+        std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t mapped = (bytes.size() + page - 1) / page * page;
+        // Written while the pages are writable, then switched to executable: never both at once.
+        void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return nullptr;
+        }
+        std::memcpy(memory, bytes.data(), bytes.size());
+        if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+            munmap(memory, mapped);
+            return nullptr;
+        }
+        code->memory = memory;
+        code->mapped = mapped;
+        code->length = bytes.size();
+        code->entry = reinterpret_cast<Code::Entry>(memory);
+        code->frame.assign(chunk.registerCount, 0);
+        return code;
+    }
+#endif
+}
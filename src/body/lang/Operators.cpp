@@ -0,0 +1,183 @@
+#include <string>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include "../../head/lang/Operators.h"
+
+using DataTypes::Data;
+using DataTypes::Type;
+
+namespace Operators {
+    namespace {
+        using namespace Kernels;
+
+        // Table construction
+
+        constexpr std::size_t index(Opcode op) {
+            return static_cast<std::size_t>(op);
+        }
+        constexpr std::size_t index(UnaryOpcode op) {
+            return static_cast<std::size_t>(op);
+        }
+        constexpr std::size_t index(Type type) {
+            return static_cast<std::size_t>(type);
+        }
+
+        template<typename Op, Type L, Type... Rs>
+        constexpr void fillRow(Table& table) {
+            ((table.binary[index(Op::code)][index(L)][index(Rs)] = &numeric<Op, L, Rs>), ...);
+        }
+        // Every ordered pair of the given numeric types.
+        template<typename Op, Type... Ts>
+        struct Pairs {
+            template<Type L>
+            static constexpr void row(Table& table) {
+                fillRow<Op, L, Ts...>(table);
+            }
+            static constexpr void fill(Table& table) {
+                (row<Ts>(table), ...);
+            }
+        };
+        template<typename Op>
+        constexpr void fillArithmetic(Table& table) {
+            Pairs<Op, Type::Bool, Type::Int, Type::Float, Type::Double>::fill(table);
+        }
+        template<typename Op>
+        constexpr void fillIntegral(Table& table) {
+            Pairs<Op, Type::Bool, Type::Int>::fill(table);
+        }
+        template<typename Op>
+        constexpr void fillRelational(Table& table) {
+            fillArithmetic<Op>(table);
+            table.binary[index(Op::code)][index(Type::String)][index(Type::String)] = &compareStrings<Op>;
+        }
+        template<typename Op>
+        constexpr void fillEquality(Table& table, Kernel fallback) {
+            for (std::size_t left = 0; left < typeCount; left++) {
+                for (std::size_t right = 0; right < typeCount; right++) {
+                    table.binary[index(Op::code)][left][right] = fallback;
+                }
+            }
+            // Bools only equal bools, so they are left to the fallback when mixed with other numbers.
+            Pairs<Op, Type::Int, Type::Float, Type::Double>::fill(table);
+            table.binary[index(Op::code)][index(Type::Bool)][index(Type::Bool)] = &numeric<Op, Type::Bool, Type::Bool>;
+        }
+        template<typename Op>
+        constexpr void fillLogical(Table& table) {
+            for (std::size_t left = 0; left < typeCount; left++) {
+                for (std::size_t right = 0; right < typeCount; right++) {
+                    table.binary[index(Op::code)][left][right] = &logical<Op>;
+                }
+            }
+        }
+
+        constexpr Table build() {
+            Table table{};
+            fillArithmetic<Add>(table);
+            table.binary[index(Opcode::Add)][index(Type::String)][index(Type::String)] = &concatenate;
+            fillArithmetic<Subtract>(table);
+            fillArithmetic<Multiply>(table);
+            fillArithmetic<Divide>(table);
+            fillArithmetic<Modulo>(table);
+            fillIntegral<BitAnd>(table);
+            fillIntegral<BitOr>(table);
+            fillIntegral<BitXor>(table);
+            fillIntegral<ShiftLeft>(table);
+            fillIntegral<ShiftRight>(table);
+            fillEquality<Equal>(table, &equal);
+            fillEquality<NotEqual>(table, &notEqual);
+            fillRelational<Less>(table);
+            fillRelational<Greater>(table);
+            fillRelational<LessEqual>(table);
+            fillRelational<GreaterEqual>(table);
+            fillLogical<And>(table);
+            fillLogical<Or>(table);
+
+            table.unary[index(UnaryOpcode::Negate)][index(Type::Int)] = &negate<Type::Int>;
+            table.unary[index(UnaryOpcode::Negate)][index(Type::Float)] = &negate<Type::Float>;
+            table.unary[index(UnaryOpcode::Negate)][index(Type::Double)] = &negate<Type::Double>;
+            for (std::size_t operand = 0; operand < typeCount; operand++) {
+                table.unary[index(UnaryOpcode::Not)][operand] = &logicalNot;
+            }
+            table.unary[index(UnaryOpcode::BitNot)][index(Type::Bool)] = &bitNot<Type::Bool>;
+            table.unary[index(UnaryOpcode::BitNot)][index(Type::Int)] = &bitNot<Type::Int>;
+            return table;
+        }
+    }
+
+    // Built at compile time, so the table is ready before any static initializer can evaluate a script.
+    constexpr Table table = build();
+
+    const char* symbol(Opcode op) {
+        switch (op) {
+            case Opcode::Add: return "+";
+            case Opcode::Subtract: return "-";
+            case Opcode::Multiply: return "*";
+            case Opcode::Divide: return "/";
+            case Opcode::Modulo: return "%";
+            case Opcode::BitAnd: return "&";
+            case Opcode::BitOr: return "|";
+            case Opcode::BitXor: return "^";
+            case Opcode::ShiftLeft: return "<<";
+            case Opcode::ShiftRight: return ">>";
+            case Opcode::Equal: return "==";
+            case Opcode::NotEqual: return "!=";
+            case Opcode::Less: return "<";
+            case Opcode::Greater: return ">";
+            case Opcode::LessEqual: return "<=";
+            case Opcode::GreaterEqual: return ">=";
+            case Opcode::And: return "&&";
+            case Opcode::Or: return "||";
+        }
+        return "?";
+    }
+    const char* symbol(UnaryOpcode op) {
+        switch (op) {
+            case UnaryOpcode::Negate: return "-";
+            case UnaryOpcode::Not: return "!";
+            case UnaryOpcode::BitNot: return "~";
+        }
+        return "?";
+    }
+
+    Opcode binaryOpcode(Tokens::TokenKind kind) {
+        switch (kind) {
+            case Tokens::TokenKind::Plus: return Opcode::Add;
+            case Tokens::TokenKind::Minus: return Opcode::Subtract;
+            case Tokens::TokenKind::Star: return Opcode::Multiply;
+            case Tokens::TokenKind::Slash: return Opcode::Divide;
+            case Tokens::TokenKind::Percent: return Opcode::Modulo;
+            case Tokens::TokenKind::Ampersand: return Opcode::BitAnd;
+            case Tokens::TokenKind::Pipe: return Opcode::BitOr;
+            case Tokens::TokenKind::Caret: return Opcode::BitXor;
+            case Tokens::TokenKind::ShiftLeft: return Opcode::ShiftLeft;
+            case Tokens::TokenKind::ShiftRight: return Opcode::ShiftRight;
+            case Tokens::TokenKind::Equal: return Opcode::Equal;
+            case Tokens::TokenKind::NotEqual: return Opcode::NotEqual;
+            case Tokens::TokenKind::Less: return Opcode::Less;
+            case Tokens::TokenKind::Greater: return Opcode::Greater;
+            case Tokens::TokenKind::LessEqual: return Opcode::LessEqual;
+            case Tokens::TokenKind::GreaterEqual: return Opcode::GreaterEqual;
+            case Tokens::TokenKind::And: return Opcode::And;
+            case Tokens::TokenKind::Or: return Opcode::Or;
+            default: throw std::runtime_error(std::string("Not a binary operator: ") + Tokens::kindName(kind) + ".");
+        }
+    }
+    UnaryOpcode unaryOpcode(Tokens::TokenKind kind) {
+        switch (kind) {
+            case Tokens::TokenKind::Minus: return UnaryOpcode::Negate;
+            case Tokens::TokenKind::Bang: return UnaryOpcode::Not;
+            case Tokens::TokenKind::Tilde: return UnaryOpcode::BitNot;
+            default: throw std::runtime_error(std::string("Not a unary operator: ") + Tokens::kindName(kind) + ".");
+        }
+    }
+
+    void unsupported(Opcode op, const Data& left, const Data& right) {
+        throw std::runtime_error(std::string("Unsupported operand types for ") + symbol(op) + ": "
+            + DataTypes::typeName(left.type) + " and " + DataTypes::typeName(right.type) + ".");
+    }
+    void unsupported(UnaryOpcode op, const Data& operand) {
+        throw std::runtime_error(std::string("Unsupported operand type for ") + symbol(op) + ": "
+            + DataTypes::typeName(operand.type) + ".");
+    }
+}
@@ -1,5 +1,7 @@
 #include <string>
 #include <vector>
+#include <array>
+#include <initializer_list>
 #include <algorithm>
 #include <iostream>
 #include <numeric>
@@ -9,11 +11,23 @@
 #include <memory>
 #include <cassert>
 #include <optional>
+#include <typeinfo>
+#include <fstream>
+#include <cstdio>
 #include <cctype> // for isspace, isalpha, isdigit
 #include "../../head/lang/Processor.h"
+#include "../../head/lang/Tokenizer.h"
+#include "../../head/lang/symbolTable.h"
+#include "../../head/lang/scanner.h"
+#include "../../head/lang/Benchmarks.h"
+#include "../../head/lang/AstCache.h"
+#include "../../head/lang/Operators.h"
+#include "../../head/lang/Bytecode.h"
+#include "../../head/lang/Jit.h"
+#include "../../head/lang/TypedArrays.h"
+#include "../../head/lang/GarbageCollector.h"
 #include "../../head/lang/stringTools.h"
 #include "../../head/color/consoleColors.h"
-#include "../../head/lang/operatorTools.h"
 
 
 namespace ProcessorTests {
@@ -25,6 +39,64 @@ namespace ProcessorTests {
         std::vector<std::string> output = Tokenizer::process(input);
         assertEqual(expectedOutput,output);
     }
+    void testTokenStream() {
+        printf("Testing Token Stream...\n");
+        std::string input = "int a = 5; // This is a comment\nfloat b = 10.5 <= \"str\"; /* Multiline comment */";
+        Tokens::TokenStream stream = Tokenizer::lex(input);
+        std::vector<std::string> expectedText = {"int", "a", "=", "5", ";", "float", "b", "=", "10.5", "<=", "\"str\"", ";"};
+        assertEqual(expectedText, stream.toStrings());
+        std::vector<Tokens::TokenKind> expectedKinds = {
+            Tokens::TokenKind::Identifier, Tokens::TokenKind::Identifier, Tokens::TokenKind::Assign, Tokens::TokenKind::Int, Tokens::TokenKind::Semicolon,
+            Tokens::TokenKind::Identifier, Tokens::TokenKind::Identifier, Tokens::TokenKind::Assign, Tokens::TokenKind::Double, Tokens::TokenKind::LessEqual,
+            Tokens::TokenKind::String, Tokens::TokenKind::Semicolon
+        };
+        bool kindsMatch = stream.size() == expectedKinds.size();
+        for (std::size_t i = 0; kindsMatch && i < expectedKinds.size(); i++) {
+            kindsMatch = stream.tokens[i].kind == expectedKinds[i];
+        }
+        assertEqual(true, kindsMatch);
+        // Literal payloads are parsed by the lexer and tokens point back into the source.
+        assertEqual(int64_t(5), stream.tokens[3].integer);
+        assertEqual(10.5, stream.tokens[8].real);
+        assertEqual(std::string("str"), std::string(stream.tokens[10].stringValue()));
+        assertEqual(true, stream.tokens[1].text.data() == input.data() + stream.tokens[1].offset);
+    }
+    void testSymbolTable() {
+        printf("Testing Symbol Table...\n");
+        Tokens::TokenStream stream = Tokenizer::lex("if (true) while iffy **= null");
+        std::vector<Tokens::TokenKind> expectedKinds = {
+            Tokens::TokenKind::If, Tokens::TokenKind::LeftParen, Tokens::TokenKind::True, Tokens::TokenKind::RightParen,
+            Tokens::TokenKind::While, Tokens::TokenKind::Identifier, Tokens::TokenKind::Power, Tokens::TokenKind::Assign, Tokens::TokenKind::Null
+        };
+        bool kindsMatch = stream.size() == expectedKinds.size();
+        for (std::size_t i = 0; kindsMatch && i < expectedKinds.size(); i++) {
+            kindsMatch = stream.tokens[i].kind == expectedKinds[i];
+        }
+        assertEqual(true, kindsMatch);
+        // Every entry must hash back to itself.
+        bool allFound = true;
+        for (const SymbolTable::Entry& entry : SymbolTable::entries) {
+            allFound = allFound && SymbolTable::lookup(entry.text) == entry.kind;
+        }
+        assertEqual(true, allFound);
+    }
+    void testScanner() {
+        printf("Testing Scanner...\n");
+        // Every vector level must produce exactly the tokens of the scalar scanner.
+        std::string script = ProcessorBenchmarks::generateScript(64 * 1024);
+        Scanner::Level detected = Scanner::detectedLevel();
+        Scanner::setLevel(Scanner::Level::Scalar);
+        std::vector<std::string> expected = Tokenizer::lex(script).toStrings();
+        for (int level = 1; level <= static_cast<int>(detected); level++) {
+            Scanner::setLevel(static_cast<Scanner::Level>(level));
+            assertEqual(expected, Tokenizer::lex(script).toStrings());
+        }
+        Scanner::setLevel(detected);
+        std::string identifier(100, 'a');
+        assertEqual(100, static_cast<int>(Scanner::scanIdentifier(identifier.data(), identifier.data() + identifier.size()) - identifier.data()));
+        std::string comment = std::string(70, ' ') + "*/";
+        assertEqual(70, static_cast<int>(Scanner::findCommentEnd(comment.data(), comment.data() + comment.size()) - comment.data()));
+    }
     template<typename T>
     void assertEqual(const T& expected, const T& actual) {
         if (expected != actual) {
@@ -37,14 +109,14 @@ namespace ProcessorTests {
     // Expression tests
     void testIfStatement() {
         printf("- IfStatement...\n");
-        std::shared_ptr<Nodes::Body> body = std::make_shared<Nodes::Body>();
-        body->setVar("a", DataTypes::Int(5));
+        Nodes::Program program;
+        program.body->setVar("a", DataTypes::Int(5));
         // Add tests for IfStatement and its derived classes
-        std::vector<std::string> tokens = Tokenizer::process("if (a == {5:2,3:1}) { a = 10; }");
+        Tokens::TokenStream tokens = Tokenizer::lex("if (a == {5:2,3:1}) { a = 10; }");
         auto start = tokens.begin();
         auto end = tokens.end();
-        body->process(start, end); // Assuming process is a method that interprets the tokens and populates the body
-        std::cout << toStr(body->toJSON()) << std::endl;
+        program.process(start, end); // Assuming process is a method that interprets the tokens and populates the body
+        std::cout << toStr(program.body->toJSON()) << std::endl;
         ConsoleColors::PrintSuccess("  - IfStatement processed successfully.\n");
     }
     void testElseStatement() {
@@ -52,10 +124,707 @@ namespace ProcessorTests {
         // Add tests for ElseStatement and its derived classes
         ConsoleColors::PrintSuccess("  - ElseStatement processed successfully.\n");
     }
+    void testAstCache() {
+        printf("Testing AST Cache...\n");
+        std::string script = ProcessorBenchmarks::generateScript(16 * 1024) + ProcessorBenchmarks::generateNestedScript(20);
+        std::string path = "ast_cache_test.hypec";
+        Nodes::Program parsed;
+        parsed.process(Tokenizer::lex(script));
+        AstCache::save(parsed, script, path);
+        // A loaded program has the same tree as a parsed one.
+        Nodes::Program loaded;
+        assertEqual(true, AstCache::load(loaded, script, path));
+        assertEqual(toStr(parsed.body->toJSON()), toStr(loaded.body->toJSON()));
+        assertEqual(true, loaded.body->stmts[0]->parent == loaded.body);
+        // Any change to the source invalidates the cache.
+        Nodes::Program stale;
+        assertEqual(false, AstCache::load(stale, script + " ", path));
+        assertEqual(0, static_cast<int>(stale.body->stmts.size()));
+        // So does a cache written by a build with another grammar.
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            uint32_t grammar = AstCache::grammarVersion + 1;
+            file.seekp(offsetof(AstCache::Header, grammar));
+            file.write(reinterpret_cast<const char*>(&grammar), sizeof(grammar));
+        }
+        Nodes::Program otherGrammar;
+        assertEqual(false, AstCache::load(otherGrammar, script, path));
+        std::remove(path.c_str());
+        Nodes::Program missing;
+        assertEqual(false, AstCache::load(missing, script, path));
+    }
+    void testSourceLoader() {
+        printf("Testing Source Loader...\n");
+        std::string script = ProcessorBenchmarks::generateScript(256 * 1024);
+        std::string path = "source_loader_test.hype";
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << script;
+        }
+        std::vector<std::string> expected = Tokenizer::lex(script).toStrings();
+        // Tiny chunks force tokens, comments and strings across chunk boundaries.
+        for (std::size_t chunkSize : {std::size_t(7), std::size_t(4096), Sources::defaultChunkSize}) {
+            Tokens::TokenStream stream = Tokenizer::lexFile(path, chunkSize);
+            assertEqual(expected, stream.toStrings());
+        }
+        std::remove(path.c_str());
+    }
+    void testParallelTokenizer() {
+        printf("Testing Parallel Tokenizer...\n");
+        std::string script = ProcessorBenchmarks::generateScript(512 * 1024) + "last \"string\" /* and comment */";
+        Tokens::TokenStream sequential = Tokenizer::lex(script);
+        // Small chunks force many splits; the output must match the sequential lexer token for token.
+        Tokens::TokenStream parallel = Tokenizer::lexParallel(script, 4, 4096);
+        assertEqual(sequential.toStrings(), parallel.toStrings());
+        bool offsetsMatch = sequential.size() == parallel.size();
+        for (std::size_t i = 0; offsetsMatch && i < sequential.size(); i++) {
+            offsetsMatch = sequential.tokens[i].offset == parallel.tokens[i].offset && sequential.tokens[i].kind == parallel.tokens[i].kind;
+        }
+        assertEqual(true, offsetsMatch);
+        // Splits never land inside strings or comments.
+        std::vector<std::size_t> points = Tokenizer::splitPoints("a\n\"x\ny\"\n/* \n */\nb\n", 8);
+        std::vector<std::size_t> expectedPoints = {0, 8, 16, 18};
+        assertEqual(true, points == expectedPoints);
+    }
+    void testSymbols() {
+        printf("Testing Symbols...\n");
+        Tokens::TokenStream stream = Tokenizer::lex("health = health - damage");
+        // The same identifier always gets the same id, and the id maps back to its text.
+        assertEqual(stream.tokens[0].symbol, stream.tokens[2].symbol);
+        assertEqual(false, stream.tokens[0].symbol == stream.tokens[4].symbol);
+        assertEqual(std::string("damage"), Symbols::toString(stream.tokens[4].symbol));
+        assertEqual(stream.tokens[4].symbol, Symbols::find("damage"));
+        assertEqual(Symbols::none, Symbols::find("never_interned_name"));
+        // Long names get a block of their own; the short names interned after them still go to the shared block.
+        std::string longName(20000, 'q');
+        longName.back() = 'z';
+        Symbols::SymbolId longId = Symbols::intern(longName);
+        std::vector<Symbols::SymbolId> shortIds;
+        for (int i = 0; i < 64; i++) {
+            shortIds.push_back(Symbols::intern("after_long_name_" + std::to_string(i)));
+        }
+        assertEqual(true, Symbols::toString(longId) == longName);
+        assertEqual(longId, Symbols::find(longName));
+        for (int i = 0; i < 64; i++) {
+            assertEqual("after_long_name_" + std::to_string(i), Symbols::toString(shortIds[i]));
+        }
+        // Scopes are keyed by id, the string overload interns once.
+        Nodes::Program program;
+        program.body->setVar("health", DataTypes::Int(5));
+        assertEqual(std::string("int"), std::string(DataTypes::typeName(program.body->getVar(stream.tokens[0].symbol).data.type)));
+    }
+    void testArena() {
+        printf("Testing Arena...\n");
+        Nodes::Program program;
+        program.process(Tokenizer::lex("if (1 + 2) { }"));
+        // Body, IfStatement, StatementCondition, BinaryExpression, two Values and the StatementBlock.
+        assertEqual(7, static_cast<int>(program.arena.objectCount()));
+        assertEqual(true, program.arena.bytesUsed() <= program.arena.bytesReserved());
+        // Children point straight at their parents.
+        assertEqual(1, static_cast<int>(program.body->stmts.size()));
+        assertEqual(true, program.body->stmts[0]->parent == program.body);
+        assertEqual(true, program.body->stmts[0]->expression->parent == program.body->stmts[0]);
+        program.arena.reset();
+        assertEqual(0, static_cast<int>(program.arena.objectCount()));
+        // An oversized allocation gets a block of its own, small ones keep using the current block.
+        Nodes::Arena arena(1024);
+        char* first = static_cast<char*>(arena.allocate(16, 8));
+        arena.allocate(4096, 8);
+        assertEqual(true, arena.allocate(16, 8) == first + 16);
+        assertEqual(true, arena.bytesUsed() >= 4096 + 32 && arena.bytesUsed() <= arena.bytesReserved());
+        // An object whose constructor throws is not registered, the ones before it are still destroyed.
+        static int destroyed = 0;
+        struct Tracked {
+            explicit Tracked(bool fail) {
+                if (fail) {
+                    throw std::runtime_error("constructor failed");
+                }
+            }
+            ~Tracked() {
+                destroyed++;
+            }
+        };
+        arena.make<Tracked>(false);
+        bool rejected = false;
+        try {
+            arena.make<Tracked>(true);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        assertEqual(1, static_cast<int>(arena.objectCount()));
+        arena.reset();
+        assertEqual(1, destroyed);
+    }
+    void testTypeRegistry() {
+        printf("Testing Type Registry...\n");
+        DataTypes::TypeRegistry& registry = DataTypes::TypeRegistry::instance();
+        // Built-in types are shared, blocks start without any class of their own.
+        Nodes::Program program;
+        program.process(Tokenizer::lex("if (a) { b = 1; }"));
+        Nodes::Block* inner = static_cast<Nodes::Statements::IfStatement*>(program.body->stmts[0])->body;
+        assertEqual(true, program.body->classTypes.empty() && inner->classTypes.empty());
+        const DataTypes::Class& dict = inner->getClass(Symbols::intern("dict"));
+        assertEqual(static_cast<DataTypes::TypeId>(DataTypes::Type::Dict), dict.id);
+        assertEqual(true, &dict == &registry.get(registry.find(Symbols::intern("dict"))));
+        // The registry keeps the built-in classes themselves, so instantiate() makes a value of the type.
+        assertEqual(std::string("int"), std::string(DataTypes::typeName(registry.get(registry.find(Symbols::intern("int"))).instantiate().type)));
+        assertEqual(DataTypes::noType, registry.find(Symbols::intern("Enemy")));
+        // User classes get the next ids and are found from nested blocks.
+        static DataTypes::Class enemy("Enemy");
+        static DataTypes::Class boss("Boss");
+        program.body->addClass(enemy);
+        inner->addClass(boss);
+        assertEqual(true, enemy.id >= DataTypes::builtinTypeCount);
+        assertEqual(enemy.id + 1, boss.id);
+        assertEqual(true, &inner->getClass(Symbols::intern("Enemy")) == &enemy);
+        assertEqual(true, &registry.get(boss.id) == &boss);
+        assertEqual(static_cast<DataTypes::TypeId>(DataTypes::Type::Int), DataTypes::typeIdOf(DataTypes::Int(3)));
+        assertEqual(enemy.id, DataTypes::typeIdOf(enemy.instantiate()));
+        bool rejected = false;
+        try {
+            registry.get(static_cast<DataTypes::TypeId>(registry.size()));
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        // A copy is a class of its own, and a destroyed class's id no longer resolves.
+        DataTypes::TypeId copiedId;
+        {
+            DataTypes::Class copy(enemy);
+            assertEqual(DataTypes::noType, copy.id);
+            program.body->addClass(copy);
+            assertEqual(true, copy.id != enemy.id);
+            copiedId = copy.id;
+            assertEqual(copiedId, DataTypes::typeIdOf(copy.instantiate()));
+            program.body->addClass(enemy);
+        }
+        assertEqual(true, &registry.get(enemy.id) == &enemy);
+        rejected = false;
+        try {
+            registry.get(copiedId);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testValues() {
+        printf("Testing Values...\n");
+        // Scalars are stored inline in the tagged union, arithmetic stays in int until a double is involved.
+        assertEqual(16, static_cast<int>(sizeof(DataTypes::Data)));
+        DataTypes::Data sum = DataTypes::Int(7) + DataTypes::Int(5);
+        assertEqual(true, sum.is(DataTypes::Type::Int));
+        assertEqual(12, sum.integer);
+        DataTypes::Data mixed = DataTypes::Int(1) / DataTypes::Double(4.0);
+        assertEqual(true, mixed.is(DataTypes::Type::Double));
+        assertEqual(0.25, mixed.real);
+        assertEqual(1, (DataTypes::Int(7) % DataTypes::Int(3)).integer);
+        assertEqual(true, (DataTypes::Int(2) < DataTypes::Double(2.5)).boolean);
+        assertEqual(std::string("ab"), (DataTypes::String("a") + DataTypes::String("b")).asString());
+        // Heap values are shared, not copied.
+        DataTypes::Array array(DataTypes::ArrayList{DataTypes::Var(DataTypes::Int(1))});
+        DataTypes::Data alias = array;
+        assertEqual(true, alias.object == array.object);
+        assertEqual(2, static_cast<int>(array.object->references));
+        bool rejected = false;
+        try {
+            DataTypes::Int(1) + DataTypes::String("x");
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testCopyOnWrite() {
+        printf("Testing Copy On Write...\n");
+        DataTypes::Array array(DataTypes::ArrayList{DataTypes::Var(DataTypes::Int(1)), DataTypes::Var(DataTypes::Int(2))});
+        DataTypes::Array alias = array;
+        // Reads go to the shared storage.
+        assertEqual(2, array.getProperty(DataTypes::Int(1)).data.integer);
+        assertEqual(true, &alias.items() == &array.items());
+        // Changing a shared array copies it first, the other value keeps the old items.
+        alias.mutableItems().push_back(DataTypes::Var(DataTypes::Int(3)));
+        assertEqual(2, static_cast<int>(array.items().size()));
+        assertEqual(3, static_cast<int>(alias.items().size()));
+        assertEqual(1, static_cast<int>(array.object->references));
+        assertEqual(1, static_cast<int>(alias.object->references));
+        // Once it is not shared it is changed in place.
+        const DataTypes::ArrayList* storage = &alias.items();
+        alias.mutableItems()[0] = DataTypes::Var(DataTypes::Int(9));
+        assertEqual(true, storage == &alias.items());
+        assertEqual(1, array.getProperty(DataTypes::Int(0)).data.integer);
+        // Dicts work the same way.
+        DataTypes::Dict dict(DataTypes::Dictionary{{DataTypes::String("hp"), DataTypes::Var(DataTypes::Int(10))}});
+        DataTypes::Var holder(dict);
+        holder.data.mutableDict()[DataTypes::String("hp")] = DataTypes::Var(DataTypes::Int(5));
+        assertEqual(10, dict.getProperty(DataTypes::String("hp")).data.integer);
+        assertEqual(5, holder.getProperty(DataTypes::String("hp")).data.integer);
+        // Containers nested in a copied container stay shared until they are changed themselves.
+        DataTypes::Array outer(DataTypes::ArrayList{DataTypes::Var(array)});
+        DataTypes::Array copy = outer;
+        copy.mutableItems().push_back(DataTypes::Var(DataTypes::Null()));
+        assertEqual(true, outer.items()[0].data.object == copy.items()[0].data.object);
+        bool rejected = false;
+        try {
+            DataTypes::Data(DataTypes::Int(1)).mutableArray();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testDictionary() {
+        printf("Testing Dictionary...\n");
+        // Entries keep their insertion order through growth and erasure.
+        DataTypes::Dictionary dict;
+        for (int i = 0; i < 1000; i++) {
+            dict[DataTypes::Int(i * 7919 % 1000)] = DataTypes::Var(DataTypes::Int(i));
+        }
+        assertEqual(1000, static_cast<int>(dict.size()));
+        assertEqual(true, dict.capacity() >= 1000 && dict.capacity() % 16 == 0);
+        assertEqual(0, dict.begin()->first.integer);
+        assertEqual(1, static_cast<int>(dict.erase(DataTypes::Int(0))));
+        assertEqual(7919 % 1000, dict.begin()->first.integer);
+        int expected = 1;
+        bool ordered = true;
+        for (const auto& [key, value] : dict) {
+            ordered = ordered && value.data.integer == expected++;
+        }
+        assertEqual(true, ordered);
+        for (int i = 1; i < 1000; i++) {
+            ordered = ordered && dict.find(DataTypes::Int(i * 7919 % 1000))->second.data.integer == i;
+        }
+        assertEqual(true, ordered);
+        assertEqual(0, static_cast<int>(dict.count(DataTypes::Int(0))));
+        // Numbers that compare equal are the same key, whatever their type.
+        DataTypes::Dictionary keys{{DataTypes::Int(2), DataTypes::Var(DataTypes::String("two"))}};
+        assertEqual(std::string("two"), keys.find(DataTypes::Double(2.0))->second.data.asString());
+        keys[DataTypes::Float(2.0f)] = DataTypes::Var(DataTypes::String("deux"));
+        keys[DataTypes::String("2")] = DataTypes::Var(DataTypes::Null());
+        assertEqual(2, static_cast<int>(keys.size()));
+        assertEqual(std::string("deux"), keys.find(DataTypes::Int(2))->second.data.asString());
+        assertEqual(true, keys.find(DataTypes::Bool(true)) == keys.end());
+        // Literals build their dictionaries in source order.
+        Nodes::Program program;
+        program.process(Tokenizer::lex("d = {\"b\": 1, \"a\": 2, \"c\": 3};"));
+        program.run();
+        std::string order;
+        for (const auto& [key, value] : program.body->findVar(Symbols::intern("d"))->data.asDict()) {
+            order += key.asString();
+        }
+        assertEqual(std::string("bac"), order);
+    }
+    void testTypedArrays() {
+        printf("Testing Typed Arrays...\n");
+        using DataTypes::ElementKind;
+        // Packed from an array of numbers and indexed like one, 4 bytes per float element.
+        DataTypes::ArrayList numbers;
+        for (int i = 0; i < 37; i++) {
+            numbers.push_back(DataTypes::Var(DataTypes::Double(i * 0.5)));
+        }
+        DataTypes::TypedArray floats(ElementKind::Float32, numbers);
+        assertEqual(37, static_cast<int>(floats.elements().size()));
+        assertEqual(std::string("float"), std::string(DataTypes::typeName(floats.getProperty(DataTypes::Int(3)).data.type)));
+        assertEqual(1.5f, floats.getProperty(DataTypes::Int(3)).data.single);
+        DataTypes::Var holder(floats);
+        assertEqual(18.0f, holder.getProperty(DataTypes::Int(36)).data.single);
+        assertEqual(true, std::get<std::vector<float>>(floats.elements().elements).capacity() * sizeof(float) < 37 * sizeof(DataTypes::Var));
+        // int64 elements read as ints when they fit, int kinds reject numbers they cannot hold.
+        DataTypes::TypedArray longs(std::vector<int64_t>{7, int64_t(1) << 40});
+        assertEqual(7, longs.getProperty(DataTypes::Int(0)).data.integer);
+        assertEqual(true, longs.getProperty(DataTypes::Int(1)).data.is(DataTypes::Type::Double));
+        bool rejected = false;
+        try {
+            DataTypes::TypedArray(ElementKind::Int32, 1).mutableElements().set(0, DataTypes::Double(3e9));
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        // Element-wise operations, with lengths that leave a tail after the vector loop.
+        DataTypes::Data other = floats;
+        TypedArrays::add(floats, other);
+        assertEqual(true, floats.object != other.object);
+        assertEqual(1, static_cast<int>(floats.object->references));
+        assertEqual(2, static_cast<int>(other.object->references)); // other and holder
+        assertEqual(1.5f, other.asTypedArray().at(3).single);
+        assertEqual(3.0f, floats.elements().at(3).single);
+        assertEqual(36.0f, floats.elements().at(36).single);
+        TypedArrays::fma(floats, other, other);
+        assertEqual(36.0f + 18.0f * 18.0f, floats.elements().at(36).single);
+        // After the copy the array is not shared anymore and later writes change it in place.
+        const DataTypes::Object* copied = floats.object;
+        TypedArrays::scale(floats, DataTypes::Int(2));
+        assertEqual(true, floats.object == copied);
+        assertEqual(1, static_cast<int>(floats.object->references));
+        TypedArrays::clamp(floats, DataTypes::Int(1), DataTypes::Double(10.0));
+        assertEqual(1.0f, floats.elements().at(0).single);
+        assertEqual(10.0f, floats.elements().at(36).single);
+        assertEqual(2.5f, floats.elements().at(1).single);
+        // Reductions over every kind.
+        std::vector<int32_t> ints;
+        for (int i = 0; i < 101; i++) {
+            ints.push_back(i % 2 ? i : -i);
+        }
+        DataTypes::TypedArray packed(ints);
+        assertEqual(-50, TypedArrays::sum(packed).integer);
+        assertEqual(-100, TypedArrays::min(packed).integer);
+        assertEqual(99, TypedArrays::max(packed).integer);
+        assertEqual(338350, TypedArrays::dot(packed, packed).integer);
+        DataTypes::TypedArray doubles(std::vector<double>{0.5, -2.0, 8.0, 1.0, 3.0});
+        assertEqual(10.5, TypedArrays::sum(doubles).real);
+        assertEqual(-2.0, TypedArrays::min(doubles).real);
+        assertEqual(8.0, TypedArrays::max(doubles).real);
+        DataTypes::TypedArray wide(std::vector<int64_t>(40, int64_t(1) << 33));
+        assertEqual(40.0 * 8589934592.0, TypedArrays::sum(wide).real);
+        // Int arithmetic wraps like the operators.
+        DataTypes::TypedArray edge(std::vector<int32_t>(9, INT32_MAX));
+        TypedArrays::multiply(edge, DataTypes::TypedArray(std::vector<int32_t>(9, 2)));
+        assertEqual(-2, edge.elements().at(8).integer);
+        TypedArrays::multiply(edge, DataTypes::TypedArray(std::vector<int32_t>(9, 3)));
+        assertEqual((DataTypes::Int(-2) * DataTypes::Int(3)).integer, edge.elements().at(0).integer);
+        rejected = false;
+        try {
+            TypedArrays::add(packed, doubles);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        rejected = false;
+        try {
+            TypedArrays::max(DataTypes::TypedArray(ElementKind::Float64));
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testGarbageCollector() {
+        printf("Testing Garbage Collector...\n");
+        GarbageCollector::setYoungLimit(0);
+        GarbageCollector::collect();
+        GarbageCollector::Stats before = GarbageCollector::stats();
+        // Counting frees whatever is not part of a cycle by itself.
+        {
+            DataTypes::Array array;
+            array.mutableItems().push_back(DataTypes::Var(DataTypes::Array()));
+        }
+        assertEqual(0, static_cast<int>(GarbageCollector::collect()));
+        // An array that holds itself, and two instances that point at each other.
+        static DataTypes::Class node("Node");
+        Symbols::SymbolId next = Symbols::intern("next");
+        {
+            DataTypes::Array array;
+            array.mutableItems().push_back(DataTypes::Var(array));
+            DataTypes::ClassInstance first(node);
+            DataTypes::ClassInstance second(node);
+            first.get().set(next, second);
+            second.get().set(next, first);
+            assertEqual(0, static_cast<int>(GarbageCollector::collect(false)));
+        }
+        assertEqual(true, before.oldObjects + 3 == GarbageCollector::stats().oldObjects);
+        // Survivors of a young collection are old, only a full collection looks at them again.
+        assertEqual(0, static_cast<int>(GarbageCollector::collect(false)));
+        assertEqual(3, static_cast<int>(GarbageCollector::collect(true)));
+        // A cycle stays as long as a value outside of it points into it. Containers are copied before a shared
+        // one changes, so cycles through them go through an instance.
+        DataTypes::Var held;
+        {
+            DataTypes::ClassInstance owner(node);
+            DataTypes::Dict dict(DataTypes::Dictionary{{DataTypes::String("owner"), DataTypes::Var(owner)}});
+            owner.get().set(next, DataTypes::Array(DataTypes::ArrayList{DataTypes::Var(dict)}));
+            held = DataTypes::Var(dict);
+        }
+        assertEqual(0, static_cast<int>(GarbageCollector::collect()));
+        assertEqual(true, held.getProperty(DataTypes::String("owner")).data.is(DataTypes::Type::ClassInstance));
+        held = DataTypes::Var();
+        assertEqual(3, static_cast<int>(GarbageCollector::collect()));
+        // With a limit the young generation is collected while objects are made.
+        GarbageCollector::setYoungLimit(64);
+        for (int i = 0; i < 1000; i++) {
+            DataTypes::Array array;
+            array.mutableItems().push_back(DataTypes::Var(array));
+        }
+        GarbageCollector::Stats after = GarbageCollector::stats();
+        assertEqual(true, after.youngCollections + after.fullCollections > before.youngCollections + before.fullCollections + 10);
+        assertEqual(true, after.youngObjects + after.oldObjects < before.youngObjects + before.oldObjects + 200);
+        assertEqual(true, after.totalPauseMs >= after.longestPauseMs && after.longestPauseMs >= after.lastPauseMs);
+        GarbageCollector::setYoungLimit(4096);
+        GarbageCollector::collect();
+        after = GarbageCollector::stats();
+        assertEqual(true, before.youngObjects + before.oldObjects == after.youngObjects + after.oldObjects);
+        assertEqual(true, before.freed + 1006 == after.freed);
+    }
+    void testObjectPools() {
+        printf("Testing Object Pools...\n");
+        static DataTypes::Class bullet("Bullet");
+        Symbols::SymbolId speed = Symbols::intern("speed");
+        Symbols::SymbolId owner = Symbols::intern("owner");
+        bullet.addProperty(speed, DataTypes::Int(5));
+        bullet.setPool(2);
+        const DataTypes::InstanceObject* first;
+        {
+            DataTypes::ClassInstance shot(bullet);
+            first = &shot.get();
+            shot.get().set(speed, DataTypes::Int(9));
+            shot.get().set(owner, DataTypes::String("player"));
+        }
+        // A dropped instance is reset to the class's properties and made again.
+        DataTypes::PoolStats stats = bullet.poolStats();
+        assertEqual(1, static_cast<int>(stats.retained));
+        assertEqual(true, stats.bytes >= sizeof(DataTypes::InstanceObject));
+        DataTypes::ClassInstance reused(bullet);
+        assertEqual(true, &reused.get() == first);
+        assertEqual(5, reused.getProperty(speed).data.integer);
+        assertEqual(true, reused.get().find(owner) == nullptr);
+        assertEqual(true, reused.get().shape == DataTypes::ClassInstance(bullet).get().shape);
+        // The pool keeps at most its capacity.
+        {
+            std::vector<DataTypes::ClassInstance> wave(4, DataTypes::ClassInstance(bullet));
+            for (int i = 0; i < 4; i++) {
+                wave[i] = DataTypes::ClassInstance(bullet);
+            }
+        }
+        stats = bullet.poolStats();
+        assertEqual(2, static_cast<int>(stats.retained));
+        assertEqual(2, static_cast<int>(stats.highWater));
+        assertEqual(true, stats.hits >= 2 && stats.hitRate() > 0.0 && stats.hitRate() < 1.0);
+        // New properties reach new instances, and pooled ones made from the old properties are dropped.
+        bullet.addProperty("damage", DataTypes::Int(3));
+        assertEqual(0, static_cast<int>(bullet.poolStats().retained));
+        assertEqual(3, DataTypes::ClassInstance(bullet).getProperty(Symbols::intern("damage")).data.integer);
+        bullet.setPool(0);
+        assertEqual(0, static_cast<int>(bullet.poolStats().retained));
+        assertEqual(5, reused.getProperty(speed).data.integer);
+        // Instances of a class without a pool can outlive it.
+        auto shortLived = std::make_shared<DataTypes::Class>("Spark");
+        shortLived->addProperty(speed, DataTypes::Int(1));
+        DataTypes::Var spark{DataTypes::ClassInstance(*shortLived)};
+        assertEqual(false, static_cast<DataTypes::InstanceObject*>(spark.data.object)->pooled);
+        shortLived.reset();
+        spark = DataTypes::Var();
+    }
+    void testOperators() {
+        printf("Testing Operators...\n");
+        using Operators::Opcode;
+        // Promotion: bool < int < float < double, and never below int.
+        DataTypes::Data sum = Operators::apply(Opcode::Add, DataTypes::Bool(true), DataTypes::Bool(true));
+        assertEqual(std::string("int"), std::string(DataTypes::typeName(sum.type)));
+        assertEqual(2, sum.integer);
+        assertEqual(std::string("float"), std::string(DataTypes::typeName((DataTypes::Int(1) + DataTypes::Float(0.5f)).type)));
+        assertEqual(std::string("double"), std::string(DataTypes::typeName((DataTypes::Float(1.0f) * DataTypes::Double(2.0)).type)));
+        assertEqual(1.5, (DataTypes::Int(3) / DataTypes::Double(2.0)).real);
+        assertEqual(1, (DataTypes::Int(3) / DataTypes::Int(2)).integer);
+        assertEqual(-1, (DataTypes::Int(-7) % DataTypes::Int(3)).integer);
+        assertEqual(1.5, (DataTypes::Double(7.5) % DataTypes::Int(2)).real);
+        // Int arithmetic wraps instead of overflowing.
+        assertEqual(INT32_MIN, (DataTypes::Int(INT32_MAX) + DataTypes::Int(1)).integer);
+        assertEqual(INT32_MIN, (DataTypes::Int(INT32_MIN) / DataTypes::Int(-1)).integer);
+        assertEqual(6, (DataTypes::Bool(true) + DataTypes::Int(5)).integer);
+        assertEqual(3, (DataTypes::Int(1) | DataTypes::Bool(true) << DataTypes::Int(1)).integer);
+        // Comparisons cross numeric types, strings compare lexicographically, equality never throws.
+        assertEqual(true, (DataTypes::Int(2) == DataTypes::Double(2.0)).boolean);
+        assertEqual(true, (DataTypes::Float(1.5f) < DataTypes::Int(2)).boolean);
+        assertEqual(true, (DataTypes::String("abc") < DataTypes::String("abd")).boolean);
+        assertEqual(false, (DataTypes::Int(1) == DataTypes::String("1")).boolean);
+        assertEqual(true, (DataTypes::Int(1) != DataTypes::Bool(true)).boolean);
+        assertEqual(true, (DataTypes::Null() == DataTypes::Null()).boolean);
+        assertEqual(true, (DataTypes::String("") || DataTypes::Int(3)).boolean);
+        assertEqual(-4, (-DataTypes::Int(4)).integer);
+        assertEqual(-1, (~DataTypes::Int(0)).integer);
+        // Every supported pair has a kernel, everything else is rejected with the operator and both types.
+        assertEqual(true, Operators::lookup(Opcode::Less, DataTypes::Type::Int, DataTypes::Type::Double) != nullptr);
+        assertEqual(true, Operators::lookup(Opcode::BitAnd, DataTypes::Type::Double, DataTypes::Type::Int) == nullptr);
+        std::string message;
+        try {
+            Operators::apply(Opcode::Subtract, DataTypes::String("a"), DataTypes::Int(1));
+        } catch (const std::runtime_error& e) {
+            message = e.what();
+        }
+        assertEqual(std::string("Unsupported operand types for -: string and int."), message);
+        bool rejected = false;
+        try {
+            Operators::binaryOpcode(Tokens::TokenKind::Assign);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
     void testExpressions() {
         printf("Testing Expressions...\n");
-        // Add tests for Expression and its derived classes
-        
+        Nodes::Program program;
+        program.body->setVar("x", DataTypes::Int(4));
+        program.process(Tokenizer::lex("x = x * 2 + 10 % 4 - (1 << 3); y = x > 1 && !(x == 3);"));
+        program.body->stmts[0]->expression->evaluate();
+        program.body->stmts[1]->expression->evaluate();
+        assertEqual(2, program.body->getVar(Symbols::intern("x")).data.integer);
+        assertEqual(true, program.body->getVar(Symbols::intern("y")).data.boolean);
+    }
+    void testClosures() {
+        printf("Testing Closures...\n");
+        const char* script =
+            "total = 0; step = 3; ratio = 0.5; name = \"hype\";\n"
+            "if (step > 2) { total = total + step * 4; inner = total % 5; if (inner == 2) { total += 100; } }\n"
+            "if (total < 0) { total = -1; }\n"
+            "label = name + \"!\"; mixed = total * ratio - (2 << 3) / 4; list = [total, ratio, \"x\"];\n"
+            "flags = !(total == 112) || step >= 3 && ~step < 0; folded = 2 * 3 + 1; table = {1: step, \"k\": -ratio};\n"
+            "scaled = input * 2;\n";
+        // Both modes run the same parsed tree and must leave the same variables behind, also on a second run.
+        Nodes::Program tree;
+        Nodes::Program closures;
+        closures.mode = Nodes::ExecutionMode::Closures;
+        for (Nodes::Program* program : {&tree, &closures}) {
+            program->body->setVar("input", DataTypes::Int(5));
+            program->process(Tokenizer::lex(script));
+            program->run();
+            program->run();
+        }
+        for (const char* name : {"total", "step", "ratio", "name", "label", "mixed", "list", "flags", "folded", "table", "scaled"}) {
+            Symbols::SymbolId id = Symbols::intern(name);
+            assertEqual(toStr(tree.body->getVar(id).data.toJSON()), toStr(closures.body->getVar(id).data.toJSON()));
+        }
+        assertEqual(112, closures.body->getVar(Symbols::intern("total")).data.integer);
+        assertEqual(52.0, closures.body->getVar(Symbols::intern("mixed")).data.real);
+        assertEqual(7, closures.body->getVar(Symbols::intern("folded")).data.integer);
+        assertEqual(std::string("hype!"), closures.body->getVar(Symbols::intern("label")).data.asString());
+        // Variables set by the host between runs are seen by the bound slots.
+        closures.body->setVar("input", DataTypes::Double(1.5));
+        closures.run();
+        assertEqual(3.0, closures.body->getVar(Symbols::intern("scaled")).data.real);
+        // Errors surface at run time in both modes.
+        for (Nodes::ExecutionMode mode : {Nodes::ExecutionMode::Tree, Nodes::ExecutionMode::Closures}) {
+            Nodes::Program failing;
+            failing.mode = mode;
+            failing.process(Tokenizer::lex("a = 1 / 0; b = missing + 1;"));
+            bool rejected = false;
+            try {
+                failing.run();
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            assertEqual(true, rejected);
+        }
+    }
+    void testBytecode() {
+        printf("Testing Bytecode...\n");
+        const char* script =
+            "count = 0; limit = 4; text = \"a\"; half = 0.5;\n"
+            "if (limit > 3) { count += limit * 2; if (count != 8) { count = -100; } }\n"
+            "deep = [count, [half, text], {\"n\": count % 3}];\n"
+            "if (!(count == 8)) { count = 0; }\n"
+            "text += \"b\" + text; shifted = (1 << limit) | 3 ^ 1; neg = -half * ~limit; both = count > 1 && half < 1;\n"
+            "doubled = input + input; a = b = limit - 1;\n";
+        Nodes::Program tree;
+        Nodes::Program bytecode;
+        bytecode.mode = Nodes::ExecutionMode::Bytecode;
+        for (Nodes::Program* program : {&tree, &bytecode}) {
+            program->body->setVar("input", DataTypes::String("in"));
+            program->process(Tokenizer::lex(script));
+            program->run();
+            program->run();
+        }
+        for (const char* name : {"count", "limit", "text", "half", "deep", "shifted", "neg", "both", "doubled", "a", "b"}) {
+            Symbols::SymbolId id = Symbols::intern(name);
+            assertEqual(toStr(tree.body->getVar(id).data.toJSON()), toStr(bytecode.body->getVar(id).data.toJSON()));
+        }
+        assertEqual(8, bytecode.body->getVar(Symbols::intern("count")).data.integer);
+        assertEqual(std::string("aba"), bytecode.body->getVar(Symbols::intern("text")).data.asString());
+        assertEqual(3, bytecode.body->getVar(Symbols::intern("a")).data.integer);
+        // Registers are reused across statements, so the frame stays as small as the widest expression.
+        assertEqual(true, bytecode.chunk->registerCount <= 8);
+        std::string listing = Bytecode::disassemble(*bytecode.chunk);
+        assertEqual(true, listing.find("JumpIfFalse") != std::string::npos);
+        assertEqual(true, listing.find("NewDict") != std::string::npos);
+        assertEqual(true, listing.find("; limit") != std::string::npos);
+        // Constant operator trees are folded when the chunk is built.
+        Nodes::Program constants;
+        constants.process(Tokenizer::lex("x = 2 * 3 + 1;"));
+        Bytecode::Chunk folded = Bytecode::compile(*constants.body);
+        assertEqual(std::size_t(3), folded.code.size()); // LoadConst, SetVar, Return
+        assertEqual(7, folded.constants[0].integer);
+        // Errors propagate out of the VM, and the VM is usable again afterwards.
+        Nodes::Program failing;
+        failing.mode = Nodes::ExecutionMode::Bytecode;
+        failing.process(Tokenizer::lex("a = 1; b = a / 0;"));
+        bool rejected = false;
+        try {
+            failing.run();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        assertEqual(1, failing.body->getVar(Symbols::intern("a")).data.integer);
+        bytecode.body->setVar("input", DataTypes::Int(21));
+        bytecode.run();
+        assertEqual(42, bytecode.body->getVar(Symbols::intern("doubled")).data.integer);
+    }
+    void testJit() {
+        printf("Testing Jit...\n");
+        const char* script =
+            "total = total + step * 3 - (total % 7); if (total > 1000) { total = total - 1000; wraps += 1; }\n"
+            "scale = scale * 0.5 + ratio / 4.0; flag = step < 10 && !(total == 0); if (flag) { step = step + 1; }\n"
+            "mask = (total & 255) | (step << 4) ^ ~wraps; neg = -scale; below = scale <= ratio; q = total / divisor + total % divisor;\n";
+        Nodes::Program tree;
+        Nodes::Program jit;
+        jit.mode = Nodes::ExecutionMode::Bytecode;
+        for (Nodes::Program* program : {&tree, &jit}) {
+            program->body->setVar("total", DataTypes::Int(1));
+            program->body->setVar("step", DataTypes::Int(1));
+            program->body->setVar("wraps", DataTypes::Int(0));
+            program->body->setVar("scale", DataTypes::Double(1.0));
+            program->body->setVar("ratio", DataTypes::Double(0.75));
+            program->body->setVar("divisor", DataTypes::Int(3));
+            program->process(Tokenizer::lex(script));
+        }
+        auto runBoth = [&](int runs) {
+            bool treeFailed = false;
+            bool jitFailed = false;
+            for (int i = 0; i < runs; i++) {
+                try {
+                    tree.run();
+                } catch (const std::runtime_error&) {
+                    treeFailed = true;
+                }
+                try {
+                    jit.run();
+                } catch (const std::runtime_error&) {
+                    jitFailed = true;
+                }
+            }
+            assertEqual(treeFailed, jitFailed);
+            for (const char* name : {"total", "step", "wraps", "scale", "flag", "mask", "neg", "below", "q"}) {
+                Symbols::SymbolId id = Symbols::intern(name);
+                assertEqual(toStr(tree.body->getVar(id).data.toJSON()), toStr(jit.body->getVar(id).data.toJSON()));
+            }
+        };
+        Jit::JitStats before = Jit::stats;
+        runBoth(static_cast<int>(Jit::hotThreshold) + 100);
+        if (!Jit::supported) {
+            return;
+        }
+        assertEqual(before.compiled + 1, Jit::stats.compiled);
+        assertEqual(true, jit.chunk->native != nullptr);
+        // Integer division by 0 or -1 leaves the native code and finishes in the interpreter.
+        for (int divisor : {0, -1}) {
+            tree.body->setVar("divisor", DataTypes::Int(divisor));
+            jit.body->setVar("divisor", DataTypes::Int(divisor));
+            runBoth(1);
+        }
+        assertEqual(before.deopts + 2, Jit::stats.deopts);
+        assertEqual(true, jit.chunk->native != nullptr);
+        // A variable that changes type fails the entry guard: the run is interpreted and the code recompiled later.
+        tree.body->setVar("ratio", DataTypes::Int(2));
+        jit.body->setVar("ratio", DataTypes::Int(2));
+        runBoth(1);
+        assertEqual(before.guardFailures + 1, Jit::stats.guardFailures);
+        assertEqual(true, jit.chunk->native == nullptr);
+        runBoth(static_cast<int>(Jit::hotThreshold) + 10);
+        assertEqual(before.compiled + 2, Jit::stats.compiled);
+        // Chunks with strings or containers stay on the interpreter.
+        Nodes::Program strings;
+        strings.mode = Nodes::ExecutionMode::Bytecode;
+        strings.process(Tokenizer::lex("s = \"a\" + \"b\"; l = [1, 2];"));
+        for (uint32_t i = 0; i <= Jit::hotThreshold; i++) {
+            strings.run();
+        }
+        assertEqual(before.rejected + 1, Jit::stats.rejected);
+        assertEqual(true, strings.chunk->interpretOnly);
     }
     void testStatements() {
         printf("Testing Statements...\n");
@@ -66,13 +835,64 @@ namespace ProcessorTests {
     }
     void testBlocks() {
         printf("Testing Blocks...\n");
-        // Add tests for Block and its methods
-        
+        // Blocks are parsed in place from the shared stream, every level of a deeply nested script must be found.
+        const int depth = 200;
+        std::string script = ProcessorBenchmarks::generateNestedScript(depth);
+        Nodes::Program program;
+        program.process(Tokenizer::lex(script));
+        int levels = 0;
+        for (Nodes::Block* block = program.body; block; ) {
+            Nodes::Block* inner = nullptr;
+            for (Nodes::Statement* stmt : block->stmts) {
+                if (auto ifStmt = dynamic_cast<Nodes::Statements::IfStatement*>(stmt)) {
+                    inner = ifStmt->body;
+                }
+            }
+            levels += inner ? 1 : 0;
+            block = inner;
+        }
+        assertEqual(depth, levels);
+        // Unbalanced braces are reported instead of being skipped over.
+        for (std::string unbalanced : {"if (a) { a = 1;", "a = 1; }", "if (a { a = 1; }"}) {
+            bool rejected = false;
+            try {
+                Nodes::Program broken;
+                broken.process(Tokenizer::lex(unbalanced));
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            assertEqual(true, rejected);
+        }
     }
     void runTests() {
         try {
         testTokenizer();
+        testTokenStream();
+        testSymbolTable();
+        testScanner();
+        testSourceLoader();
+        testParallelTokenizer();
+        testSymbols();
+        testArena();
+        testPrattParser();
+        testResolver();
+        testAstCache();
+        testValues();
+        testCopyOnWrite();
+        testDictionary();
+        testTypedArrays();
+        testGarbageCollector();
+        testObjectPools();
+        testShapes();
+        testShapeReuse();
+        testMethodTables();
+        testTypeRegistry();
+        testOperators();
         testExpressions();
+        testSpecialization();
+        testClosures();
+        testBytecode();
+        testJit();
         testStatements();
         testBlocks();
         ConsoleColors::PrintSuccess("All tests completed.\n");
@@ -83,47 +903,191 @@ namespace ProcessorTests {
     }
 
 }
-std::vector<std::vector<std::string>> operatorLevels = {
-    {"||", "&&"},
-    {"==", "!=", "<", ">", "<=", ">="},
-    {"+", "-"},
-    {"*", "/"}
+// Binding powers of the infix operators, indexed by token kind, for the Pratt parser.
+// `left` is how tightly an operator holds the expression before it (0 means the kind is not an infix operator),
+// `right` is the minimum power an operator needs to be taken into the expression after it.
+// Left associative operators use right == left, right associative ones (assignment) use right == left - 1.
+struct BindingPower {
+    uint8_t left;
+    uint8_t right;
 };
-namespace Nodes {
-    std::shared_ptr<Nodes::Expression> parse(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end,uint32_t level);
-    std::shared_ptr<Nodes::Expression> parseFactor(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end);
+constexpr std::array<BindingPower, Tokens::tokenKindCount> bindingPowers = [] {
+    using Tokens::TokenKind;
+    std::array<BindingPower, Tokens::tokenKindCount> table = {};
+    auto set = [&table](std::initializer_list<TokenKind> kinds, uint8_t power, bool rightAssociative = false) {
+        for (TokenKind kind : kinds) {
+            table[static_cast<std::size_t>(kind)] = {power, static_cast<uint8_t>(rightAssociative ? power - 1 : power)};
+        }
+    };
+    set({TokenKind::Assign, TokenKind::PlusAssign, TokenKind::MinusAssign, TokenKind::StarAssign, TokenKind::SlashAssign, TokenKind::PercentAssign,
+         TokenKind::AmpersandAssign, TokenKind::PipeAssign, TokenKind::CaretAssign, TokenKind::ShiftLeftAssign, TokenKind::ShiftRightAssign}, 2, true);
+    set({TokenKind::Or}, 4);
+    set({TokenKind::And}, 6);
+    set({TokenKind::Pipe}, 8);
+    set({TokenKind::Caret}, 10);
+    set({TokenKind::Ampersand}, 12);
+    set({TokenKind::Equal, TokenKind::NotEqual}, 14);
+    set({TokenKind::Less, TokenKind::Greater, TokenKind::LessEqual, TokenKind::GreaterEqual}, 16);
+    set({TokenKind::ShiftLeft, TokenKind::ShiftRight}, 18);
+    set({TokenKind::Plus, TokenKind::Minus}, 20);
+    set({TokenKind::Star, TokenKind::Slash, TokenKind::Percent}, 22);
+    return table;
+}();
 
+// The binary operator a compound assignment applies (+= applies +), or Assign for plain assignment.
+constexpr Tokens::TokenKind compoundOperator(Tokens::TokenKind kind) {
+    switch (kind) {
+        case Tokens::TokenKind::PlusAssign: return Tokens::TokenKind::Plus;
+        case Tokens::TokenKind::MinusAssign: return Tokens::TokenKind::Minus;
+        case Tokens::TokenKind::StarAssign: return Tokens::TokenKind::Star;
+        case Tokens::TokenKind::SlashAssign: return Tokens::TokenKind::Slash;
+        case Tokens::TokenKind::PercentAssign: return Tokens::TokenKind::Percent;
+        case Tokens::TokenKind::AmpersandAssign: return Tokens::TokenKind::Ampersand;
+        case Tokens::TokenKind::PipeAssign: return Tokens::TokenKind::Pipe;
+        case Tokens::TokenKind::CaretAssign: return Tokens::TokenKind::Caret;
+        case Tokens::TokenKind::ShiftLeftAssign: return Tokens::TokenKind::ShiftLeft;
+        case Tokens::TokenKind::ShiftRightAssign: return Tokens::TokenKind::ShiftRight;
+        default: return Tokens::TokenKind::Assign;
+    }
+}
+constexpr bool isAssignment(Tokens::TokenKind kind) {
+    return kind == Tokens::TokenKind::Assign || compoundOperator(kind) != Tokens::TokenKind::Assign;
+}
+
+namespace Nodes {
+    Nodes::Expression* parse(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end, uint8_t minPower = 0);
+    Nodes::Expression* parseFactor(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end);
+    Nodes::Expression* parsePostfix(Arena& arena, Nodes::Expression* expr, Tokens::Iterator& start, Tokens::Iterator end);
+    // Rebuild nodes from a .hypec image, the counterpart of Base::serialize.
+    Nodes::Statement* readStatement(Arena& arena, AstCache::Reader& reader, Base* parent);
+    Nodes::Expression* readExpression(Arena& arena, AstCache::Reader& reader, Base* parent);
 
     const std::string Base::toString() const {
-        return name;
+        return std::string(name);
     }
     const JsonObject Base::toJSON() const  {
         return JsonObject().add("type",toString());//.add("parent",(!parent.expired())?parent.lock()->toString():"null");
     }
-    void Base::process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
+    void Base::process(Arena& /*arena*/, Tokens::Iterator& /*start*/, Tokens::Iterator /*end*/) {
         // Default implementation does nothing
         // Derived classes can override this method to provide specific processing
     }
+    void Base::serialize(AstCache::Writer& /*writer*/) const {
+        throw std::runtime_error("Node cannot be cached: " + toString());
+    }
     DataTypes::Data Expression::evaluate() {
         // Default implementation does nothing
         // Derived classes can override this method to provide specific evaluation
         return DataTypes::Null();
     }
-    const DataTypes::Var& Base::getVar(const std::string& label) const {
-        if (parent.expired()) {
+    CompiledExpression Expression::compile() {
+        return [this] { return evaluate(); };
+    }
+    uint8_t Expression::emit(Bytecode::Compiler& compiler) {
+        Bytecode::Register result = compiler.allocate();
+        compiler.emit(Bytecode::encodeBx(Bytecode::Op::Evaluate, result, compiler.node(this)));
+        return result;
+    }
+    const DataTypes::Var& Base::getVar(Symbols::SymbolId label) const {
+        if (!parent) {
             static DataTypes::Var empty = DataTypes::Var(DataTypes::Null());
             return empty;
         }
-        return parent.lock()->getVar(label);
+        return parent->getVar(label);
     }
-    const DataTypes::Class& Base::getClass(const std::string& label) const {
-        if (parent.expired()) { // TO DO: Create proper error handling for this case.
-            static DataTypes::Class empty = DataTypes::NullClassType();
-            return empty;
+    const DataTypes::Class& Base::getClass(Symbols::SymbolId label) const {
+        if (!parent) { // TO DO: Create proper error handling for this case.
+            DataTypes::TypeRegistry& registry = DataTypes::TypeRegistry::instance();
+            DataTypes::TypeId id = registry.find(label);
+            return id != DataTypes::noType ? registry.get(id) : registry.get(static_cast<DataTypes::TypeId>(DataTypes::Type::Null));
         }
-        return parent.lock()->getClass(label);
+        return parent->getClass(label);
     }
 
+    VariableSlot::VariableSlot(Base* node, Symbols::SymbolId id, const Address& address) : site(node), symbol(id), var(nullptr) {
+        var = address.resolved() ? &address.var() : find();
+    }
+    DataTypes::Var PropertyCache::miss(const DataTypes::Data& object, Symbols::SymbolId name) {
+        if (object.is(DataTypes::Type::Dict)) {
+            return DataTypes::Var(object).getProperty(DataTypes::String(Symbols::toString(name)));
+        }
+        if (!object.is(DataTypes::Type::ClassInstance)) {
+            throw std::runtime_error("Cannot read property '" + Symbols::toString(name) + "' of a " + DataTypes::typeName(object.type) + ".");
+        }
+        propertyCacheStats.misses++;
+        const DataTypes::InstanceObject& instance = *static_cast<DataTypes::InstanceObject*>(object.object);
+        Entry entry{instance.shape->id(), instance.shape->find(name), false};
+        if (entry.index == DataTypes::Shape::missing) {
+            entry = Entry{instance.shape->id(), instance.classType->methodSlot(name), true};
+            if (entry.index == DataTypes::Shape::missing) {
+                throw std::runtime_error("Property '" + Symbols::toString(name) + "' not found in class instance.");
+            }
+        }
+        // A method entry whose slot went stale is replaced in place
+        auto cached = std::find_if(entries.begin(), entries.begin() + size(), [&entry](const Entry& other) {
+            return other.shape == entry.shape;
+        });
+        if (cached != entries.begin() + size()) {
+            *cached = entry;
+        } else if (count < ways) {
+            entries[count++] = entry;
+            propertyCacheStats.polymorphic += count == 2;
+        } else if (count == ways) {
+            count++;
+            propertyCacheStats.megamorphic++;
+        }
+        return entry.method ? DataTypes::Var(instance.classType->methodTable()[entry.index]) : instance.slots[entry.index];
+    }
+    DataTypes::Var* VariableSlot::find() const {
+        for (Base* node = site->parent; node; node = node->parent) {
+            if (Block* block = dynamic_cast<Block*>(node)) {
+                if (DataTypes::Var* found = block->findVar(symbol)) {
+                    return found;
+                }
+            }
+        }
+        return nullptr;
+    }
+    const DataTypes::Data& VariableSlot::bindForRead() {
+        var = find();
+        if (!var) {
+            return site->getVar(symbol).data; // Undeclared, reported the same way as the tree path
+        }
+        return var->data;
+    }
+    DataTypes::Var& VariableSlot::bindForWrite() {
+        var = find();
+        for (Base* node = site->parent; node && !var; node = node->parent) {
+            if (Block* block = dynamic_cast<Block*>(node)) {
+                var = &block->variables[symbol];
+            }
+        }
+        if (!var) {
+            throw std::runtime_error("Assignment to '" + Symbols::toString(symbol) + "' outside of a block.");
+        }
+        return *var;
+    }
+    CompiledStatement Statement::compileStatement() {
+        CompiledExpression compiled = compile();
+        return [compiled = std::move(compiled)] { compiled(); };
+    }
+    void Statement::emitStatement(Bytecode::Compiler& compiler) {
+        Bytecode::Register mark = compiler.top();
+        emit(compiler);
+        compiler.release(mark);
+    }
+    void Statement::resolve(Resolver& resolver) {
+        if (expression) {
+            expression->resolve(resolver);
+        }
+    }
+    bool Statement::replaceChild(Expression* from, Expression* to) {
+        if (expression != from) {
+            return false;
+        }
+        expression = to;
+        return true;
+    }
     const JsonObject Statement::toJSON() const {
         JsonObject json = Expression::toJSON();
         if (expression) {
@@ -135,144 +1099,315 @@ namespace Nodes {
     const JsonObject Block::toJSON() const {
         JsonObject json = Base::toJSON();
         JsonArray stmtsArray;
-        for (const std::shared_ptr<Statement>& stmt : stmts) { // Updated to use shared_ptr
+        for (const Statement* stmt : stmts) {
             stmtsArray.append(stmt->toJSON());
         }
         json.add("statements", stmtsArray);
         return json;
     }
+    void Block::serialize(AstCache::Writer& writer) const {
+        writer.u32(static_cast<uint32_t>(stmts.size()));
+        for (const Statement* stmt : stmts) {
+            stmt->serialize(writer);
+        }
+    }
+    void Block::execute() {
+        for (Statement* stmt : stmts) {
+            stmt->execute();
+        }
+    }
+    CompiledStatement Block::compile() {
+        std::vector<CompiledStatement> compiled;
+        compiled.reserve(stmts.size());
+        for (Statement* stmt : stmts) {
+            compiled.push_back(stmt->compileStatement());
+        }
+        return [compiled = std::move(compiled)] {
+            for (const CompiledStatement& stmt : compiled) {
+                stmt();
+            }
+        };
+    }
+    void Block::resolve(Resolver& resolver) {
+        resolver.enter(*this);
+        for (Statement* stmt : stmts) {
+            stmt->resolve(resolver);
+        }
+        resolver.leave();
+    }
+    void Block::emit(Bytecode::Compiler& compiler) {
+        for (Statement* stmt : stmts) {
+            stmt->emitStatement(compiler);
+        }
+    }
+    void Block::deserialize(Arena& arena, AstCache::Reader& reader) {
+        uint32_t count = reader.u32();
+        stmts.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            stmts.push_back(readStatement(arena, reader, this));
+        }
+    }
+
+    void Resolver::enter(Block& block) {
+        block.enclosing = scopes.empty() ? nullptr : scopes.back();
+        for (auto& [symbol, var] : block.variables) {
+            block.slotNames.emplace(symbol, static_cast<uint32_t>(block.slots.size()));
+            block.slots.push_back(std::move(var));
+        }
+        block.variables.clear();
+        scopes.push_back(&block);
+        for (const auto& [symbol, slot] : block.slotNames) {
+            show(symbol, slot);
+        }
+    }
+    void Resolver::leave() {
+        for (const auto& [symbol, slot] : scopes.back()->slotNames) {
+            visible[symbol].pop_back();
+        }
+        scopes.pop_back();
+    }
+    Address Resolver::lookup(Symbols::SymbolId symbol) const {
+        auto it = visible.find(symbol);
+        if (it == visible.end() || it->second.empty()) {
+            return Address();
+        }
+        auto [scope, slot] = it->second.back();
+        return Address{scopes.back(), static_cast<uint16_t>(scopes.size() - 1 - scope), slot};
+    }
+    Address Resolver::declare(Symbols::SymbolId symbol) {
+        Address address = lookup(symbol);
+        // Only the outermost block declares slots: a slot in a nested block could shadow a variable the host adds
+        // to an enclosing block after parsing, which the assignment has to write instead.
+        if (!address.resolved() && scopes.size() == 1) {
+            Block* block = scopes.back();
+            uint32_t slot = static_cast<uint32_t>(block->slots.size());
+            block->slotNames.emplace(symbol, slot);
+            block->slots.emplace_back();
+            show(symbol, slot);
+            address = Address{block, 0, slot};
+        }
+        return address;
+    }
     
 
     namespace Expressions {
         class StatementCondition : public Expression {
             public:
-                std::shared_ptr<Expression> condition; // Updated to shared_ptr
+                Expression* condition = nullptr; // Child node
 
-                StatementCondition(std::weak_ptr<Base> parentPointer)
+                StatementCondition(Base* parentPointer)
                     : Expression(parentPointer, "Statement Condition") {
                     }
 
-                void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) override {
-                    if (start == end || *start != "(") {
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override {
+                    if (start == end || !start->is(Tokens::TokenKind::LeftParen)) {
                         throw std::runtime_error("Expected '(' in condition.");
                     }
                     // Move past '('
                     start++;
 
-                    std::vector<std::string>::iterator expressionEnd = start;
-                    int depth = 1;
-                    while (expressionEnd != end && depth > 0) {
-                        std::string token = *expressionEnd;
-                        if (token == "(") {
-                            depth++;
-                        } else if (token == ")") {
-                            if (--depth == 0) {
-                                break;
-                            }
-                        }
-                        
-                        expressionEnd++;
-                    }
-                    if (depth > 0) {
+                    // The parser stops at the ')' on its own, nested parentheses are consumed by parseFactor.
+                    condition = parse(arena, start, end);
+                    condition->parent = this;
+                    if (start == end || !start->is(Tokens::TokenKind::RightParen)) {
                         throw std::runtime_error("Unmatched '(' in condition.");
                     }
-                    condition = parse(start, expressionEnd);
-                    condition->parent = std::weak_ptr<Base>(shared_from_this());
-                    start = ++expressionEnd;
+                    start++; // Move past ')'
                 }
                 const JsonObject toJSON() const override {
                     JsonObject base = Expression::toJSON();
                     base.add("condition",condition ? condition->toJSON() : JsonObject());
                     return base;
                 }
+                void serialize(AstCache::Writer& writer) const override {
+                    condition->serialize(writer); // Untagged, it is always the first child of its statement
+                }
                 DataTypes::Data evaluate() override {
                     // Evaluate the condition expression
                     return condition->evaluate();
                 }
+                void resolve(Resolver& resolver) override {
+                    condition->resolve(resolver);
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override {
+                    return condition->compile();
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (condition != from) {
+                        return false;
+                    }
+                    condition = to;
+                    return true;
+                }
         };
+        // Operator sites specialize themselves on the operand types they observe. A fresh site evaluates its
+        // operands once, then rewrites itself in its parent into a variant for that type pair (IntAdd, DoubleLess,
+        // StringConcat, ...) whose only check is a guard on the two type tags. When the guard fails the variant
+        // puts the generic node back, which picks a variant for the new types. A site that keeps changing types
+        // stops after `respecializeLimit` rewrites and stays generic, going through the operator table every time.
+        inline constexpr uint8_t respecializeLimit = 2;
+
+        // The arena of the program that owns `node`, or nullptr for nodes outside a program.
+        Arena* owningArena(Base* node) {
+            while (node->parent) {
+                node = node->parent;
+            }
+            Body* body = dynamic_cast<Body*>(node);
+            return body ? body->arena : nullptr;
+        }
+        // "int" -> "Int", for variant names.
+        std::string capitalized(const char* word) {
+            std::string result(word);
+            if (!result.empty()) {
+                result[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(result[0])));
+            }
+            return result;
+        }
+
         class BinaryExpression : public Expression {
             public:
-                std::shared_ptr<Expression> left;
-                std::shared_ptr<Expression> right;
-                std::string op; // Operator like +, -, *, /, etc.
+                Expression* left;
+                Expression* right;
+                Tokens::TokenKind op; // Operator like +, -, *, /, etc.
+                Operators::Opcode opcode; // Resolved once, evaluation goes straight to the kernel table
 
-                BinaryExpression(std::weak_ptr<Base> parentPointer,  std::shared_ptr<Expression> leftExpr, std::string oper)
-                    : Expression(parentPointer, "Operator(Bi): "+oper), left(leftExpr), right(nullptr), op(oper) {
+                BinaryExpression(Base* parentPointer, Expression* leftExpr, Tokens::TokenKind oper)
+                    : Expression(parentPointer, "Operator(Bi)"), left(leftExpr), right(nullptr), op(oper),
+                      opcode(Operators::binaryOpcode(oper)) {
                     }
                 const JsonObject toJSON() const override {
                     JsonObject json = Expression::toJSON();
+                    json.add("operator", std::string(Tokens::kindName(op)));
                     json.add("left", left ? left->toJSON() : JsonObject());
                     json.add("right", right ? right->toJSON() : JsonObject());
                     return json;
                 }
-                DataTypes::Data evaluate() {
+                DataTypes::Data evaluate() override {
                     // Evaluate the left and right expressions
                     DataTypes::Data leftValue = left->evaluate();
                     DataTypes::Data rightValue = right->evaluate();
+                    if (!generic) {
+                        specialize(leftValue.type, rightValue.type);
+                    }
+                    return Operators::apply(opcode, leftValue, rightValue);
+                }
+                void resolve(Resolver& resolver) override {
+                    left->resolve(resolver);
+                    right->resolve(resolver);
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override;
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::BinaryExpression);
+                    writer.u8(static_cast<uint8_t>(op));
+                    left->serialize(writer);
+                    right->serialize(writer);
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (left == from) {
+                        left = to;
+                    } else if (right == from) {
+                        right = to;
+                    } else {
+                        return false;
+                    }
+                    return true;
+                }
+                // The variant running this site: "IntAdd", "DoubleIntLess", ..., or "Generic" before the first
+                // evaluation and after the site gave up specializing.
+                virtual std::string variant() const {
+                    return "Generic";
+                }
+
+                uint8_t rewrites = 0; // Variants installed so far
+                bool generic = false; // Set once the site stops specializing
 
-                    // Perform the operation based on the operator
-                    if (op == "+") {
-                        return leftValue + rightValue;
-                    } else if (op == "-") {
-                        return leftValue - rightValue;
-                    } else if (op == "*") {
-                        return leftValue * rightValue;
-                    } else if (op == "/") {
-                        return leftValue / rightValue;
-                    } else if (op == "%") {
-                        return leftValue % rightValue;
-                    } else if (op == "==") {
-                        return leftValue == rightValue;
-                    } else if (op == "!=") {
-                        return leftValue != rightValue;
-                    } else if (op == "<") {
-                        return leftValue < rightValue;
-                    } else if (op == ">") {
-                        return leftValue > rightValue;
-                    } else if (op == "<=") {
-                        return leftValue <= rightValue;
-                    } else if (op == ">=") {
-                        return leftValue >= rightValue;
-                    } else if (op == "&&") {
-                        return leftValue && rightValue;
-                    } else if (op == "||") {
-                        return leftValue || rightValue;
+                // Replaces this node in its parent with a variant for these operand types. Sites without a program
+                // or a parent that can swap children become generic instead.
+                void specialize(DataTypes::Type leftType, DataTypes::Type rightType);
+        };
+        // Assigns to a named variable. Compound forms (a += b) apply their operator to the current value first.
+        // The value is stored in the innermost enclosing block that already has the variable, or declared in the
+        // innermost block otherwise. The expression evaluates to the assigned value, so a = b = 1 chains.
+        class AssignmentExpression : public Expression {
+            public:
+                VariableAccessor* target;
+                Expression* value;
+                Tokens::TokenKind op; // = or a compound assignment like +=
+                Address address; // The assigned variable, set by the resolver
+
+                AssignmentExpression(Base* parentPointer, VariableAccessor* targetExpr, Tokens::TokenKind oper)
+                    : Expression(parentPointer, "Assignment"), target(targetExpr), value(nullptr), op(oper) {
                     }
-                    return DataTypes::Null();
+                const JsonObject toJSON() const override;
+                DataTypes::Data evaluate() override;
+                void resolve(Resolver& resolver) override;
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override;
+                void serialize(AstCache::Writer& writer) const override;
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (value != from) {
+                        return false;
+                    }
+                    value = to;
+                    return true;
                 }
         };
         class UnaryExpression : public Expression {
             public:
-            std::string op; // Operator like -, !, etc.
-            std::shared_ptr<Expression> expr;
+            Tokens::TokenKind op; // Operator like -, !, etc.
+            Operators::UnaryOpcode opcode;
+            Expression* expr;
 
-                UnaryExpression(std::weak_ptr<Base> parentPointer, std::string oper, std::shared_ptr<Expression> operand)
-                    : Expression(parentPointer, "Operator(Uni): "+oper), op(oper), expr(operand) {}
+                UnaryExpression(Base* parentPointer, Tokens::TokenKind oper, Expression* operand)
+                    : Expression(parentPointer, "Operator(Uni)"), op(oper), opcode(Operators::unaryOpcode(oper)), expr(operand) {}
                 const JsonObject toJSON() const override {
                     JsonObject json = Expression::toJSON();
+                    json.add("operator", std::string(Tokens::kindName(op)));
                     json.add("operand", expr ? expr->toJSON() : JsonObject());
                     return json;
                 }
-                DataTypes::Data evaluate() {
+                DataTypes::Data evaluate() override {
                     // Evaluate the operand expression
                     DataTypes::Data operandValue = expr->evaluate();
-
-                    // Perform the operation based on the operator
-                    if (op == "-") {
-                        return -operandValue; // Negation
-                    } else if (op == "!") {
-                        return !operandValue;
-                    } else if (op == "~") {
-                        return ~operandValue; // Bitwise NOT
+                    if (!generic) {
+                        specialize(operandValue.type);
                     }
-                    return DataTypes::Null();
+                    return Operators::apply(opcode, operandValue);
+                }
+                void resolve(Resolver& resolver) override {
+                    expr->resolve(resolver);
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override;
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::UnaryExpression);
+                    writer.u8(static_cast<uint8_t>(op));
+                    expr->serialize(writer);
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (expr != from) {
+                        return false;
+                    }
+                    expr = to;
+                    return true;
+                }
+                virtual std::string variant() const {
+                    return "Generic";
                 }
+
+                uint8_t rewrites = 0;
+                bool generic = false;
+
+                // Same as BinaryExpression::specialize, for the operand type.
+                void specialize(DataTypes::Type operandType);
         };
         class ParenthesisExpression : public Expression {
             public:
-                std::shared_ptr<Expression> expr;
+                Expression* expr = nullptr;
 
-                ParenthesisExpression(std::weak_ptr<Base> parentPointer, std::string n)
+                ParenthesisExpression(Base* parentPointer, const char* n)
                     : Expression(parentPointer, n) {}
                 
                 const JsonObject toJSON() const override {
@@ -284,17 +1419,273 @@ namespace Nodes {
                     // Evaluate the expression inside the parentheses
                     return expr->evaluate();
                 }
+                void resolve(Resolver& resolver) override {
+                    expr->resolve(resolver);
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override {
+                    return expr->compile();
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (expr != from) {
+                        return false;
+                    }
+                    expr = to;
+                    return true;
+                }
+        };
+
+        // A binary site rewritten for one pair of operand types. It copies the generic node it replaced, adopts
+        // its children and keeps a pointer to it, so the generic node can be put back when the guard fails.
+        class SpecializedBinary : public BinaryExpression {
+            public:
+                BinaryExpression* original;
+
+                SpecializedBinary(BinaryExpression* generic) : BinaryExpression(*generic), original(generic) {}
+
+                // The guard failed: hands the site back to the generic node, which specializes again or gives up,
+                // and finishes this evaluation through the table.
+                DataTypes::Data deoptimize(const DataTypes::Data& leftValue, const DataTypes::Data& rightValue) {
+                    specializationStats.guardFailures++;
+                    original->parent = parent; // The parent may itself have been rewritten since
+                    original->left = left;
+                    original->right = right;
+                    left->parent = original;
+                    right->parent = original;
+                    parent->replaceChild(this, original);
+                    if (original->rewrites >= respecializeLimit) {
+                        original->generic = true;
+                        specializationStats.generalized++;
+                    } else {
+                        original->specialize(leftValue.type, rightValue.type);
+                    }
+                    return Operators::apply(opcode, leftValue, rightValue);
+                }
+        };
+        // Numbers of fixed types, the kernel is inlined: IntAdd, DoubleLess, IntDoubleMultiply, ...
+        template<typename Op, DataTypes::Type L, DataTypes::Type R>
+        class NumericBinary final : public SpecializedBinary {
+            public:
+                using SpecializedBinary::SpecializedBinary;
+
+                DataTypes::Data evaluate() override {
+                    DataTypes::Data leftValue = left->evaluate();
+                    DataTypes::Data rightValue = right->evaluate();
+                    if (leftValue.type != L || rightValue.type != R) {
+                        return deoptimize(leftValue, rightValue);
+                    }
+                    return Operators::Kernels::numeric<Op, L, R>(leftValue, rightValue);
+                }
+                std::string variant() const override {
+                    return capitalized(DataTypes::typeName(L)) + (L == R ? "" : capitalized(DataTypes::typeName(R))) + Op::label;
+                }
+        };
+        class StringConcat final : public SpecializedBinary {
+            public:
+                using SpecializedBinary::SpecializedBinary;
+
+                DataTypes::Data evaluate() override {
+                    DataTypes::Data leftValue = left->evaluate();
+                    DataTypes::Data rightValue = right->evaluate();
+                    if (!leftValue.is(DataTypes::Type::String) || !rightValue.is(DataTypes::Type::String)) {
+                        return deoptimize(leftValue, rightValue);
+                    }
+                    return Operators::Kernels::concatenate(leftValue, rightValue);
+                }
+                std::string variant() const override {
+                    return "StringConcat";
+                }
+        };
+        // Any other type pair: the guard is the same, the kernel is called through the pointer looked up once.
+        class KernelBinary final : public SpecializedBinary {
+            public:
+                DataTypes::Type leftType;
+                DataTypes::Type rightType;
+                Operators::Kernel kernel;
+
+                KernelBinary(BinaryExpression* generic, DataTypes::Type l, DataTypes::Type r)
+                    : SpecializedBinary(generic), leftType(l), rightType(r), kernel(Operators::lookup(generic->opcode, l, r)) {}
+
+                DataTypes::Data evaluate() override {
+                    DataTypes::Data leftValue = left->evaluate();
+                    DataTypes::Data rightValue = right->evaluate();
+                    if (leftValue.type != leftType || rightValue.type != rightType) {
+                        return deoptimize(leftValue, rightValue);
+                    }
+                    return kernel(leftValue, rightValue);
+                }
+                std::string variant() const override {
+                    return capitalized(DataTypes::typeName(leftType)) + capitalized(DataTypes::typeName(rightType))
+                        + "Kernel(" + Operators::symbol(opcode) + ")";
+                }
+        };
+
+        // The inlined variants for an arithmetic or comparison operator, or nullptr for other type pairs.
+        template<typename Op>
+        SpecializedBinary* makeNumeric(Arena& arena, BinaryExpression* node, DataTypes::Type l, DataTypes::Type r) {
+            using DataTypes::Type;
+            if (l == Type::Int && r == Type::Int) {
+                return arena.make<NumericBinary<Op, Type::Int, Type::Int>>(node);
+            }
+            if (l == Type::Double && r == Type::Double) {
+                return arena.make<NumericBinary<Op, Type::Double, Type::Double>>(node);
+            }
+            if (l == Type::Int && r == Type::Double) {
+                return arena.make<NumericBinary<Op, Type::Int, Type::Double>>(node);
+            }
+            if (l == Type::Double && r == Type::Int) {
+                return arena.make<NumericBinary<Op, Type::Double, Type::Int>>(node);
+            }
+            return nullptr;
+        }
+        // Bitwise operators and shifts only have an inlined variant for two ints.
+        template<typename Op>
+        SpecializedBinary* makeIntegral(Arena& arena, BinaryExpression* node, DataTypes::Type l, DataTypes::Type r) {
+            if (l == DataTypes::Type::Int && r == DataTypes::Type::Int) {
+                return arena.make<NumericBinary<Op, DataTypes::Type::Int, DataTypes::Type::Int>>(node);
+            }
+            return nullptr;
+        }
+        SpecializedBinary* makeVariant(Arena& arena, BinaryExpression* node, DataTypes::Type l, DataTypes::Type r) {
+            namespace K = Operators::Kernels;
+            SpecializedBinary* variant = nullptr;
+            switch (node->opcode) {
+                case Operators::Opcode::Add:
+                    if (l == DataTypes::Type::String && r == DataTypes::Type::String) {
+                        variant = arena.make<StringConcat>(node);
+                    } else {
+                        variant = makeNumeric<K::Add>(arena, node, l, r);
+                    }
+                    break;
+                case Operators::Opcode::Subtract: variant = makeNumeric<K::Subtract>(arena, node, l, r); break;
+                case Operators::Opcode::Multiply: variant = makeNumeric<K::Multiply>(arena, node, l, r); break;
+                case Operators::Opcode::Divide: variant = makeNumeric<K::Divide>(arena, node, l, r); break;
+                case Operators::Opcode::Modulo: variant = makeNumeric<K::Modulo>(arena, node, l, r); break;
+                case Operators::Opcode::BitAnd: variant = makeIntegral<K::BitAnd>(arena, node, l, r); break;
+                case Operators::Opcode::BitOr: variant = makeIntegral<K::BitOr>(arena, node, l, r); break;
+                case Operators::Opcode::BitXor: variant = makeIntegral<K::BitXor>(arena, node, l, r); break;
+                case Operators::Opcode::ShiftLeft: variant = makeIntegral<K::ShiftLeft>(arena, node, l, r); break;
+                case Operators::Opcode::ShiftRight: variant = makeIntegral<K::ShiftRight>(arena, node, l, r); break;
+                case Operators::Opcode::Equal: variant = makeNumeric<K::Equal>(arena, node, l, r); break;
+                case Operators::Opcode::NotEqual: variant = makeNumeric<K::NotEqual>(arena, node, l, r); break;
+                case Operators::Opcode::Less: variant = makeNumeric<K::Less>(arena, node, l, r); break;
+                case Operators::Opcode::Greater: variant = makeNumeric<K::Greater>(arena, node, l, r); break;
+                case Operators::Opcode::LessEqual: variant = makeNumeric<K::LessEqual>(arena, node, l, r); break;
+                case Operators::Opcode::GreaterEqual: variant = makeNumeric<K::GreaterEqual>(arena, node, l, r); break;
+                default: break;
+            }
+            return variant ? variant : arena.make<KernelBinary>(node, l, r);
+        }
+        void BinaryExpression::specialize(DataTypes::Type leftType, DataTypes::Type rightType) {
+            if (!Operators::lookup(opcode, leftType, rightType)) {
+                return; // A type error, reported by the caller
+            }
+            Arena* arena = parent ? owningArena(this) : nullptr;
+            if (!arena) {
+                generic = true;
+                return;
+            }
+            SpecializedBinary* replacement = makeVariant(*arena, this, leftType, rightType);
+            if (!parent->replaceChild(this, replacement)) {
+                generic = true;
+                return;
+            }
+            left->parent = replacement;
+            right->parent = replacement;
+            rewrites++;
+            specializationStats.specialized++;
+        }
+
+        // The unary counterpart of SpecializedBinary.
+        class SpecializedUnary : public UnaryExpression {
+            public:
+                UnaryExpression* original;
+                DataTypes::Type operandType;
+                Operators::UnaryKernel kernel;
+
+                SpecializedUnary(UnaryExpression* generic, DataTypes::Type type)
+                    : UnaryExpression(*generic), original(generic), operandType(type), kernel(Operators::lookup(generic->opcode, type)) {}
+
+                DataTypes::Data evaluate() override {
+                    DataTypes::Data operandValue = expr->evaluate();
+                    if (operandValue.type != operandType) {
+                        return deoptimize(operandValue);
+                    }
+                    return kernel(operandValue);
+                }
+                std::string variant() const override {
+                    static const char* labels[] = {"Negate", "Not", "BitNot"};
+                    return capitalized(DataTypes::typeName(operandType)) + labels[static_cast<std::size_t>(opcode)];
+                }
+                DataTypes::Data deoptimize(const DataTypes::Data& operandValue) {
+                    specializationStats.guardFailures++;
+                    original->parent = parent;
+                    original->expr = expr;
+                    expr->parent = original;
+                    parent->replaceChild(this, original);
+                    if (original->rewrites >= respecializeLimit) {
+                        original->generic = true;
+                        specializationStats.generalized++;
+                    } else {
+                        original->specialize(operandValue.type);
+                    }
+                    return Operators::apply(opcode, operandValue);
+                }
         };
+        // Negation of a fixed numeric type, inlined.
+        template<DataTypes::Type T>
+        class NegateUnary final : public SpecializedUnary {
+            public:
+                NegateUnary(UnaryExpression* generic) : SpecializedUnary(generic, T) {}
+
+                DataTypes::Data evaluate() override {
+                    DataTypes::Data operandValue = expr->evaluate();
+                    if (operandValue.type != T) {
+                        return deoptimize(operandValue);
+                    }
+                    return Operators::Kernels::negate<T>(operandValue);
+                }
+        };
+        void UnaryExpression::specialize(DataTypes::Type operandType) {
+            if (!Operators::lookup(opcode, operandType)) {
+                return;
+            }
+            Arena* arena = parent ? owningArena(this) : nullptr;
+            if (!arena) {
+                generic = true;
+                return;
+            }
+            SpecializedUnary* replacement;
+            if (opcode == Operators::UnaryOpcode::Negate && operandType == DataTypes::Type::Int) {
+                replacement = arena->make<NegateUnary<DataTypes::Type::Int>>(this);
+            } else if (opcode == Operators::UnaryOpcode::Negate && operandType == DataTypes::Type::Double) {
+                replacement = arena->make<NegateUnary<DataTypes::Type::Double>>(this);
+            } else {
+                replacement = arena->make<SpecializedUnary>(this, operandType);
+            }
+            if (!parent->replaceChild(this, replacement)) {
+                generic = true;
+                return;
+            }
+            expr->parent = replacement;
+            rewrites++;
+            specializationStats.specialized++;
+        }
 
         class Value : public Expression {
             public:
                 DataTypes::Data value;
-                Value(std::weak_ptr<Base> parentPointer, DataTypes::Data val) 
-                    : Expression(parentPointer, "Value: " + val.type), value(std::move(val)) {}
+                Value(Base* parentPointer, DataTypes::Data val) 
+                    : Expression(parentPointer, "Value"), value(std::move(val)) {}
 
                 virtual DataTypes::Data get() const {
                     return value;
                 }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override {
+                    DataTypes::Data constant = value;
+                    return [constant] { return constant; };
+                }
 
                 const JsonObject toJSON() const override {
                     JsonObject json = Expression::toJSON();
@@ -305,21 +1696,47 @@ namespace Nodes {
                 DataTypes::Data evaluate() override {
                     return get();
                 }
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::Value);
+                    switch (value.type) {
+                        case DataTypes::Type::Int:
+                            writer.u8(static_cast<uint8_t>(AstCache::ConstantTag::Int));
+                            writer.i64(value.integer);
+                            break;
+                        case DataTypes::Type::Double:
+                            writer.u8(static_cast<uint8_t>(AstCache::ConstantTag::Double));
+                            writer.f64(value.real);
+                            break;
+                        case DataTypes::Type::Bool:
+                            writer.u8(static_cast<uint8_t>(AstCache::ConstantTag::Bool));
+                            writer.u8(value.boolean ? 1 : 0);
+                            break;
+                        case DataTypes::Type::String:
+                            writer.u8(static_cast<uint8_t>(AstCache::ConstantTag::String));
+                            writer.string(value.asString());
+                            break;
+                        case DataTypes::Type::Null:
+                            writer.u8(static_cast<uint8_t>(AstCache::ConstantTag::Null));
+                            break;
+                        default:
+                            throw std::runtime_error("Value of type '" + std::string(DataTypes::typeName(value.type)) + "' cannot be cached.");
+                    }
+                }
         };
 
         class ArrayList : public Value {
             public:
-                std::vector<std::shared_ptr<Expression>> elements; // Updated to shared_ptr
+                std::vector<Expression*> elements; // Child nodes
 
-                ArrayList(std::weak_ptr<Base> parentPointer)
+                ArrayList(Base* parentPointer)
                     : Value(parentPointer, DataTypes::Null()) {
                     }
 
                 DataTypes::Data get() const override {
-                    return Value::getVar("arrayList");
+                    return DataTypes::Null(); // Containers are built by evaluate(), they have no constant value
                 }
                 const JsonObject toJSON() const override {
-                    JsonObject json = Value::toJSON();
+                    JsonObject json = Expression::toJSON();
                     JsonArray array;
                     for (const auto& elem : elements) {
                         array.append(elem->toJSON());
@@ -327,6 +1744,13 @@ namespace Nodes {
                     json.add("elements", array);
                     return json;
                 }
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::ArrayList);
+                    writer.u32(static_cast<uint32_t>(elements.size()));
+                    for (const Expression* elem : elements) {
+                        elem->serialize(writer);
+                    }
+                }
                 DataTypes::Data evaluate() override {
                     // Evaluate the elements in the array list
                     DataTypes::ArrayList evaluatedElements;
@@ -335,46 +1759,68 @@ namespace Nodes {
                     }
                     return DataTypes::Array(evaluatedElements);
                 }
-                void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
-                    if (start == end || *start != "[") {
+                void resolve(Resolver& resolver) override {
+                    for (Expression* elem : elements) {
+                        elem->resolve(resolver);
+                    }
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override {
+                    std::vector<CompiledExpression> items;
+                    items.reserve(elements.size());
+                    for (Expression* elem : elements) {
+                        items.push_back(elem->compile());
+                    }
+                    return [items = std::move(items)] {
+                        DataTypes::ArrayList values;
+                        values.reserve(items.size());
+                        for (const CompiledExpression& item : items) {
+                            values.push_back(DataTypes::Var(item()));
+                        }
+                        return DataTypes::Array(std::move(values));
+                    };
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    auto it = std::find(elements.begin(), elements.end(), from);
+                    if (it == elements.end()) {
+                        return false;
+                    }
+                    *it = to;
+                    return true;
+                }
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override {
+                    if (start == end || !start->is(Tokens::TokenKind::LeftBracket)) {
                         throw std::runtime_error("Expected '[' in array list.");
                     }
                     start++; // Move past '['
 
-                    while (start != end && *start != "]") {
-                        auto element = parse(start, end);
+                    while (start != end && !start->is(Tokens::TokenKind::RightBracket)) {
+                        Expression* element = parse(arena, start, end);
+                        element->parent = this;
                         elements.push_back(element); // Store the parsed element
-                        if (start != end && *start == ",") {
+                        if (start != end && start->is(Tokens::TokenKind::Comma)) {
                             start++; // Move past ','
                         }
                     }
-                    if (start == end || *start != "]") {
+                    if (start == end || !start->is(Tokens::TokenKind::RightBracket)) {
                         throw std::runtime_error("Expected ']' in array list.");
                     }
                     start++; // Move past ']'
                 }
-                DataTypes::Data evaluate() override {
-                    // Evaluate the elements in the array list
-                    DataTypes::ArrayList evaluatedElements;
-                    for (const auto& elem : elements) {
-                        evaluatedElements.push_back(DataTypes::Var(elem->evaluate()));
-                    }
-                    return DataTypes::Array(evaluatedElements);
-                }
         };
         class MapDictionary : public Value {
             public:
-                std::unordered_map<std::shared_ptr<Expression>, std::shared_ptr<Expression>> properties; // Updated to shared_ptr
+                std::vector<std::pair<Expression*, Expression*>> properties; // Key and value child nodes, in source order
 
-                MapDictionary(std::weak_ptr<Base> parentPointer)
+                MapDictionary(Base* parentPointer)
                     : Value(parentPointer, DataTypes::Null()) {
                     }
 
                 DataTypes::Data get() const override {
-                    return Value::getVar("mapDictionary");
+                    return DataTypes::Null(); // Containers are built by evaluate(), they have no constant value
                 }
                 const JsonObject toJSON() const override {
-                    JsonObject json = Value::toJSON();
+                    JsonObject json = Expression::toJSON();
                     JsonObject propertiesJson;
                     for (const auto& pair : properties) {
                         propertiesJson.add(pair.first->toJSON().toString(), pair.second->toJSON());
@@ -382,46 +1828,90 @@ namespace Nodes {
                     json.add("properties", propertiesJson);
                     return json;
                 }
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::MapDictionary);
+                    writer.u32(static_cast<uint32_t>(properties.size()));
+                    for (const auto& pair : properties) {
+                        pair.first->serialize(writer);
+                        pair.second->serialize(writer);
+                    }
+                }
                 DataTypes::Data evaluate() override {
                     // Evaluate the properties in the map dictionary
                     DataTypes::Dictionary evaluatedProperties;
+                    evaluatedProperties.reserve(properties.size());
                     for (const auto& pair : properties) {
                         // Evaluate the key
                         DataTypes::Data keyData = pair.first->evaluate();
 
-                        // Ensure the key is a Primitive
-                        auto keyPrimitive = dynamic_cast<DataTypes::Primitive*>(&keyData);
-                        if (!keyPrimitive) {
-                            throw std::runtime_error("Dictionary keys must be of type Primitive.");
-                        }
+                        // Ensure the key is a Primitive, throws otherwise
+                        DataTypes::Primitive keyPrimitive(keyData);
 
                         // Evaluate the value
                         DataTypes::Var valueVar = DataTypes::Var(pair.second->evaluate());
 
                         // Insert into the dictionary
-                        evaluatedProperties[*keyPrimitive] = valueVar;
+                        evaluatedProperties[keyPrimitive] = std::move(valueVar);
+                    }
+                    return DataTypes::Dict(std::move(evaluatedProperties));
+                }
+                void resolve(Resolver& resolver) override {
+                    for (const auto& pair : properties) {
+                        pair.first->resolve(resolver);
+                        pair.second->resolve(resolver);
+                    }
+                }
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override {
+                    std::vector<std::pair<CompiledExpression, CompiledExpression>> entries;
+                    entries.reserve(properties.size());
+                    for (const auto& pair : properties) {
+                        entries.emplace_back(pair.first->compile(), pair.second->compile());
+                    }
+                    return [entries = std::move(entries)] {
+                        DataTypes::Dictionary values;
+                        values.reserve(entries.size());
+                        for (const auto& [key, value] : entries) {
+                            DataTypes::Primitive keyPrimitive(key()); // Throws for keys that are not primitives
+                            values[keyPrimitive] = DataTypes::Var(value());
+                        }
+                        return DataTypes::Dict(std::move(values));
+                    };
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    for (auto& pair : properties) {
+                        if (pair.first == from) {
+                            pair.first = to;
+                            return true;
+                        }
+                        if (pair.second == from) {
+                            pair.second = to;
+                            return true;
+                        }
                     }
-                    return DataTypes::Dict(evaluatedProperties);
+                    return false;
                 }
-                void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
-                    if (start == end || *start != "{") {
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override {
+                    if (start == end || !start->is(Tokens::TokenKind::LeftBrace)) {
                         throw std::runtime_error("Expected '{' in map dictionary.");
                     }
                     start++; // Move past '{'
 
-                    while (start != end && *start != "}") {
-                        auto key = parse(start, end);
-                        if (start == end || *start != ":") {
+                    while (start != end && !start->is(Tokens::TokenKind::RightBrace)) {
+                        Expression* key = parse(arena, start, end);
+                        if (start == end || !start->is(Tokens::TokenKind::Colon)) {
                             throw std::runtime_error("Expected ':' in map dictionary.");
                         }
                         start++; // Move past ':'
-                        auto value = parse(start, end);
-                        properties[key] = value; // Store the parsed key-value pair
-                        if (start != end && *start == ",") {
+                        Expression* value = parse(arena, start, end);
+                        key->parent = this;
+                        value->parent = this;
+                        properties.emplace_back(key, value); // Store the parsed key-value pair
+                        if (start != end && start->is(Tokens::TokenKind::Comma)) {
                             start++; // Move past ','
                         }
                     }
-                    if (start == end || *start != "}") {
+                    if (start == end || !start->is(Tokens::TokenKind::RightBrace)) {
                         throw std::runtime_error("Expected '}' in map dictionary.");
                     }
                     start++; // Move past '}'
@@ -431,32 +1921,339 @@ namespace Nodes {
 
         class VariableAccessor : public Expression {
             protected:
-                VariableAccessor(std::weak_ptr<Base> parentPointer, std::shared_ptr<Expression> expr) 
+                VariableAccessor(Base* parentPointer, Expression* expr) 
                     : Expression(parentPointer, "variable"), expression(expr) {
                     }
             public:
-                std::shared_ptr<Expression> expression; // Updated to shared_ptr
+                Expression* expression; // Dynamic name, only set by subclasses
+                Symbols::SymbolId symbol = Symbols::none; // Interned name when the variable is named in the script
+                Address address; // Set by the resolver for named variables that have a slot
                 
-                VariableAccessor(std::weak_ptr<Base> parentPointer, std::string n) 
-                    : Expression(parentPointer, "variable"), expression(std::make_shared<Value>(std::weak_ptr<Base>(shared_from_this()), DataTypes::String(n))) {
+                VariableAccessor(Base* parentPointer, Symbols::SymbolId id) 
+                    : Expression(parentPointer, "variable"), expression(nullptr), symbol(id) {
                     }
 
+                const JsonObject toJSON() const override {
+                    JsonObject json = Expression::toJSON();
+                    if (symbol != Symbols::none) {
+                        json.add("name", Symbols::toString(symbol));
+                    }
+                    return json;
+                }
                 const DataTypes::Var& getVar() const {
+                    if (!expression) {
+                        return address.resolved() ? address.var() : Expression::getVar(symbol);
+                    }
                     DataTypes::Data value = expression->evaluate();
-                    DataTypes::Primitive* primitive = dynamic_cast<DataTypes::Primitive*>(&value);
-                    if (primitive) {
-                        return Expression::getVar(static_cast<std::string>(*primitive)); // Assuming the primitive can be cast to a string
-                    } 
+                    if (value.isHeap() && !value.is(DataTypes::Type::String)) {
+                        throw std::runtime_error("Variable name must be a primitive.");
+                    }
+                    return Expression::getVar(Symbols::intern(value.toString()));
                 }
                 // Evaluate the expression and return the value
                 DataTypes::Data evaluate() override {
                     return getVar().data;
                 }
+                void resolve(Resolver& resolver) override;
+                uint8_t emit(Bytecode::Compiler& compiler) override;
+                CompiledExpression compile() override;
+                void serialize(AstCache::Writer& writer) const override {
+                    if (expression) {
+                        Expression::serialize(writer); // Dynamic names are not cached
+                    }
+                    writer.tag(AstCache::NodeTag::VariableAccessor);
+                    writer.symbol(symbol);
+                }
 
             
         };
         class VariableDeclaration; // A variable that is a reference to a value.
-        class VariableProperty; // A property of a variable, array, or dict which is itself a variable.
+        // A property read, `enemy.hp`. Reads from class instances go through the site's inline cache.
+        class VariableProperty : public Expression {
+            public:
+                Expression* object;
+                Symbols::SymbolId property;
+                PropertyCache cache;
+
+                VariableProperty(Base* parentPointer, Expression* objectExpression, Symbols::SymbolId id)
+                    : Expression(parentPointer, "property"), object(objectExpression), property(id) {
+                    }
+
+                const JsonObject toJSON() const override {
+                    JsonObject json = Expression::toJSON();
+                    json.add("object", object->toJSON());
+                    json.add("name", Symbols::toString(property));
+                    return json;
+                }
+                DataTypes::Data evaluate() override {
+                    return cache.read(object->evaluate(), property).data;
+                }
+                void resolve(Resolver& resolver) override {
+                    object->resolve(resolver);
+                }
+                CompiledExpression compile() override {
+                    return [this, object = object->compile()] {
+                        return cache.read(object(), property).data;
+                    };
+                }
+                bool replaceChild(Expression* from, Expression* to) override {
+                    if (object != from) {
+                        return false;
+                    }
+                    object = to;
+                    return true;
+                }
+                void serialize(AstCache::Writer& writer) const override {
+                    writer.tag(AstCache::NodeTag::VariableProperty);
+                    object->serialize(writer);
+                    writer.symbol(property);
+                }
+        };
+
+        const JsonObject AssignmentExpression::toJSON() const {
+            JsonObject json = Expression::toJSON();
+            json.add("operator", std::string(Tokens::kindName(op)));
+            json.add("target", target->toJSON());
+            json.add("value", value ? value->toJSON() : JsonObject());
+            return json;
+        }
+        DataTypes::Data AssignmentExpression::evaluate() {
+            DataTypes::Data result = value->evaluate();
+            if (op != Tokens::TokenKind::Assign) {
+                result = Operators::apply(Operators::binaryOpcode(compoundOperator(op)), target->evaluate(), result);
+            }
+            if (address.resolved()) {
+                address.var().data = result;
+                return result;
+            }
+            // Not resolved yet, for nodes evaluated outside a program
+            Block* scope = nullptr;
+            for (Base* node = parent; node; node = node->parent) {
+                Block* block = dynamic_cast<Block*>(node);
+                if (!block) {
+                    continue;
+                }
+                if (!scope) {
+                    scope = block; // Innermost block, where new variables are declared
+                }
+                if (block->findVar(target->symbol)) {
+                    scope = block;
+                    break;
+                }
+            }
+            if (!scope) {
+                throw std::runtime_error("Assignment to '" + Symbols::toString(target->symbol) + "' outside of a block.");
+            }
+            scope->setVar(target->symbol, result);
+            return result;
+        }
+        // Closure compilation
+
+        // The constant behind a plain Value node, or nullptr. Containers derive from Value but are built at run time.
+        const DataTypes::Data* constantOf(const Expression* expr) {
+            if (typeid(*expr) == typeid(Value)) {
+                return &static_cast<const Value*>(expr)->value;
+            }
+            return nullptr;
+        }
+        CompiledExpression constant(DataTypes::Data value) {
+            return [value = std::move(value)] { return value; };
+        }
+
+        CompiledExpression BinaryExpression::compile() {
+            const DataTypes::Data* leftConstant = constantOf(left);
+            const DataTypes::Data* rightConstant = constantOf(right);
+            if (leftConstant && rightConstant) {
+                try {
+                    return constant(Operators::apply(opcode, *leftConstant, *rightConstant));
+                } catch (const std::runtime_error&) {
+                    // Not folded, the error is raised when the code runs, as it is in the tree
+                }
+            }
+            // The operator's row of the kernel table is bound now, only the operand types are looked at per run.
+            const Operators::Kernel (*row)[Operators::typeCount] = Operators::table.binary[static_cast<std::size_t>(opcode)];
+            Operators::Opcode code = opcode;
+            return [l = left->compile(), r = right->compile(), row, code] {
+                DataTypes::Data leftValue = l();
+                DataTypes::Data rightValue = r();
+                Operators::Kernel kernel = row[static_cast<std::size_t>(leftValue.type)][static_cast<std::size_t>(rightValue.type)];
+                if (!kernel) {
+                    Operators::unsupported(code, leftValue, rightValue);
+                }
+                return kernel(leftValue, rightValue);
+            };
+        }
+        CompiledExpression UnaryExpression::compile() {
+            if (const DataTypes::Data* operandConstant = constantOf(expr)) {
+                try {
+                    return constant(Operators::apply(opcode, *operandConstant));
+                } catch (const std::runtime_error&) {
+                }
+            }
+            const Operators::UnaryKernel* row = Operators::table.unary[static_cast<std::size_t>(opcode)];
+            Operators::UnaryOpcode code = opcode;
+            return [operand = expr->compile(), row, code] {
+                DataTypes::Data value = operand();
+                Operators::UnaryKernel kernel = row[static_cast<std::size_t>(value.type)];
+                if (!kernel) {
+                    Operators::unsupported(code, value);
+                }
+                return kernel(value);
+            };
+        }
+        void VariableAccessor::resolve(Resolver& resolver) {
+            if (expression) {
+                expression->resolve(resolver);
+                return;
+            }
+            address = resolver.lookup(symbol);
+        }
+        void AssignmentExpression::resolve(Resolver& resolver) {
+            value->resolve(resolver); // Before the name is declared, so a = a + 1 reads the outer a if there is one
+            address = resolver.declare(target->symbol);
+            target->address = address;
+        }
+        CompiledExpression VariableAccessor::compile() {
+            if (expression) {
+                return Expression::compile(); // Dynamic names are looked up on every run
+            }
+            return [slot = VariableSlot(this, symbol, address)]() mutable {
+                return slot.read();
+            };
+        }
+        CompiledExpression AssignmentExpression::compile() {
+            VariableSlot slot(this, target->symbol, address);
+            if (op == Tokens::TokenKind::Assign) {
+                return [slot, value = value->compile()]() mutable {
+                    DataTypes::Data result = value();
+                    slot.write().data = result;
+                    return result;
+                };
+            }
+            Operators::Opcode code = Operators::binaryOpcode(compoundOperator(op));
+            return [slot, value = value->compile(), code]() mutable {
+                DataTypes::Data result = value();
+                result = Operators::apply(code, slot.read(), result);
+                slot.write().data = result;
+                return result;
+            };
+        }
+
+        // Bytecode emission. Each node leaves its value in the register it allocates first, so an expression's
+        // temporaries sit above its result and are released once they are consumed.
+
+        // The value of an operator tree whose leaves are all constants, or nothing. Operations that would throw
+        // are left for run time, as they are in the tree.
+        std::optional<DataTypes::Data> fold(const Expression* expr) {
+            if (const DataTypes::Data* value = constantOf(expr)) {
+                return *value;
+            }
+            try {
+                if (auto binary = dynamic_cast<const BinaryExpression*>(expr)) {
+                    std::optional<DataTypes::Data> left = fold(binary->left);
+                    std::optional<DataTypes::Data> right = left ? fold(binary->right) : std::nullopt;
+                    if (right) {
+                        return Operators::apply(binary->opcode, *left, *right);
+                    }
+                } else if (auto unary = dynamic_cast<const UnaryExpression*>(expr)) {
+                    if (std::optional<DataTypes::Data> operand = fold(unary->expr)) {
+                        return Operators::apply(unary->opcode, *operand);
+                    }
+                } else if (auto parenthesis = dynamic_cast<const ParenthesisExpression*>(expr)) {
+                    return fold(parenthesis->expr);
+                }
+            } catch (const std::runtime_error&) {
+            }
+            return std::nullopt;
+        }
+        Bytecode::Register emitConstant(Bytecode::Compiler& compiler, const DataTypes::Data& value) {
+            Bytecode::Register result = compiler.allocate();
+            compiler.emit(Bytecode::encodeBx(Bytecode::Op::LoadConst, result, compiler.constant(value)));
+            return result;
+        }
+
+        uint8_t StatementCondition::emit(Bytecode::Compiler& compiler) {
+            return condition->emit(compiler);
+        }
+        uint8_t ParenthesisExpression::emit(Bytecode::Compiler& compiler) {
+            return expr->emit(compiler);
+        }
+        uint8_t Value::emit(Bytecode::Compiler& compiler) {
+            return emitConstant(compiler, value);
+        }
+        uint8_t BinaryExpression::emit(Bytecode::Compiler& compiler) {
+            if (std::optional<DataTypes::Data> folded = fold(this)) {
+                return emitConstant(compiler, *folded);
+            }
+            Bytecode::Register result = left->emit(compiler);
+            Bytecode::Register operand = right->emit(compiler);
+            compiler.emit(Bytecode::encode(Bytecode::binaryOp(opcode), result, result, operand));
+            compiler.release(operand);
+            return result;
+        }
+        uint8_t UnaryExpression::emit(Bytecode::Compiler& compiler) {
+            if (std::optional<DataTypes::Data> folded = fold(this)) {
+                return emitConstant(compiler, *folded);
+            }
+            Bytecode::Register result = expr->emit(compiler);
+            compiler.emit(Bytecode::encode(Bytecode::unaryOp(opcode), result, result));
+            return result;
+        }
+        uint8_t ArrayList::emit(Bytecode::Compiler& compiler) {
+            if (elements.size() > UINT8_MAX) {
+                return Expression::emit(compiler); // Too many elements for one instruction
+            }
+            Bytecode::Register result = compiler.allocate();
+            for (Expression* elem : elements) {
+                elem->emit(compiler); // Lands in the next register up
+            }
+            compiler.emit(Bytecode::encode(Bytecode::Op::NewArray, result, static_cast<uint8_t>(result + 1),
+                static_cast<uint8_t>(elements.size())));
+            compiler.release(result + 1);
+            return result;
+        }
+        uint8_t MapDictionary::emit(Bytecode::Compiler& compiler) {
+            if (properties.size() > UINT8_MAX / 2) {
+                return Expression::emit(compiler);
+            }
+            Bytecode::Register result = compiler.allocate();
+            for (const auto& pair : properties) {
+                pair.first->emit(compiler);
+                pair.second->emit(compiler);
+            }
+            compiler.emit(Bytecode::encode(Bytecode::Op::NewDict, result, static_cast<uint8_t>(result + 1),
+                static_cast<uint8_t>(properties.size())));
+            compiler.release(result + 1);
+            return result;
+        }
+        uint8_t VariableAccessor::emit(Bytecode::Compiler& compiler) {
+            if (expression) {
+                return Expression::emit(compiler); // Dynamic names are looked up on every run
+            }
+            Bytecode::Register result = compiler.allocate();
+            compiler.emit(Bytecode::encodeBx(Bytecode::Op::GetVar, result, compiler.slot(this, symbol, address)));
+            return result;
+        }
+        uint8_t AssignmentExpression::emit(Bytecode::Compiler& compiler) {
+            uint16_t slot = compiler.slot(this, target->symbol, address);
+            Bytecode::Register result = value->emit(compiler);
+            if (op != Tokens::TokenKind::Assign) {
+                Bytecode::Register current = compiler.allocate();
+                compiler.emit(Bytecode::encodeBx(Bytecode::Op::GetVar, current, slot));
+                compiler.emit(Bytecode::encode(Bytecode::binaryOp(Operators::binaryOpcode(compoundOperator(op))),
+                    result, current, result));
+                compiler.release(current);
+            }
+            compiler.emit(Bytecode::encodeBx(Bytecode::Op::SetVar, result, slot));
+            return result;
+        }
+
+        void AssignmentExpression::serialize(AstCache::Writer& writer) const {
+            writer.tag(AstCache::NodeTag::AssignmentExpression);
+            writer.u8(static_cast<uint8_t>(op));
+            writer.symbol(target->symbol);
+            value->serialize(writer);
+        }
 
         // Obsolete code for Variable class
         // class Variable : public Value {
@@ -479,8 +2276,9 @@ namespace Nodes {
         class ClassReference : public Expression {
             public:
                 std::string className;
-                ClassReference(std::weak_ptr<Base> parentPointer, std::string name) 
-                    : Expression(parentPointer, "ClassReference"), className(name) {
+                Symbols::SymbolId classSymbol;
+                ClassReference(Base* parentPointer, std::string name) 
+                    : Expression(parentPointer, "ClassReference"), className(name), classSymbol(Symbols::intern(name)) {
                     }
 
                 const JsonObject toJSON() const override {
@@ -488,9 +2286,8 @@ namespace Nodes {
                     json.add("className", className);
                     return json;
                 }
-                DataTypes::Class& get() const {
-                    DataTypes::Class classType = Expression::getClass(className);
-                    return classType;
+                const DataTypes::Class& get() const {
+                    return Expression::getClass(classSymbol);
                 }
                 DataTypes::Data evaluate() override {
                     // Should not be evaluated directly, but can be used to get the class type.
@@ -501,253 +2298,763 @@ namespace Nodes {
     } // namespace Expressions
     
     namespace Statements {
-       void IfStatement::process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
+       void IfStatement::process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) {
             
-            if (start == end || *start != "if") {
+            if (start == end || !start->is(Tokens::TokenKind::If)) {
                 throw std::runtime_error("Expected 'if' keyword.");
             }
             start++;
 
-            expression = std::make_shared<Expressions::StatementCondition>(shared_from_this()); // Updated to shared_ptr
-            expression->process(start, end); // Process the condition
-            body = std::make_shared<Blocks::StatementBlock>(shared_from_this()); // Updated to shared_ptr
-            body->process(start, end); // Process the body block
+            expression = arena.make<Expressions::StatementCondition>(this);
+            expression->process(arena, start, end); // Process the condition
+            body = arena.make<Blocks::StatementBlock>(this);
+            body->process(arena, start, end); // Process the body block
 
         }
+        void ExpressionStatement::process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) {
+            expression = parse(arena, start, end);
+            expression->parent = this;
+            if (start == end || !start->is(Tokens::TokenKind::Semicolon)) {
+                throw std::runtime_error("Expected ';' after expression.");
+            }
+            start++; // Move past ';'
+        }
         const JsonObject IfStatement::toJSON() const {
             JsonObject json = Statement::toJSON();
             json.add("body", body->toJSON());
             return json;
         }
+        void IfStatement::serialize(AstCache::Writer& writer) const {
+            writer.tag(AstCache::NodeTag::IfStatement);
+            expression->serialize(writer);
+            body->serialize(writer);
+        }
+        void IfStatement::execute() {
+            if (expression->evaluate().truthy()) {
+                body->execute();
+            }
+        }
+        CompiledStatement IfStatement::compileStatement() {
+            CompiledExpression condition = expression->compile();
+            CompiledStatement then = body->compile();
+            return [condition = std::move(condition), then = std::move(then)] {
+                if (condition().truthy()) {
+                    then();
+                }
+            };
+        }
+        void IfStatement::emitStatement(Bytecode::Compiler& compiler) {
+            Bytecode::Register mark = compiler.top();
+            Bytecode::Register condition = expression->emit(compiler);
+            std::size_t skip = compiler.jump(Bytecode::Op::JumpIfFalse, condition);
+            compiler.release(mark);
+            body->emit(compiler);
+            compiler.patch(skip);
+        }
+        void IfStatement::resolve(Resolver& resolver) {
+            expression->resolve(resolver);
+            body->resolve(resolver);
+        }
+        void ExpressionStatement::execute() {
+            expression->evaluate();
+        }
+        CompiledStatement ExpressionStatement::compileStatement() {
+            CompiledExpression compiled = expression->compile();
+            return [compiled = std::move(compiled)] { compiled(); };
+        }
+        void ExpressionStatement::emitStatement(Bytecode::Compiler& compiler) {
+            Bytecode::Register mark = compiler.top();
+            expression->emit(compiler);
+            compiler.release(mark);
+        }
+        void ExpressionStatement::serialize(AstCache::Writer& writer) const {
+            writer.tag(AstCache::NodeTag::ExpressionStatement);
+            expression->serialize(writer);
+        }
     }
 
     
-    void Block::setVar(const std::string& label, DataTypes::Data value) {
-        if (variables.find(label) != variables.end()) {
-            variables[label] = DataTypes::Var(value); // Update existing variable
+    void Block::setVar(Symbols::SymbolId label, DataTypes::Data value) {
+        auto slot = slotNames.find(label);
+        if (slot != slotNames.end()) {
+            slots[slot->second].data = std::move(value);
+            return;
+        }
+        variables[label].data = std::move(value); // Declared at run time
+    }
+    DataTypes::Var* Block::findVar(Symbols::SymbolId label) {
+        auto slot = slotNames.find(label);
+        if (slot != slotNames.end()) {
+            return &slots[slot->second];
         }
-        variables[label].data = value; // Add new variable
+        auto it = variables.find(label);
+        return it == variables.end() ? nullptr : &it->second;
     }
     void Block::addClass(DataTypes::Class& classType) { // TO DO: Define checks so default class types are not overwritten.
-        if (classTypes.find(classType.name) != classTypes.end()) {
-            classTypes[classType.name] = classType; // Update existing class type
+        DataTypes::TypeRegistry::instance().add(classType);
+        Symbols::SymbolId id = Symbols::intern(classType.name);
+        if (classTypes.find(id) != classTypes.end()) {
+            classTypes.erase(id); // Replace existing class type
         }
-        classTypes[classType.name] = classType; // Add new class type
+        classTypes.emplace(id, classType); // Add new class type
     }
 
 
-    const DataTypes::Var& Block::getVar(const std::string& label) const {
-        auto it = variables.find(label);
-        if (it == variables.end()) {
-            return Base::getVar(label);
+    const DataTypes::Var& Block::getVar(Symbols::SymbolId label) const {
+        if (const DataTypes::Var* var = const_cast<Block*>(this)->findVar(label)) {
+            return *var;
         }
-        return it->second;
+        return Base::getVar(label);
     }
-    const DataTypes::Class& Block::getClass(const std::string& label) const {
+    const DataTypes::Class& Block::getClass(Symbols::SymbolId label) const {
         auto it = classTypes.find(label);
         if (it == classTypes.end()) {
             return Base::getClass(label);
         }
         return it->second;
     }
-    void Block::process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
-        while (start != end) {
-            std::string token = *start;
-            if (token == "if") {
-                auto ifStmt = std::make_shared<Nodes::Statements::IfStatement>(shared_from_this());
-                stmts.push_back(ifStmt);
-                ifStmt->process(start, end);
+    void Block::process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) {
+        // Every statement consumes exactly its own tokens, so the stream is walked once however deep blocks nest.
+        while (start != end && !start->is(Tokens::TokenKind::RightBrace)) {
+            Statement* stmt;
+            switch (start->kind) {
+                case Tokens::TokenKind::Semicolon:
+                    start++; // Empty statement
+                    continue;
+                case Tokens::TokenKind::If:
+                    stmt = arena.make<Nodes::Statements::IfStatement>(this);
+                    break;
+                default:
+                    stmt = arena.make<Nodes::Statements::ExpressionStatement>(this);
+                    break;
             }
-            start++;
+            stmts.push_back(stmt);
+            stmt->process(arena, start, end);
         }
     }
 
     namespace Blocks {
-        void StatementBlock::process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end)  {
-            // Process the block of statements
-            int depth = 1; // To handle nested blocks, we need a depth counter.
+        void StatementBlock::process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end)  {
             // Make sure we start with a '{'
-            if (*start != "{") {
+            if (start == end || !start->is(Tokens::TokenKind::LeftBrace)) {
                 throw std::runtime_error("Expected '{' in block.");
             }
             // Move past the '{'
             start++;
 
-            std::vector<std::string>::iterator blockEnd = start;
-            // These loops are just to find the end of the block. Processing the block comes after.
-            while (depth > 0 && blockEnd != end) {
-                std::string token = *blockEnd;
-                if (token == "}") {
-                    if (--depth == 0) {
-                        break;
-                    }
-                }
-                else if (token == "{") {
-                    depth++; // Nested block
-                }
-                blockEnd++;
-            }
-            if (depth > 0) {
+            // Statements are parsed straight from the shared stream; nested blocks find their own '}' the same way.
+            Block::process(arena, start, end);
+            if (start == end) {
                 throw std::runtime_error("Unmatched '{' in block.");
             }
-            std::vector<std::string> blockTokens(start, blockEnd);
-            auto it = blockTokens.begin();
-            Block::process(it, blockTokens.end()); // Process the block tokens
+            start++; // Move past the '}'
         }
     }
 
-    const DataTypes::Var& Body::getVar(const std::string& label) const {
+    const DataTypes::Var& Body::getVar(Symbols::SymbolId label) const {
         // Body should the top level scope, so throw an error if the variable is not found.
-        auto it = variables.find(label);
-        if (it == variables.end()) {
-            throw std::runtime_error("Variable '" + label + "' not found in script scope.");
+        if (const DataTypes::Var* var = const_cast<Body*>(this)->findVar(label)) {
+            return *var;
         }
-        return it->second;
+        throw std::runtime_error("Variable '" + Symbols::toString(label) + "' not found in script scope.");
     }
-    const DataTypes::Class& Body::getClass(const std::string& label) const {
+    const DataTypes::Class& Body::getClass(Symbols::SymbolId label) const {
         // Body should the top level scope, so throw an error if the class is not found.
         auto it = classTypes.find(label);
-        if (it == classTypes.end()) {
-            throw std::runtime_error("Class '" + label + "' not found in script scope.");
+        if (it != classTypes.end()) {
+            return it->second;
         }
-        return it->second;
+        DataTypes::TypeRegistry& registry = DataTypes::TypeRegistry::instance();
+        DataTypes::TypeId id = registry.find(label);
+        if (id == DataTypes::noType) {
+            throw std::runtime_error("Class '" + Symbols::toString(label) + "' not found in script scope.");
+        }
+        return registry.get(id);
     }
 
     
-    std::shared_ptr<Nodes::Expression> parse(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end, uint32_t level = 0) {
-        if (level >= operatorLevels.size()) {
-            return parseFactor(start, end);
-        }
-        // Parse the first term
-        auto left = parse(start, end, level + 1);
-    
-        // Handle binary operators (+, -)
-        while (start != end && (std::find(operatorLevels[level].begin(), operatorLevels[level].end(), *start) != operatorLevels[level].end())) {
-            std::string op = *start;
+    // Pratt parser: parses a factor, then keeps folding in infix operators that bind tighter than `minPower`.
+    // Each operator costs one table lookup, so an expression is parsed in a single pass over its tokens.
+    Nodes::Expression* parse(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end, uint8_t minPower) {
+        Nodes::Expression* left = parseFactor(arena, start, end);
+
+        while (start != end) {
+            Tokens::TokenKind op = start->kind;
+            const BindingPower& power = bindingPowers[static_cast<std::size_t>(op)];
+            if (power.left <= minPower) {
+                break; // Not an infix operator, or one that belongs to an enclosing call
+            }
             start++; // Move past the operator
-    
-            // Parse the right-hand side term
-            auto right = parse(start, end, level + 1);
-    
-            // Create a BinaryExpression node
-            auto binaryExpr = std::make_shared<Nodes::Expressions::BinaryExpression>(std::weak_ptr<Nodes::Base>(), left, op);
-            if (!binaryExpr) {
-                throw std::runtime_error("Expected BinaryExpression while assigning right operand.");
+
+            if (isAssignment(op)) {
+                auto target = dynamic_cast<Nodes::Expressions::VariableAccessor*>(left);
+                if (!target || target->symbol == Symbols::none) {
+                    throw std::runtime_error("Invalid assignment target before '" + std::string(Tokens::kindName(op)) + "'.");
+                }
+                auto assignExpr = arena.make<Nodes::Expressions::AssignmentExpression>(nullptr, target, op);
+                assignExpr->value = parse(arena, start, end, power.right);
+                assignExpr->target->parent = assignExpr;
+                assignExpr->value->parent = assignExpr;
+                left = assignExpr;
+                continue;
             }
-            binaryExpr->right = right;
-            binaryExpr->left->parent = std::weak_ptr<Nodes::Base>(binaryExpr);
-            binaryExpr->right->parent = std::weak_ptr<Nodes::Base>(binaryExpr);
+
+            // Create a BinaryExpression node
+            auto binaryExpr = arena.make<Nodes::Expressions::BinaryExpression>(nullptr, left, op);
+            binaryExpr->right = parse(arena, start, end, power.right);
+            binaryExpr->left->parent = binaryExpr;
+            binaryExpr->right->parent = binaryExpr;
             left = binaryExpr;
         }
-    
         return left;
     }
-    std::shared_ptr<Nodes::Expression> parseFactor(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
+    // Property reads bind tighter than any operator: `-enemy.hp` negates the property.
+    Nodes::Expression* parsePostfix(Arena& arena, Nodes::Expression* expr, Tokens::Iterator& start, Tokens::Iterator end) {
+        while (start != end && start->is(Tokens::TokenKind::Dot)) {
+            start++; // Move past '.'
+            if (start == end || !start->is(Tokens::TokenKind::Identifier)) {
+                throw std::runtime_error("Expected a property name after '.'.");
+            }
+            auto property = arena.make<Nodes::Expressions::VariableProperty>(nullptr, expr, start->symbol);
+            expr->parent = property;
+            expr = property;
+            start++; // Move past the name
+        }
+        return expr;
+    }
+    Nodes::Expression* parseFactor(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) {
         if (start == end) {
             throw std::runtime_error("Unexpected end of tokens while parsing factor.");
         }
     
-        std::string token = *start;
+        const Tokens::Token& token = *start;
     
         // Handle parentheses
-        if (token == "(") {
+        if (token.is(Tokens::TokenKind::LeftParen)) {
             start++; // Move past '('
-            auto expr = parse(start, end, 0);
-            if (start == end || *start != ")") {
+            Nodes::Expression* expr = parse(arena, start, end);
+            if (start == end || !start->is(Tokens::TokenKind::RightParen)) {
                 throw std::runtime_error("Expected ')' after expression.");
             }
             start++; // Move past ')'
-            return expr;
+            return parsePostfix(arena, expr, start, end);
         }
     
-        // Handle unary operators (-, !)
-        if (token == "-" || token == "!") {
+        // Handle unary operators (-, !, ~)
+        if (token.is(Tokens::TokenKind::Minus) || token.is(Tokens::TokenKind::Bang) || token.is(Tokens::TokenKind::Tilde)) {
             start++; // Move past the operator
-            auto operand = parseFactor(start, end);
-            auto uni_expr = std::make_shared<Nodes::Expressions::UnaryExpression>(std::weak_ptr<Nodes::Base>(), token, operand);
-            uni_expr->expr->parent = std::weak_ptr<Nodes::Base>(uni_expr);
+            Nodes::Expression* operand = parseFactor(arena, start, end);
+            auto uni_expr = arena.make<Nodes::Expressions::UnaryExpression>(nullptr, token.kind, operand);
+            uni_expr->expr->parent = uni_expr;
             return uni_expr;
         }
 
-        if (token == "true" || token == "false") {
-            start++; // Move past the boolean
-            return std::make_shared<Nodes::Expressions::Value>(std::weak_ptr<Nodes::Base>(), "Boolean", token == "true");
-        }
-
         // Handle dictionaries (also called maps)
-        if (token == "{") {
-            std::shared_ptr<Nodes::Expressions::MapDictionary> dictExpressions = std::make_shared<Nodes::Expressions::MapDictionary>(std::weak_ptr<Nodes::Base>());
-            dictExpressions->process(start, end); // Process the dictionary
+        if (token.is(Tokens::TokenKind::LeftBrace)) {
+            auto dictExpressions = arena.make<Nodes::Expressions::MapDictionary>(nullptr);
+            dictExpressions->process(arena, start, end); // Process the dictionary
             return dictExpressions;
         }
 
         // Handle arrays
-        if (token == "[") {
-            std::shared_ptr<Nodes::Expressions::ArrayList> arrayExpressions = std::make_shared<Nodes::Expressions::ArrayList>(std::weak_ptr<Nodes::Base>());
-            arrayExpressions->process(start, end); // Process the array
+        if (token.is(Tokens::TokenKind::LeftBracket)) {
+            auto arrayExpressions = arena.make<Nodes::Expressions::ArrayList>(nullptr);
+            arrayExpressions->process(arena, start, end); // Process the array
             return arrayExpressions;
         }
     
-        // Handle numbers
-        if (std::isdigit(token[0])) {
+        // Handle numbers (already parsed by the lexer)
+        if (token.is(Tokens::TokenKind::Int)) {
             start++; // Move past the number
-            if (*start == ".") {
-                start++;
-                token += "."+(*start);
-                start++;
-            }
-            return std::make_shared<Nodes::Expressions::Value>(std::weak_ptr<Nodes::Base>(), "Number", std::stoi(token));
+            return arena.make<Nodes::Expressions::Value>(nullptr, DataTypes::Int(static_cast<int>(token.integer)));
+        }
+        if (token.is(Tokens::TokenKind::Double)) {
+            start++; // Move past the number
+            return arena.make<Nodes::Expressions::Value>(nullptr, DataTypes::Double(token.real));
         }
     
+        // Handle booleans and null
+        if (token.is(Tokens::TokenKind::True) || token.is(Tokens::TokenKind::False)) {
+            start++; // Move past the boolean
+            return arena.make<Nodes::Expressions::Value>(nullptr, DataTypes::Bool(token.is(Tokens::TokenKind::True)));
+        }
+        if (token.is(Tokens::TokenKind::Null)) {
+            start++; // Move past the null
+            return arena.make<Nodes::Expressions::Value>(nullptr, DataTypes::Null());
+        }
+
         // Handle variables
-        if (std::isalpha(token[0])) {
-            start++; // Move past the variable
+        if (token.is(Tokens::TokenKind::Identifier)) {
+            start++; // Move past the identifier
             // TO DO: Make a variables
-            return std::make_shared<Nodes::Expressions::VariableAccessor>(std::weak_ptr<Nodes::Base>(), token);
+            return parsePostfix(arena, arena.make<Nodes::Expressions::VariableAccessor>(nullptr, token.symbol), start, end);
         }
 
         // Handle string literals
-        if (token == "\"") {
-            // Move past the opening quote
-            start++;
- 
-            // Get the string value
-            std::string strValue;
-            if (*start == "\"") {
-                strValue = "";
-            } else {
-                strValue = *start++;
-            }
-            // Move past the closing quote value
-            start++;
-            return std::make_shared<Nodes::Expressions::Value>(std::weak_ptr<Nodes::Base>(), "String", strValue);
+        if (token.is(Tokens::TokenKind::String)) {
+            start++; // Move past the string
+            return arena.make<Nodes::Expressions::Value>(nullptr, DataTypes::String(std::string(token.stringValue())));
         }
     
-        throw std::runtime_error("Unexpected token: " + token);
+        throw std::runtime_error("Unexpected token: " + std::string(token.text));
+    }
+    Nodes::Statement* readStatement(Arena& arena, AstCache::Reader& reader, Base* parent) {
+        switch (reader.tag()) {
+            case AstCache::NodeTag::IfStatement: {
+                auto ifStmt = arena.make<Statements::IfStatement>(parent);
+                auto condition = arena.make<Expressions::StatementCondition>(ifStmt);
+                condition->condition = readExpression(arena, reader, condition);
+                ifStmt->expression = condition;
+                ifStmt->body = arena.make<Blocks::StatementBlock>(ifStmt);
+                ifStmt->body->deserialize(arena, reader);
+                return ifStmt;
+            }
+            case AstCache::NodeTag::ExpressionStatement: {
+                auto exprStmt = arena.make<Statements::ExpressionStatement>(parent);
+                exprStmt->expression = readExpression(arena, reader, exprStmt);
+                return exprStmt;
+            }
+            default:
+                throw std::runtime_error("Invalid statement tag in AST cache.");
+        }
+    }
+    Nodes::Expression* readExpression(Arena& arena, AstCache::Reader& reader, Base* parent) {
+        switch (reader.tag()) {
+            case AstCache::NodeTag::BinaryExpression: {
+                auto op = static_cast<Tokens::TokenKind>(reader.u8());
+                auto binaryExpr = arena.make<Expressions::BinaryExpression>(parent, nullptr, op);
+                binaryExpr->left = readExpression(arena, reader, binaryExpr);
+                binaryExpr->right = readExpression(arena, reader, binaryExpr);
+                return binaryExpr;
+            }
+            case AstCache::NodeTag::UnaryExpression: {
+                auto op = static_cast<Tokens::TokenKind>(reader.u8());
+                auto uni_expr = arena.make<Expressions::UnaryExpression>(parent, op, nullptr);
+                uni_expr->expr = readExpression(arena, reader, uni_expr);
+                return uni_expr;
+            }
+            case AstCache::NodeTag::AssignmentExpression: {
+                auto op = static_cast<Tokens::TokenKind>(reader.u8());
+                auto target = arena.make<Expressions::VariableAccessor>(nullptr, reader.symbol());
+                auto assignExpr = arena.make<Expressions::AssignmentExpression>(parent, target, op);
+                target->parent = assignExpr;
+                assignExpr->value = readExpression(arena, reader, assignExpr);
+                return assignExpr;
+            }
+            case AstCache::NodeTag::Value:
+                switch (static_cast<AstCache::ConstantTag>(reader.u8())) {
+                    case AstCache::ConstantTag::Int:
+                        return arena.make<Expressions::Value>(parent, DataTypes::Int(static_cast<int>(reader.i64())));
+                    case AstCache::ConstantTag::Double:
+                        return arena.make<Expressions::Value>(parent, DataTypes::Double(reader.f64()));
+                    case AstCache::ConstantTag::Bool:
+                        return arena.make<Expressions::Value>(parent, DataTypes::Bool(reader.u8() != 0));
+                    case AstCache::ConstantTag::String:
+                        return arena.make<Expressions::Value>(parent, DataTypes::String(std::string(reader.string())));
+                    case AstCache::ConstantTag::Null:
+                        return arena.make<Expressions::Value>(parent, DataTypes::Null());
+                    default:
+                        throw std::runtime_error("Invalid constant tag in AST cache.");
+                }
+            case AstCache::NodeTag::ArrayList: {
+                auto arrayExpressions = arena.make<Expressions::ArrayList>(parent);
+                uint32_t count = reader.u32();
+                for (uint32_t i = 0; i < count; i++) {
+                    arrayExpressions->elements.push_back(readExpression(arena, reader, arrayExpressions));
+                }
+                return arrayExpressions;
+            }
+            case AstCache::NodeTag::MapDictionary: {
+                auto dictExpressions = arena.make<Expressions::MapDictionary>(parent);
+                uint32_t count = reader.u32();
+                for (uint32_t i = 0; i < count; i++) {
+                    Expression* key = readExpression(arena, reader, dictExpressions);
+                    Expression* value = readExpression(arena, reader, dictExpressions);
+                    dictExpressions->properties.emplace_back(key, value);
+                }
+                return dictExpressions;
+            }
+            case AstCache::NodeTag::VariableAccessor:
+                return arena.make<Expressions::VariableAccessor>(parent, reader.symbol());
+            case AstCache::NodeTag::VariableProperty: {
+                auto property = arena.make<Expressions::VariableProperty>(parent, nullptr, Symbols::none);
+                property->object = readExpression(arena, reader, property);
+                property->property = reader.symbol();
+                return property;
+            }
+            default:
+                throw std::runtime_error("Invalid expression tag in AST cache.");
+        }
     }
     // Example of a class reference:
     // className
-    Expressions::ClassReference& parseClassReference(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end) {
+    Expressions::ClassReference* parseClassReference(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) {
         if (start == end) {
             throw std::runtime_error("Unexpected end of tokens while parsing class reference.");
         }
-        std::string className = *start;
+        std::string className(start->text);
         start++; // Move past the class name
         if (className.empty() || !std::isalnum(className[0])) {
             throw std::runtime_error("Invalid class: " + className);
         }
-        Expressions::ClassReference classRef(std::weak_ptr<Nodes::Base>(), className);
-        return classRef;
+        return arena.make<Expressions::ClassReference>(nullptr, className);
+    }
+}
+
+// Parser tests inspect the expression nodes, so they come after the node classes.
+namespace ProcessorTests {
+    // Writes an expression tree as nested prefix groups, e.g. (+ 1 (* 2 3)).
+    std::string shape(const Nodes::Expression* expr) {
+        using namespace Nodes::Expressions;
+        if (auto binary = dynamic_cast<const BinaryExpression*>(expr)) {
+            return "(" + std::string(Tokens::kindName(binary->op)) + " " + shape(binary->left) + " " + shape(binary->right) + ")";
+        }
+        if (auto assign = dynamic_cast<const AssignmentExpression*>(expr)) {
+            return "(" + std::string(Tokens::kindName(assign->op)) + " " + shape(assign->target) + " " + shape(assign->value) + ")";
+        }
+        if (auto unary = dynamic_cast<const UnaryExpression*>(expr)) {
+            return "(" + std::string(Tokens::kindName(unary->op)) + " " + shape(unary->expr) + ")";
+        }
+        if (auto variable = dynamic_cast<const VariableAccessor*>(expr)) {
+            return Symbols::toString(variable->symbol);
+        }
+        if (auto value = dynamic_cast<const Value*>(expr); value && value->value.is(DataTypes::Type::Int)) {
+            return std::to_string(value->value.integer);
+        }
+        return "?";
+    }
+    void testPrattParser() {
+        printf("Testing Pratt Parser...\n");
+        auto parseText = [](Nodes::Arena& arena, const std::string& text) {
+            Tokens::TokenStream stream = Tokenizer::lex(text);
+            Tokens::Iterator start = stream.begin();
+            std::string result = shape(Nodes::parse(arena, start, stream.end()));
+            assertEqual(true, start == stream.end());
+            return result;
+        };
+        Nodes::Arena arena;
+        assertEqual(std::string("(+ 1 (% (* 2 3) 4))"), parseText(arena, "1 + 2 * 3 % 4"));
+        assertEqual(std::string("(- (- a b) c)"), parseText(arena, "a - b - c"));
+        assertEqual(std::string("(| (& a b) (^ c (<< d 1)))"), parseText(arena, "a & b | c ^ d << 1"));
+        assertEqual(std::string("(|| (&& a b) (== c (< d e)))"), parseText(arena, "a && b || c == d < e"));
+        assertEqual(std::string("(= a (+= b (>> c 2)))"), parseText(arena, "a = b += c >> 2"));
+        assertEqual(std::string("(* (- a) (~ (+ b 1)))"), parseText(arena, "-a * ~(b + 1)"));
+        bool rejected = false;
+        try {
+            parseText(arena, "1 = a");
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testResolver() {
+        printf("Testing Resolver...\n");
+        using namespace Nodes::Expressions;
+        Nodes::Program program;
+        program.body->setVar("input", DataTypes::Int(3));
+        program.process(Tokenizer::lex("a = input; if (a) { b = a + 1; if (b) { a = b * 2; c = a + b; } } d = a; e = late;"));
+        auto assignment = [](Nodes::Block* block, std::size_t index) {
+            return static_cast<AssignmentExpression*>(block->stmts[index]->expression);
+        };
+        Nodes::Block* outer = program.body;
+        Nodes::Block* middle = static_cast<Nodes::Statements::IfStatement*>(outer->stmts[1])->body;
+        Nodes::Block* inner = static_cast<Nodes::Statements::IfStatement*>(middle->stmts[1])->body;
+        // Host variables set before parsing become slots, and so do names first assigned in the outermost block.
+        // Names first assigned in a nested block stay by name, the host may still add them to an outer block.
+        assertEqual(4, static_cast<int>(outer->slots.size())); // input, a, d, e
+        assertEqual(0, static_cast<int>(middle->slots.size()));
+        assertEqual(0, static_cast<int>(inner->slots.size()));
+        AssignmentExpression* innerA = assignment(inner, 0);
+        assertEqual(2, static_cast<int>(innerA->address.depth));
+        assertEqual(outer->slotNames.at(Symbols::intern("a")), innerA->address.slot);
+        auto b = static_cast<VariableAccessor*>(static_cast<BinaryExpression*>(innerA->value)->left);
+        assertEqual(false, b->address.resolved());
+        assertEqual(false, assignment(inner, 1)->address.resolved());
+        // A name no block has when it is read stays unresolved and is found by name at run time.
+        auto late = static_cast<VariableAccessor*>(assignment(outer, 3)->value);
+        assertEqual(false, late->address.resolved());
+        program.body->setVar("late", DataTypes::Int(9));
+        program.run();
+        assertEqual(8, program.body->getVar(Symbols::intern("a")).data.integer);
+        assertEqual(4, middle->getVar(Symbols::intern("b")).data.integer);
+        assertEqual(12, inner->getVar(Symbols::intern("c")).data.integer);
+        assertEqual(8, program.body->getVar(Symbols::intern("d")).data.integer);
+        assertEqual(9, program.body->getVar(Symbols::intern("e")).data.integer);
+        // Host writes to resolved names land in the slot the script reads.
+        program.body->setVar("input", DataTypes::Int(0));
+        program.run();
+        assertEqual(0, program.body->getVar(Symbols::intern("d")).data.integer);
+        // A host variable set after parsing is not shadowed by a nested assignment to the same name.
+        for (Nodes::ExecutionMode mode : {Nodes::ExecutionMode::Tree, Nodes::ExecutionMode::Closures, Nodes::ExecutionMode::Bytecode}) {
+            Nodes::Program late;
+            late.mode = mode;
+            late.process(Tokenizer::lex("if (c) { y = x; x = 5; } z = x;"));
+            late.body->setVar("c", DataTypes::Int(1));
+            late.body->setVar("x", DataTypes::Int(7));
+            late.run();
+            Nodes::Block* body = static_cast<Nodes::Statements::IfStatement*>(late.body->stmts[0])->body;
+            assertEqual(7, body->getVar(Symbols::intern("y")).data.integer);
+            assertEqual(5, late.body->getVar(Symbols::intern("x")).data.integer);
+            assertEqual(5, late.body->getVar(Symbols::intern("z")).data.integer);
+        }
+    }
+    void testSpecialization() {
+        printf("Testing Specialization...\n");
+        using namespace Nodes::Expressions;
+        Nodes::specializationStats = Nodes::SpecializationStats();
+        Nodes::Program program;
+        program.body->setVar("a", DataTypes::Int(6));
+        program.body->setVar("b", DataTypes::Int(2));
+        program.body->setVar("c", DataTypes::Double(2.5));
+        program.body->setVar("s", DataTypes::String("x"));
+        program.process(Tokenizer::lex("x = a + b; y = a < c; z = s + s; n = -a;"));
+        auto site = [&](int index) {
+            return static_cast<AssignmentExpression*>(program.body->stmts[index]->expression)->value;
+        };
+        auto run = [&](int index) {
+            return program.body->stmts[index]->expression->evaluate();
+        };
+        auto variant = [&](int index) {
+            Nodes::Expression* node = site(index);
+            if (auto binary = dynamic_cast<BinaryExpression*>(node)) {
+                return binary->variant();
+            }
+            return static_cast<UnaryExpression*>(node)->variant();
+        };
+        // Each site rewrites itself on its first evaluation and keeps its shape for the parser and the cache.
+        assertEqual(std::string("Generic"), variant(0));
+        for (int i = 0; i < 4; i++) {
+            run(i);
+        }
+        assertEqual(std::string("IntAdd"), variant(0));
+        assertEqual(std::string("IntDoubleLess"), variant(1));
+        assertEqual(std::string("StringConcat"), variant(2));
+        assertEqual(std::string("IntNegate"), variant(3));
+        assertEqual(std::string("(+ a b)"), shape(site(0)));
+        assertEqual(4, static_cast<int>(Nodes::specializationStats.specialized));
+        assertEqual(8, run(0).integer);
+        assertEqual(false, run(1).boolean);
+        assertEqual(std::string("xx"), run(2).asString());
+        assertEqual(-6, run(3).integer);
+        // A failed guard still gives the right result and respecializes for the new types.
+        program.body->setVar("b", DataTypes::Double(0.5));
+        assertEqual(6.5, run(0).real);
+        assertEqual(std::string("IntDoubleAdd"), variant(0));
+        assertEqual(1, static_cast<int>(Nodes::specializationStats.guardFailures));
+        // Past the limit the site stays generic and keeps working for every type pair.
+        program.body->setVar("b", DataTypes::Int(1));
+        assertEqual(7, run(0).integer);
+        assertEqual(std::string("Generic"), variant(0));
+        assertEqual(1, static_cast<int>(Nodes::specializationStats.generalized));
+        program.body->setVar("b", DataTypes::Double(1.0));
+        assertEqual(7.0, run(0).real);
+        assertEqual(std::string("Generic"), variant(0));
+        assertEqual(2, static_cast<int>(Nodes::specializationStats.guardFailures));
+        // Type errors do not specialize.
+        program.body->setVar("a", DataTypes::String("y"));
+        bool rejected = false;
+        try {
+            run(3);
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+        assertEqual(std::string("Generic"), variant(3));
+    }
+    void testShapes() {
+        printf("Testing Shapes...\n");
+        static DataTypes::Class entity("Entity");
+        entity.addProperty("hp", DataTypes::Int(10));
+        entity.addProperty("speed", DataTypes::Double(1.5));
+        entity.addMethod(DataTypes::Function("attack", {}, nullptr));
+        // Instances of a class share its shapes, adding properties in the same order leads to the same shape.
+        DataTypes::ClassInstance first(entity);
+        DataTypes::ClassInstance second(entity);
+        assertEqual(true, first.get().shape == second.get().shape);
+        assertEqual(2, static_cast<int>(first.get().shape->size()));
+        first.get().set(Symbols::intern("target"), DataTypes::Int(1));
+        second.get().set(Symbols::intern("target"), DataTypes::Int(2));
+        assertEqual(true, first.get().shape == second.get().shape);
+        first.get().set(Symbols::intern("hp"), DataTypes::Int(3)); // Existing properties keep the shape
+        assertEqual(true, first.get().shape == second.get().shape);
+        assertEqual(3, first.getProperty(Symbols::intern("hp")).data.integer);
+        DataTypes::ClassInstance third(entity);
+        assertEqual(false, third.get().shape == first.get().shape);
+        // Scripts read properties through the site's inline cache, in every execution mode.
+        for (Nodes::ExecutionMode mode : {Nodes::ExecutionMode::Tree, Nodes::ExecutionMode::Closures, Nodes::ExecutionMode::Bytecode}) {
+            Nodes::Program program;
+            program.mode = mode;
+            program.body->setVar("a", first);
+            program.body->setVar("d", DataTypes::Dict(DataTypes::Dictionary{{DataTypes::String("x"), DataTypes::Var(DataTypes::Int(4))}}));
+            program.process(Tokenizer::lex("hp = a.hp; total = -a.hp + (a).target * 10 + d.x; method = a.attack;"));
+            program.run();
+            program.run();
+            assertEqual(3, program.body->findVar(Symbols::intern("hp"))->data.integer);
+            assertEqual(11, program.body->findVar(Symbols::intern("total"))->data.integer);
+            assertEqual(std::string("attack"), program.body->findVar(Symbols::intern("method"))->data.toString());
+        }
+        // A site that sees several shapes keeps them all, up to its ways.
+        Nodes::Program program;
+        program.process(Tokenizer::lex("hp = a.hp;"));
+        auto site = static_cast<Nodes::Expressions::VariableProperty*>(
+            static_cast<Nodes::Expressions::AssignmentExpression*>(program.body->stmts[0]->expression)->value);
+        std::vector<DataTypes::Data> instances = {first, third};
+        for (int i = 0; i < 3; i++) {
+            DataTypes::ClassInstance extra(entity);
+            extra.get().set(Symbols::intern("extra" + std::to_string(i)), DataTypes::Null());
+            instances.push_back(extra);
+        }
+        for (std::size_t i = 0; i < instances.size(); i++) {
+            program.body->setVar("a", instances[i]);
+            program.run();
+            program.run();
+            assertEqual(i == 0 ? 3 : 10, program.body->findVar(Symbols::intern("hp"))->data.integer);
+            assertEqual(std::min<int>(static_cast<int>(i) + 1, 4), static_cast<int>(site->cache.size()));
+        }
+        assertEqual(true, site->cache.megamorphic());
+        // Property reads survive the AST cache.
+        std::string script = "x = (a.b).c + -d.e;";
+        std::string path = "shapes_test.hypec";
+        Nodes::Program parsed;
+        parsed.process(Tokenizer::lex(script));
+        AstCache::save(parsed, script, path);
+        Nodes::Program loaded;
+        assertEqual(true, AstCache::load(loaded, script, path));
+        assertEqual(toStr(parsed.body->toJSON()), toStr(loaded.body->toJSON()));
+        std::remove(path.c_str());
+        bool rejected = false;
+        try {
+            Nodes::Program missing;
+            missing.body->setVar("a", first);
+            missing.process(Tokenizer::lex("x = a.mana;"));
+            missing.run();
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assertEqual(true, rejected);
+    }
+    void testShapeReuse() {
+        printf("Testing Shape Reuse...\n");
+        // A site that cached a shape of a freed class does not hit on a new class's shape at the same address.
+        auto makeClass = [](const std::string& prefix) {
+            auto type = std::make_unique<DataTypes::Class>(prefix);
+            for (int i = 0; i < 3; i++) {
+                type->addProperty(prefix + std::to_string(i), DataTypes::Int(i == 2 ? 9 : i));
+            }
+            return type;
+        };
+        Nodes::Program program;
+        program.process(Tokenizer::lex("v = a.p2;"));
+        // Classes made before and after the freed one, so the allocator has used up the memory it had cached and
+        // hands out the freed shapes' memory again.
+        std::vector<std::unique_ptr<DataTypes::Class>> later;
+        for (int i = 0; i < 16; i++) {
+            later.push_back(makeClass("r"));
+            DataTypes::ClassInstance(*later.back());
+        }
+        auto first = makeClass("p");
+        program.body->setVar("a", DataTypes::ClassInstance(*first));
+        program.run();
+        assertEqual(9, program.body->findVar(Symbols::intern("v"))->data.integer);
+        program.body->setVar("a", DataTypes::Null());
+        uint64_t freed = static_cast<DataTypes::InstanceObject*>(DataTypes::ClassInstance(*first).object)->shape->id();
+        first.reset();
+        for (int i = 0; i < 8; i++) {
+            later.push_back(makeClass("q"));
+            DataTypes::ClassInstance instance(*later.back());
+            assertEqual(false, instance.get().shape->id() == freed);
+            program.body->setVar("a", instance);
+            bool rejected = false;
+            try {
+                program.run();
+            } catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            assertEqual(true, rejected);
+        }
+        program.body->setVar("a", DataTypes::Null());
+    }
+    void testMethodTables() {
+        printf("Testing Method Tables...\n");
+        auto method = [](const DataTypes::Data* function) {
+            if (function == nullptr) {
+                return std::string("none");
+            }
+            const auto& object = *static_cast<DataTypes::FunctionObject*>(function->object);
+            return object.name + "/" + std::to_string(object.args.size());
+        };
+        auto base = std::make_shared<DataTypes::Class>("Base");
+        base->addMethod(DataTypes::Function("move", {}, nullptr));
+        base->addMethod(DataTypes::Function("draw", {}, nullptr));
+        auto middle = std::make_shared<DataTypes::Class>("Middle", std::unordered_map<Symbols::SymbolId, DataTypes::Data>{}, base);
+        middle->addMethod(DataTypes::Function("draw", {"layer"}, nullptr));
+        auto leaf = std::make_shared<DataTypes::Class>("Leaf", std::unordered_map<Symbols::SymbolId, DataTypes::Data>{}, middle);
+        leaf->addMethod(DataTypes::Function("jump", {}, nullptr));
+        // Overrides take the slot of the method they override, new methods come after the inherited ones.
+        Symbols::SymbolId move = Symbols::intern("move"), draw = Symbols::intern("draw"), jump = Symbols::intern("jump");
+        assertEqual(3, static_cast<int>(leaf->methodTable().size()));
+        assertEqual(0, static_cast<int>(leaf->methodSlot(move)));
+        assertEqual(1, static_cast<int>(leaf->methodSlot(draw)));
+        assertEqual(2, static_cast<int>(leaf->methodSlot(jump)));
+        assertEqual(std::string("draw/1"), method(leaf->findMethod(draw)));
+        assertEqual(std::string("draw/0"), method(base->findMethod(draw)));
+        assertEqual(std::string("none"), method(base->findMethod(jump)));
+        assertEqual(true, leaf->getProperty(move).data.object == base->methodTable()[0].object);
+        // Changing a class reaches the tables of its subclasses.
+        base->addMethod(DataTypes::Function("jump", {"height"}, nullptr));
+        base->addMethod(DataTypes::Function("stop", {}, nullptr));
+        assertEqual(4, static_cast<int>(leaf->methodTable().size()));
+        assertEqual(2, static_cast<int>(leaf->methodSlot(jump)));
+        assertEqual(std::string("jump/0"), method(leaf->findMethod(jump)));
+        assertEqual(std::string("stop/0"), method(leaf->findMethod(Symbols::intern("stop"))));
+        DataTypes::ClassInstance instance(*leaf);
+        Nodes::Program program;
+        program.body->setVar("a", instance);
+        program.process(Tokenizer::lex("m = a.draw;"));
+        program.run();
+        assertEqual(std::string("draw/1"), method(&program.body->findVar(Symbols::intern("m"))->data));
+        // A new parent moves the slots, and the site's cached slot is looked up again.
+        leaf->setParent(base);
+        assertEqual(2, static_cast<int>(leaf->methodSlot(jump)));
+        program.run();
+        assertEqual(std::string("draw/0"), method(&program.body->findVar(Symbols::intern("m"))->data));
+        // Copies build tables of their own.
+        DataTypes::Class copy = *leaf;
+        copy.addMethod(DataTypes::Function("draw", {"a", "b"}, nullptr));
+        assertEqual(std::string("draw/2"), method(copy.findMethod(draw)));
+        assertEqual(std::string("draw/0"), method(leaf->findMethod(draw)));
     }
 }
 
 class Interpreter {
     public:
-        void process(std::string in) {
-            std::vector<std::string> tokens = Tokenizer::process(in);
-            Nodes::Body body;
-            auto it = tokens.begin();
-            body.process(it, tokens.end()); // Assuming process is a method that interprets the tokens and populates the body
+        Nodes::ExecutionMode mode = Nodes::ExecutionMode::Tree;
+
+        void process(std::string_view in) {
+            process(Tokenizer::lex(in));
+        }
+        // Loads a .hype file through a read-only mapping instead of reading it into a string.
+        // The parsed program is cached next to the source (.hypec) and reused until the source changes.
+        void processFile(const std::string& path) {
+            Sources::MappedFile source(path);
+            std::string cache = AstCache::cachePath(path);
+            Nodes::Program program;
+            program.mode = mode;
+            if (!AstCache::load(program, source.view(), cache)) {
+                program.process(Tokenizer::lexFile(path));
+                try {
+                    AstCache::save(program, source.view(), cache);
+                } catch (const std::runtime_error&) {
+                    // The cache only speeds up the next start, a read-only directory is not an error.
+                }
+            }
+            program.run();
+        }
+        void process(const Tokens::TokenStream& tokens) {
+            Nodes::Program program;
+            program.mode = mode;
+            program.process(tokens);
+            program.run();
         }
 };
 
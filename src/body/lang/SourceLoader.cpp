@@ -0,0 +1,111 @@
+#include <string>
+#include <stdexcept>
+#include "../../head/lang/SourceLoader.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Sources {
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string& p) : path(p) {
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Could not open source file '" + path + "'.");
+        }
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("Could not read the size of '" + path + "'.");
+        }
+        fileHandle = file;
+        length = static_cast<std::size_t>(fileSize.QuadPart);
+        if (length == 0) {
+            return; // Empty files cannot be mapped, an empty view is enough.
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            throw std::runtime_error("Could not map source file '" + path + "'.");
+        }
+        mappingHandle = mapping;
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Could not map source file '" + path + "'.");
+        }
+    }
+    MappedFile::~MappedFile() {
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle) {
+            CloseHandle(static_cast<HANDLE>(mappingHandle));
+        }
+        if (fileHandle) {
+            CloseHandle(static_cast<HANDLE>(fileHandle));
+        }
+    }
+    void MappedFile::adviseSequential() const {
+        // FILE_FLAG_SEQUENTIAL_SCAN was already given when the file was opened.
+    }
+    void MappedFile::release(std::size_t offset, std::size_t bytes) const {
+        if (!data || bytes == 0) {
+            return;
+        }
+        // Unlocking pages that are not locked removes them from the working set.
+        VirtualUnlock(const_cast<char*>(data) + offset, bytes);
+    }
+#else
+    MappedFile::MappedFile(const std::string& p) : path(p) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open source file '" + path + "'.");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not read the size of '" + path + "'.");
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        if (length == 0) {
+            close(fd);
+            return; // Empty files cannot be mapped, an empty view is enough.
+        }
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps its own reference to the file
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Could not map source file '" + path + "'.");
+        }
+        data = static_cast<const char*>(mapping);
+    }
+    MappedFile::~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), length);
+        }
+    }
+    void MappedFile::adviseSequential() const {
+        if (data) {
+            madvise(const_cast<char*>(data), length, MADV_SEQUENTIAL);
+        }
+    }
+    void MappedFile::release(std::size_t offset, std::size_t bytes) const {
+        if (!data || bytes == 0) {
+            return;
+        }
+        // madvise needs page aligned ranges, so only whole pages inside the range are dropped.
+        std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t first = (offset + page - 1) / page * page;
+        std::size_t last = (offset + bytes) / page * page;
+        if (last > first) {
+            madvise(const_cast<char*>(data) + first, last - first, MADV_DONTNEED);
+        }
+    }
+#endif
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "../../head/lang/Symbols.h"
+
+namespace Symbols {
+    namespace {
+        // Names are split over shards by hash so parallel lexers rarely wait on the same lock.
+        constexpr std::size_t shardCount = 16;
+        // Id -> name is a two level table, so readers index it without a lock and it never moves.
+        constexpr std::size_t segmentBits = 12;
+        constexpr std::size_t segmentSize = std::size_t(1) << segmentBits;
+        constexpr std::size_t maxSegments = 4096;
+        constexpr std::size_t textBlockSize = 64 * 1024;
+
+        struct Shard {
+            std::shared_mutex mutex;
+            std::unordered_map<std::string_view, SymbolId> ids;
+            // Interned text lives in large blocks that are never freed, so views into them stay valid.
+            std::vector<std::unique_ptr<char[]>> blocks;
+            char* current = nullptr; // The block short names are bump allocated from; long names get their own
+            std::size_t blockUsed = textBlockSize;
+
+            std::string_view store(std::string_view text) {
+                if (text.size() > textBlockSize / 4) {
+                    blocks.emplace_back(new char[text.size()]);
+                    std::copy(text.begin(), text.end(), blocks.back().get());
+                    return std::string_view(blocks.back().get(), text.size());
+                }
+                if (blockUsed + text.size() > textBlockSize) {
+                    blocks.emplace_back(new char[textBlockSize]);
+                    current = blocks.back().get();
+                    blockUsed = 0;
+                }
+                char* destination = current + blockUsed;
+                std::copy(text.begin(), text.end(), destination);
+                blockUsed += text.size();
+                return std::string_view(destination, text.size());
+            }
+        };
+
+        struct Table {
+            Shard shards[shardCount];
+            std::atomic<SymbolId> nextId{0};
+            std::mutex segmentMutex;
+            std::atomic<std::string_view*> segments[maxSegments] = {};
+
+            ~Table() {
+                for (auto& segment : segments) {
+                    delete[] segment.load();
+                }
+            }
+
+            std::string_view* slot(SymbolId id) {
+                std::atomic<std::string_view*>& segment = segments[id >> segmentBits];
+                std::string_view* names = segment.load(std::memory_order_acquire);
+                if (!names) {
+                    std::lock_guard<std::mutex> lock(segmentMutex);
+                    names = segment.load(std::memory_order_relaxed);
+                    if (!names) {
+                        names = new std::string_view[segmentSize];
+                        segment.store(names, std::memory_order_release);
+                    }
+                }
+                return &names[id & (segmentSize - 1)];
+            }
+        };
+
+        Table& table() {
+            static Table instance;
+            return instance;
+        }
+
+        Shard& shardFor(std::string_view name) {
+            return table().shards[std::hash<std::string_view>()(name) % shardCount];
+        }
+    }
+
+    SymbolId intern(std::string_view name) {
+        Shard& shard = shardFor(name);
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto it = shard.ids.find(name);
+            if (it != shard.ids.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.ids.find(name); // Another thread may have added it in between
+        if (it != shard.ids.end()) {
+            return it->second;
+        }
+        SymbolId id = table().nextId.fetch_add(1);
+        if (id >= segmentSize * maxSegments) {
+            throw std::runtime_error("Too many distinct identifiers.");
+        }
+        std::string_view stored = shard.store(name);
+        *table().slot(id) = stored;
+        shard.ids.emplace(stored, id);
+        return id;
+    }
+
+    SymbolId find(std::string_view name) {
+        Shard& shard = shardFor(name);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.ids.find(name);
+        return it != shard.ids.end() ? it->second : none;
+    }
+
+    std::string_view name(SymbolId id) {
+        if (id >= table().nextId.load()) {
+            throw std::runtime_error("Unknown symbol id " + std::to_string(id) + ".");
+        }
+        return *table().slot(id);
+    }
+
+    std::string toString(SymbolId id) {
+        return std::string(name(id));
+    }
+
+    std::size_t count() {
+        return table().nextId.load();
+    }
+}
@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+#include "../../head/lang/Token.h"
+
+namespace Tokens {
+    std::vector<std::string> TokenStream::toStrings() const {
+        std::vector<std::string> result;
+        result.reserve(tokens.size());
+        for (const Token& token : tokens) {
+            result.emplace_back(token.text);
+        }
+        return result;
+    }
+
+    const char* kindName(TokenKind kind) {
+        switch (kind) {
+            case TokenKind::Unknown: return "Unknown";
+            case TokenKind::Identifier: return "Identifier";
+            case TokenKind::Int: return "Int";
+            case TokenKind::Double: return "Double";
+            case TokenKind::String: return "String";
+            case TokenKind::LeftParen: return "(";
+            case TokenKind::RightParen: return ")";
+            case TokenKind::LeftBrace: return "{";
+            case TokenKind::RightBrace: return "}";
+            case TokenKind::LeftBracket: return "[";
+            case TokenKind::RightBracket: return "]";
+            case TokenKind::Comma: return ",";
+            case TokenKind::Colon: return ":";
+            case TokenKind::DoubleColon: return "::";
+            case TokenKind::Semicolon: return ";";
+            case TokenKind::Dot: return ".";
+            case TokenKind::Plus: return "+";
+            case TokenKind::Minus: return "-";
+            case TokenKind::Star: return "*";
+            case TokenKind::Slash: return "/";
+            case TokenKind::Percent: return "%";
+            case TokenKind::Power: return "**";
+            case TokenKind::Bang: return "!";
+            case TokenKind::Tilde: return "~";
+            case TokenKind::Assign: return "=";
+            case TokenKind::Less: return "<";
+            case TokenKind::Greater: return ">";
+            case TokenKind::Equal: return "==";
+            case TokenKind::NotEqual: return "!=";
+            case TokenKind::LessEqual: return "<=";
+            case TokenKind::GreaterEqual: return ">=";
+            case TokenKind::And: return "&&";
+            case TokenKind::Or: return "||";
+            case TokenKind::PlusAssign: return "+=";
+            case TokenKind::MinusAssign: return "-=";
+            case TokenKind::StarAssign: return "*=";
+            case TokenKind::SlashAssign: return "/=";
+            case TokenKind::PercentAssign: return "%=";
+            case TokenKind::Increment: return "++";
+            case TokenKind::Decrement: return "--";
+            case TokenKind::Ampersand: return "&";
+            case TokenKind::Pipe: return "|";
+            case TokenKind::Caret: return "^";
+            case TokenKind::ShiftLeft: return "<<";
+            case TokenKind::ShiftRight: return ">>";
+            case TokenKind::AmpersandAssign: return "&=";
+            case TokenKind::PipeAssign: return "|=";
+            case TokenKind::CaretAssign: return "^=";
+            case TokenKind::ShiftLeftAssign: return "<<=";
+            case TokenKind::ShiftRightAssign: return ">>=";
+            case TokenKind::If: return "if";
+            case TokenKind::Else: return "else";
+            case TokenKind::While: return "while";
+            case TokenKind::For: return "for";
+            case TokenKind::Break: return "break";
+            case TokenKind::Continue: return "continue";
+            case TokenKind::Return: return "return";
+            case TokenKind::Class: return "class";
+            case TokenKind::Switch: return "switch";
+            case TokenKind::Case: return "case";
+            case TokenKind::Import: return "import";
+            case TokenKind::True: return "true";
+            case TokenKind::False: return "false";
+            case TokenKind::Null: return "null";
+        }
+        return "Unknown";
+    }
+}
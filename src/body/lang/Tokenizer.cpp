@@ -0,0 +1,269 @@
+#include <string>
+#include <string_view>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+#include <charconv>
+#include <cctype> // for isalpha
+#include "../../head/lang/Tokenizer.h"
+#include "../../head/lang/symbolTable.h"
+#include "../../head/lang/scanner.h"
+#include "../../head/util/ThreadPool.h"
+
+using Tokens::Token;
+using Tokens::TokenKind;
+
+namespace {
+    bool isIdentifierStart(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // Longest operator or punctuation symbol (<<= and >>=).
+    constexpr std::size_t maxSymbolLength = 3;
+
+    // Matches the longest operator or punctuation symbol at `p`. Returns its length, or 0 if `p` is not a symbol.
+    std::size_t matchSymbol(const char* p, const char* end, TokenKind& kind) {
+        std::size_t available = std::min<std::size_t>(maxSymbolLength, end - p);
+        for (std::size_t length = available; length > 0; length--) {
+            kind = SymbolTable::lookup(std::string_view(p, length));
+            if (kind != TokenKind::Unknown) {
+                return length;
+            }
+        }
+        return 0;
+    }
+}
+
+Tokens::TokenStream Tokenizer::lex(std::string_view input) {
+    Tokens::TokenStream stream(input);
+    // Most tokens are a few characters long, so this avoids nearly all regrowth of the token list.
+    stream.tokens.reserve(input.size() / 4 + 16);
+    lexChunk(stream, 0, input.size(), true);
+    return stream;
+}
+
+Tokens::TokenStream Tokenizer::lexFile(const std::string& path, std::size_t chunkSize) {
+    std::shared_ptr<Sources::MappedFile> file = std::make_shared<Sources::MappedFile>(path);
+    file->adviseSequential();
+    Tokens::TokenStream stream(file->view());
+    stream.storage = file;
+
+    const std::size_t size = file->size();
+    std::size_t from = 0;
+    std::size_t to = std::min(size, chunkSize);
+    while (true) {
+        bool final = to == size;
+        std::size_t resume = lexChunk(stream, from, to, final);
+        if (final) {
+            break;
+        }
+        if (resume == from) {
+            // A single token (usually a string or comment) is longer than the chunk, so widen the chunk.
+            to = std::min(size, to + chunkSize);
+            continue;
+        }
+        if (from == 0) {
+            // Size the token list from the density of the first chunk rather than over-reserving up front.
+            std::size_t expected = stream.tokens.size() * (size / resume + 1);
+            stream.tokens.reserve(expected + expected / 8);
+        }
+        // Tokens still point into the consumed range, but the pages are clean and fault back in if needed.
+        file->release(from, resume - from);
+        from = resume;
+        to = std::min(size, from + chunkSize);
+    }
+    return stream;
+}
+
+std::size_t Tokenizer::lexChunk(Tokens::TokenStream& stream, std::size_t from, std::size_t to, bool final) {
+    const char* begin = stream.source.data();
+    const char* end = begin + to;
+    const char* p = begin + from;
+
+    auto emit = [&](TokenKind kind, const char* start) -> Token& {
+        stream.tokens.emplace_back(kind, std::string_view(start, p - start), static_cast<uint32_t>(start - begin));
+        return stream.tokens.back();
+    };
+
+    while (true) {
+        // Whitespace, comment bodies, identifiers, digits and string bodies are scanned in bulk by the Scanner.
+        p = Scanner::skipWhitespace(p, end);
+        if (p >= end) {
+            break;
+        }
+        char c = *p;
+        const char* start = p;
+        // Every token kind may need one character of lookahead, so the last byte of a chunk always waits for the next one.
+        if (!final && p + 1 >= end) {
+            return start - begin;
+        }
+
+        // Comments
+        if (c == '/' && p + 1 < end) {
+            if (p[1] == '/') {
+                p = Scanner::findChar(p + 2, end, '\n');
+                if (!final && p >= end) {
+                    return start - begin;
+                }
+                continue;
+            }
+            if (p[1] == '*') {
+                p = Scanner::findCommentEnd(p + 2, end);
+                if (p >= end) {
+                    if (!final) {
+                        return start - begin;
+                    }
+                    throw std::runtime_error("Unterminated multiline comment.");
+                }
+                p += 2;
+                continue;
+            }
+        }
+
+        // Identifiers and keywords
+        if (isIdentifierStart(c)) {
+            p = Scanner::scanIdentifier(p + 1, end);
+            if (!final && p >= end) {
+                return start - begin;
+            }
+            std::string_view word(start, p - start);
+            TokenKind keyword = SymbolTable::lookup(word);
+            if (SymbolTable::isKeyword(keyword)) {
+                emit(keyword, start);
+            } else {
+                emit(TokenKind::Identifier, start).symbol = Symbols::intern(word);
+            }
+            continue;
+        }
+
+        // Numbers: digits with an optional fractional part
+        if (isDigit(c)) {
+            p = Scanner::scanDigits(p + 1, end);
+            if (!final && p + 1 >= end) { // Needs two characters to rule out a fraction
+                return start - begin;
+            }
+            if (p + 1 < end && *p == '.' && isDigit(p[1])) {
+                p = Scanner::scanDigits(p + 2, end);
+                if (!final && p >= end) {
+                    return start - begin;
+                }
+                Token& token = emit(TokenKind::Double, start);
+                std::from_chars(start, p, token.real);
+            } else {
+                Token& token = emit(TokenKind::Int, start);
+                std::from_chars(start, p, token.integer);
+            }
+            continue;
+        }
+
+        // String literals
+        if (c == '"') {
+            p = Scanner::findChar(p + 1, end, '"');
+            if (p >= end) {
+                if (!final) {
+                    return start - begin;
+                }
+                throw std::runtime_error("Unterminated string literal.");
+            }
+            p++; // Move past the closing quote
+            emit(TokenKind::String, start);
+            continue;
+        }
+
+        // Operators and punctuation
+        if (!final && p + maxSymbolLength > end) { // The whole longest symbol must be in the chunk
+            return start - begin;
+        }
+        TokenKind kind;
+        std::size_t length = matchSymbol(p, end, kind);
+        if (length == 0) {
+            kind = TokenKind::Unknown;
+            length = 1;
+        }
+        p += length;
+        emit(kind, start);
+    }
+    return to;
+}
+
+std::vector<std::size_t> Tokenizer::splitPoints(std::string_view input, std::size_t parts) {
+    std::vector<std::size_t> points = {0};
+    const char* begin = input.data();
+    const char* end = begin + input.size();
+    const char* p = begin;
+    // Walks the input with the same quote and comment rules as the lexer, only stopping at '"' and '/'.
+    // Between those stops the lexer is in its initial state, so any newline there is a safe split.
+    for (std::size_t part = 1; part < parts && p < end; part++) {
+        const char* target = begin + input.size() * part / parts;
+        if (target <= begin + points.back()) {
+            continue;
+        }
+        while (p < end) {
+            const char* special = Scanner::findEither(p, end, '"', '/');
+            if (special > target) {
+                const char* newline = Scanner::findChar(std::max(p, target), special, '\n');
+                if (newline < special) {
+                    p = newline + 1;
+                    points.push_back(p - begin);
+                    break;
+                }
+            }
+            if (special >= end) {
+                p = end;
+                break;
+            }
+            if (*special == '"') {
+                p = Scanner::findChar(special + 1, end, '"');
+                p = p < end ? p + 1 : end;
+            } else if (special + 1 < end && special[1] == '/') {
+                p = Scanner::findChar(special + 2, end, '\n'); // Stops on the newline, which can then be a split
+            } else if (special + 1 < end && special[1] == '*') {
+                p = Scanner::findCommentEnd(special + 2, end);
+                p = p < end ? p + 2 : end;
+            } else {
+                p = special + 1;
+            }
+        }
+    }
+    if (points.back() != input.size()) {
+        points.push_back(input.size());
+    }
+    return points;
+}
+
+Tokens::TokenStream Tokenizer::lexParallel(std::string_view input, unsigned threads, std::size_t minChunkSize) {
+    ThreadPool& pool = ThreadPool::shared();
+    if (threads == 0) {
+        threads = pool.size();
+    }
+    // A few parts per thread keeps the threads busy when some parts are denser than others.
+    std::size_t parts = std::min<std::size_t>(threads * 4, input.size() / std::max<std::size_t>(minChunkSize, 1));
+    if (threads < 2 || parts < 2) {
+        return lex(input);
+    }
+
+    std::vector<std::size_t> points = splitPoints(input, parts);
+    std::vector<Tokens::TokenStream> pieces(points.size() - 1, Tokens::TokenStream(input));
+    pool.parallelFor(pieces.size(), [&](std::size_t i) {
+        pieces[i].tokens.reserve((points[i + 1] - points[i]) / 4 + 16);
+        // Every part ends just after a newline outside any token, so each can be lexed as final.
+        lexChunk(pieces[i], points[i], points[i + 1], true);
+    }, threads);
+
+    // Concatenate in order. Each part is copied to its final position in parallel.
+    std::vector<std::size_t> starts(pieces.size() + 1, 0);
+    for (std::size_t i = 0; i < pieces.size(); i++) {
+        starts[i + 1] = starts[i] + pieces[i].size();
+    }
+    Tokens::TokenStream stream(input);
+    stream.tokens.resize(starts.back());
+    pool.parallelFor(pieces.size(), [&](std::size_t i) {
+        std::copy(pieces[i].tokens.begin(), pieces[i].tokens.end(), stream.tokens.begin() + starts[i]);
+        Tokens::TokenList().swap(pieces[i].tokens);
+    }, threads);
+    return stream;
+}
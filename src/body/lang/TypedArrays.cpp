@@ -0,0 +1,231 @@
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "../../head/lang/TypedArrays.h"
+
+using DataTypes::Data;
+using DataTypes::ElementKind;
+using DataTypes::TypedArrayObject;
+
+#if defined(__GNUC__)
+#define TYPED_ARRAY_VECTORS 1
+#else
+#define TYPED_ARRAY_VECTORS 0
+#endif
+// Vectors as wide as the target's registers: AVX when it is enabled, SSE2 or NEON otherwise.
+#if defined(__AVX__)
+#define TYPED_ARRAY_VECTOR_BYTES 32
+#else
+#define TYPED_ARRAY_VECTOR_BYTES 16
+#endif
+
+namespace TypedArrays {
+    namespace {
+        template<typename T>
+        constexpr ElementKind kindOf = std::is_same_v<T, int32_t> ? ElementKind::Int32
+            : std::is_same_v<T, int64_t> ? ElementKind::Int64
+            : std::is_same_v<T, float> ? ElementKind::Float32 : ElementKind::Float64;
+
+        // Arithmetic on ints runs on their unsigned type, so it wraps instead of overflowing. Comparisons use the
+        // element type itself.
+        template<typename T>
+        using Lane = typename std::conditional_t<std::is_integral_v<T>, std::make_unsigned<T>, std::common_type<T>>::type;
+        template<typename T>
+        Lane<T>* lanes(std::vector<T>& values) {
+            return reinterpret_cast<Lane<T>*>(values.data());
+        }
+        template<typename T>
+        const Lane<T>* lanes(const std::vector<T>& values) {
+            return reinterpret_cast<const Lane<T>*>(values.data());
+        }
+
+#if TYPED_ARRAY_VECTORS
+        template<typename L>
+        struct Pack {
+            typedef L Vector __attribute__((vector_size(TYPED_ARRAY_VECTOR_BYTES)));
+            static constexpr std::size_t width = TYPED_ARRAY_VECTOR_BYTES / sizeof(L);
+        };
+        template<typename V, typename L>
+        V load(const L* at) {
+            V vector;
+            std::memcpy(&vector, at, sizeof(vector));
+            return vector;
+        }
+        template<typename V, typename L>
+        void store(L* at, V vector) {
+            std::memcpy(at, &vector, sizeof(vector));
+        }
+#endif
+        // A scalar as a V: itself for scalars, in every lane for vectors.
+        template<typename V, typename T>
+        V splat(T value) {
+            if constexpr (std::is_arithmetic_v<V>) {
+                return value;
+            } else {
+                return V{} + value;
+            }
+        }
+        // Vectors pick their lanes with the compare mask, which has the width of the lanes.
+        template<typename V>
+        V select(V whenTrue, V whenFalse, bool condition) {
+            return condition ? whenTrue : whenFalse;
+        }
+        template<typename V, typename Mask>
+        V select(V whenTrue, V whenFalse, Mask mask) {
+            return (V)(((Mask)whenTrue & mask) | ((Mask)whenFalse & ~mask));
+        }
+        template<typename V>
+        V minimum(V a, V b) {
+            return select(b, a, b < a);
+        }
+        template<typename V>
+        V maximum(V a, V b) {
+            return select(b, a, a < b);
+        }
+
+        // target[i] = op(target[i], first[i], second[i])
+        template<typename L, typename Op>
+        void transform(L* target, const L* first, const L* second, std::size_t length, Op op) {
+            std::size_t i = 0;
+#if TYPED_ARRAY_VECTORS
+            using V = typename Pack<L>::Vector;
+            for (; i + Pack<L>::width <= length; i += Pack<L>::width) {
+                store(target + i, op(load<V>(target + i), load<V>(first + i), load<V>(second + i)));
+            }
+#endif
+            for (; i < length; i++) {
+                target[i] = op(target[i], first[i], second[i]);
+            }
+        }
+        // Folds accumulator = op(accumulator, first[i], second[i]) over the elements. Vectors fold into lanes,
+        // which are folded into the result with `combine` at the end.
+        template<typename L, typename Op, typename Combine>
+        L reduce(const L* first, const L* second, std::size_t length, L initial, Op op, Combine combine) {
+            L result = initial;
+            std::size_t i = 0;
+#if TYPED_ARRAY_VECTORS
+            using V = typename Pack<L>::Vector;
+            if (length >= Pack<L>::width) {
+                V accumulator = splat<V>(initial);
+                for (; i + Pack<L>::width <= length; i += Pack<L>::width) {
+                    accumulator = op(accumulator, load<V>(first + i), load<V>(second + i));
+                }
+                for (std::size_t lane = 0; lane < Pack<L>::width; lane++) {
+                    result = combine(result, accumulator[lane]);
+                }
+            }
+#endif
+            for (; i < length; i++) {
+                result = op(result, first[i], second[i]);
+            }
+            return result;
+        }
+
+        // The elements of `other` to combine with `values`. Throws if its kind or length differs.
+        template<typename T>
+        const std::vector<T>& operand(const std::vector<T>& values, const Data& other) {
+            const TypedArrayObject& array = other.asTypedArray();
+            const std::vector<T>* elements = std::get_if<std::vector<T>>(&array.elements);
+            if (elements == nullptr) {
+                throw std::runtime_error(std::string("Cannot combine a typed array of ") + DataTypes::elementKindName(kindOf<T>)
+                    + " with one of " + DataTypes::elementKindName(array.kind()) + ".");
+            }
+            if (elements->size() != values.size()) {
+                throw std::runtime_error("Cannot combine typed arrays of length " + std::to_string(values.size()) + " and "
+                    + std::to_string(elements->size()) + ".");
+            }
+            return *elements;
+        }
+        template<typename T>
+        using ElementOf = typename std::decay_t<T>::value_type;
+
+        template<typename F>
+        void update(Data& target, F f) {
+            std::visit(f, target.mutableTypedArray().elements);
+        }
+        template<typename F>
+        Data read(const Data& array, F f) {
+            return std::visit(f, array.asTypedArray().elements);
+        }
+        template<typename T, typename Op>
+        T extreme(const std::vector<T>& values, const char* name, Op op) {
+            if (values.empty()) {
+                throw std::runtime_error(std::string("Cannot take the ") + name + " of an empty typed array.");
+            }
+            return reduce(values.data(), values.data(), values.size(), values[0],
+                [op](auto accumulator, auto value, auto) { return op(accumulator, value); }, op);
+        }
+    }
+
+    void add(Data& target, const Data& other) {
+        update(target, [&](auto& values) {
+            auto& others = operand(values, other);
+            transform(lanes(values), lanes(others), lanes(others), values.size(), [](auto t, auto a, auto) { return t + a; });
+        });
+    }
+    void multiply(Data& target, const Data& other) {
+        update(target, [&](auto& values) {
+            auto& others = operand(values, other);
+            transform(lanes(values), lanes(others), lanes(others), values.size(), [](auto t, auto a, auto) { return t * a; });
+        });
+    }
+    void fma(Data& target, const Data& left, const Data& right) {
+        update(target, [&](auto& values) {
+            auto& lefts = operand(values, left);
+            auto& rights = operand(values, right);
+            transform(lanes(values), lanes(lefts), lanes(rights), values.size(), [](auto t, auto a, auto b) { return t + a * b; });
+        });
+    }
+    void scale(Data& target, const Data& factor) {
+        update(target, [&](auto& values) {
+            using T = ElementOf<decltype(values)>;
+            Lane<T> k = static_cast<Lane<T>>(DataTypes::toElement<T>(factor));
+            transform(lanes(values), lanes(values), lanes(values), values.size(), [k](auto t, auto, auto) { return t * k; });
+        });
+    }
+    void clamp(Data& target, const Data& low, const Data& high) {
+        update(target, [&](auto& values) {
+            using T = ElementOf<decltype(values)>;
+            T lowest = DataTypes::toElement<T>(low);
+            T highest = DataTypes::toElement<T>(high);
+            transform(values.data(), values.data(), values.data(), values.size(), [lowest, highest](auto t, auto, auto) {
+                using V = decltype(t);
+                return minimum(maximum(t, splat<V>(lowest)), splat<V>(highest));
+            });
+        });
+    }
+
+    Data sum(const Data& array) {
+        return read(array, [](const auto& values) {
+            using T = ElementOf<decltype(values)>;
+            using L = Lane<T>;
+            L total = reduce(lanes(values), lanes(values), values.size(), L(0),
+                [](auto accumulator, auto value, auto) { return accumulator + value; }, [](L a, L b) { return L(a + b); });
+            return DataTypes::elementValue(static_cast<T>(total));
+        });
+    }
+    Data min(const Data& array) {
+        return read(array, [](const auto& values) {
+            return DataTypes::elementValue(extreme(values, "min", [](auto a, auto b) { return minimum(a, b); }));
+        });
+    }
+    Data max(const Data& array) {
+        return read(array, [](const auto& values) {
+            return DataTypes::elementValue(extreme(values, "max", [](auto a, auto b) { return maximum(a, b); }));
+        });
+    }
+    Data dot(const Data& left, const Data& right) {
+        return read(left, [&](const auto& values) {
+            using T = ElementOf<decltype(values)>;
+            using L = Lane<T>;
+            auto& others = operand(values, right);
+            L total = reduce(lanes(values), lanes(others), values.size(), L(0),
+                [](auto accumulator, auto a, auto b) { return accumulator + a * b; }, [](L a, L b) { return L(a + b); });
+            return DataTypes::elementValue(static_cast<T>(total));
+        });
+    }
+}
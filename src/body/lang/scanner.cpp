@@ -0,0 +1,343 @@
+#include <atomic>
+#include <cstdint>
+#include "../../head/lang/scanner.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define HYPE_SCANNER_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define HYPE_TARGET_AVX2
+    #else
+        #define HYPE_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace Scanner {
+    namespace {
+        struct Kernels {
+            Level level;
+            const char* (*skipWhitespace)(const char*, const char*);
+            const char* (*scanIdentifier)(const char*, const char*);
+            const char* (*scanDigits)(const char*, const char*);
+            const char* (*findChar)(const char*, const char*, char);
+            const char* (*findEither)(const char*, const char*, char, char);
+            const char* (*findCommentEnd)(const char*, const char*);
+        };
+
+        // Scalar fallback. Also finishes the tail of every vector loop.
+        namespace Scalar {
+            bool isWhitespace(char c) {
+                return c == ' ' || (c >= '\t' && c <= '\r');
+            }
+            bool isIdentifierChar(char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            }
+            const char* skipWhitespace(const char* p, const char* end) {
+                while (p < end && isWhitespace(*p)) {
+                    p++;
+                }
+                return p;
+            }
+            const char* scanIdentifier(const char* p, const char* end) {
+                while (p < end && isIdentifierChar(*p)) {
+                    p++;
+                }
+                return p;
+            }
+            const char* scanDigits(const char* p, const char* end) {
+                while (p < end && *p >= '0' && *p <= '9') {
+                    p++;
+                }
+                return p;
+            }
+            const char* findChar(const char* p, const char* end, char c) {
+                while (p < end && *p != c) {
+                    p++;
+                }
+                return p;
+            }
+            const char* findEither(const char* p, const char* end, char a, char b) {
+                while (p < end && *p != a && *p != b) {
+                    p++;
+                }
+                return p;
+            }
+            const char* findCommentEnd(const char* p, const char* end) {
+                while (p + 1 < end && !(p[0] == '*' && p[1] == '/')) {
+                    p++;
+                }
+                return p + 1 < end ? p : end;
+            }
+        }
+
+#ifdef HYPE_SCANNER_X86
+        unsigned firstBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        // SSE2 is part of the x86-64 baseline, so these need no target attributes.
+        namespace SSE2 {
+            // Bytes in [lo, hi]. Signed compares are fine because everything we classify is ASCII.
+            __m128i inRange(__m128i v, char lo, char hi) {
+                return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+            }
+            __m128i whitespaceMask(__m128i v) {
+                return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange(v, '\t', '\r'));
+            }
+            __m128i identifierMask(__m128i v) {
+                __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20)); // Folds A-Z onto a-z
+                __m128i alpha = inRange(lower, 'a', 'z');
+                __m128i digit = inRange(v, '0', '9');
+                __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+                return _mm_or_si128(_mm_or_si128(alpha, digit), underscore);
+            }
+
+            const char* skipWhitespace(const char* p, const char* end) {
+                for (; end - p >= 16; p += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    uint32_t stop = ~_mm_movemask_epi8(whitespaceMask(v)) & 0xFFFF;
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return Scalar::skipWhitespace(p, end);
+            }
+            const char* scanIdentifier(const char* p, const char* end) {
+                for (; end - p >= 16; p += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    uint32_t stop = ~_mm_movemask_epi8(identifierMask(v)) & 0xFFFF;
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return Scalar::scanIdentifier(p, end);
+            }
+            const char* scanDigits(const char* p, const char* end) {
+                for (; end - p >= 16; p += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    uint32_t stop = ~_mm_movemask_epi8(inRange(v, '0', '9')) & 0xFFFF;
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return Scalar::scanDigits(p, end);
+            }
+            const char* findChar(const char* p, const char* end, char c) {
+                __m128i needle = _mm_set1_epi8(c);
+                for (; end - p >= 16; p += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    uint32_t found = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return Scalar::findChar(p, end, c);
+            }
+            const char* findEither(const char* p, const char* end, char a, char b) {
+                __m128i first = _mm_set1_epi8(a);
+                __m128i second = _mm_set1_epi8(b);
+                for (; end - p >= 16; p += 16) {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    uint32_t found = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, first), _mm_cmpeq_epi8(v, second)));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return Scalar::findEither(p, end, a, b);
+            }
+            const char* findCommentEnd(const char* p, const char* end) {
+                __m128i star = _mm_set1_epi8('*');
+                __m128i slash = _mm_set1_epi8('/');
+                // Compares each byte with '*' and its successor with '/', so the loop needs 17 readable bytes.
+                for (; end - p >= 17; p += 16) {
+                    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+                    uint32_t found = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash)));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return Scalar::findCommentEnd(p, end);
+            }
+        }
+
+        namespace AVX2 {
+            HYPE_TARGET_AVX2 __m256i inRange(__m256i v, char lo, char hi) {
+                return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+            }
+            HYPE_TARGET_AVX2 __m256i whitespaceMask(__m256i v) {
+                return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange(v, '\t', '\r'));
+            }
+            HYPE_TARGET_AVX2 __m256i identifierMask(__m256i v) {
+                __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+                __m256i alpha = inRange(lower, 'a', 'z');
+                __m256i digit = inRange(v, '0', '9');
+                __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+                return _mm256_or_si256(_mm256_or_si256(alpha, digit), underscore);
+            }
+
+            HYPE_TARGET_AVX2 const char* skipWhitespace(const char* p, const char* end) {
+                for (; end - p >= 32; p += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(whitespaceMask(v)));
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return SSE2::skipWhitespace(p, end);
+            }
+            HYPE_TARGET_AVX2 const char* scanIdentifier(const char* p, const char* end) {
+                for (; end - p >= 32; p += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(identifierMask(v)));
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return SSE2::scanIdentifier(p, end);
+            }
+            HYPE_TARGET_AVX2 const char* scanDigits(const char* p, const char* end) {
+                for (; end - p >= 32; p += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(inRange(v, '0', '9')));
+                    if (stop) {
+                        return p + firstBit(stop);
+                    }
+                }
+                return SSE2::scanDigits(p, end);
+            }
+            HYPE_TARGET_AVX2 const char* findChar(const char* p, const char* end, char c) {
+                __m256i needle = _mm256_set1_epi8(c);
+                for (; end - p >= 32; p += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    uint32_t found = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return SSE2::findChar(p, end, c);
+            }
+            HYPE_TARGET_AVX2 const char* findEither(const char* p, const char* end, char a, char b) {
+                __m256i first = _mm256_set1_epi8(a);
+                __m256i second = _mm256_set1_epi8(b);
+                for (; end - p >= 32; p += 32) {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    uint32_t found = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, first), _mm256_cmpeq_epi8(v, second))));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return SSE2::findEither(p, end, a, b);
+            }
+            HYPE_TARGET_AVX2 const char* findCommentEnd(const char* p, const char* end) {
+                __m256i star = _mm256_set1_epi8('*');
+                __m256i slash = _mm256_set1_epi8('/');
+                for (; end - p >= 33; p += 32) {
+                    __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+                    uint32_t found = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, star), _mm256_cmpeq_epi8(second, slash))));
+                    if (found) {
+                        return p + firstBit(found);
+                    }
+                }
+                return SSE2::findCommentEnd(p, end);
+            }
+        }
+
+        bool cpuHasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuidex(info, 0, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuidex(info, 1, 0);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) { // The OS must save the YMM registers
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif // HYPE_SCANNER_X86
+
+        const Kernels scalarKernels = {Level::Scalar, Scalar::skipWhitespace, Scalar::scanIdentifier, Scalar::scanDigits, Scalar::findChar, Scalar::findEither, Scalar::findCommentEnd};
+#ifdef HYPE_SCANNER_X86
+        const Kernels sse2Kernels = {Level::SSE2, SSE2::skipWhitespace, SSE2::scanIdentifier, SSE2::scanDigits, SSE2::findChar, SSE2::findEither, SSE2::findCommentEnd};
+        const Kernels avx2Kernels = {Level::AVX2, AVX2::skipWhitespace, AVX2::scanIdentifier, AVX2::scanDigits, AVX2::findChar, AVX2::findEither, AVX2::findCommentEnd};
+#endif
+
+        const Kernels* kernelsFor(Level level) {
+#ifdef HYPE_SCANNER_X86
+            if (level == Level::AVX2) {
+                return &avx2Kernels;
+            }
+            if (level == Level::SSE2) {
+                return &sse2Kernels;
+            }
+#endif
+            return &scalarKernels;
+        }
+
+        std::atomic<const Kernels*>& active() {
+            static std::atomic<const Kernels*> kernels(kernelsFor(detectedLevel()));
+            return kernels;
+        }
+    }
+
+    const char* skipWhitespace(const char* p, const char* end) {
+        return active().load(std::memory_order_relaxed)->skipWhitespace(p, end);
+    }
+    const char* scanIdentifier(const char* p, const char* end) {
+        return active().load(std::memory_order_relaxed)->scanIdentifier(p, end);
+    }
+    const char* scanDigits(const char* p, const char* end) {
+        return active().load(std::memory_order_relaxed)->scanDigits(p, end);
+    }
+    const char* findChar(const char* p, const char* end, char c) {
+        return active().load(std::memory_order_relaxed)->findChar(p, end, c);
+    }
+    const char* findEither(const char* p, const char* end, char a, char b) {
+        return active().load(std::memory_order_relaxed)->findEither(p, end, a, b);
+    }
+    const char* findCommentEnd(const char* p, const char* end) {
+        return active().load(std::memory_order_relaxed)->findCommentEnd(p, end);
+    }
+
+    Level detectedLevel() {
+#ifdef HYPE_SCANNER_X86
+        static const Level level = cpuHasAVX2() ? Level::AVX2 : Level::SSE2;
+        return level;
+#else
+        return Level::Scalar;
+#endif
+    }
+    Level activeLevel() {
+        return active().load()->level;
+    }
+    void setLevel(Level level) {
+        if (static_cast<int>(level) > static_cast<int>(detectedLevel())) {
+            level = detectedLevel();
+        }
+        active().store(kernelsFor(level));
+    }
+    const char* levelName(Level level) {
+        switch (level) {
+            case Level::Scalar: return "scalar";
+            case Level::SSE2: return "SSE2";
+            case Level::AVX2: return "AVX2";
+        }
+        return "unknown";
+    }
+}
@@ -81,24 +81,6 @@ std::string toStr(const std::any& obj) {
         }
         return vecToStr(vec);
     }
-    else if (obj.type() == typeid(DataTypes::ArrayList))
-    {
-        std::vector<std::string> vec;
-        for (const auto& item : std::any_cast<DataTypes::ArrayList>(obj)) {
-            vec.push_back(toStr(item.data.toJSON()));
-        }
-        return vecToStr(vec);
-
-    }
-    else if (obj.type() == typeid(DataTypes::Dictionary)) 
-    {
-        AnyDictionary map;
-        for (const auto& pair : std::any_cast<DataTypes::Dictionary>(obj)) {
-            map[pair.first.value] = pair.second.data.value;
-        }
-        return mapToStr(map);
-
-    }
     else if (obj.type() == typeid(DataTypes::Data)) {
         return toStr(std::any_cast<DataTypes::Data>(obj).toJSON());
     }
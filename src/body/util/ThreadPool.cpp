@@ -0,0 +1,94 @@
+#include <atomic>
+#include <exception>
+#include "../../head/util/ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    available.notify_one();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return; // Stopping and nothing left to do
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& job, unsigned parallelism) {
+    if (count == 0) {
+        return;
+    }
+    unsigned runners = (parallelism == 0 || parallelism > size()) ? size() : parallelism;
+    if (runners > count) {
+        runners = static_cast<unsigned>(count);
+    }
+
+    // Each runner claims indices from a shared counter, so uneven jobs still balance across the pool.
+    std::atomic<std::size_t> next(0);
+    std::mutex doneMutex;
+    std::condition_variable doneSignal;
+    unsigned remaining = runners;
+    std::exception_ptr failure;
+
+    for (unsigned r = 0; r < runners; r++) {
+        submit([&] {
+            for (std::size_t i = next++; i < count; i = next++) {
+                try {
+                    job(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(doneMutex);
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--remaining == 0) {
+                doneSignal.notify_all();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneSignal.wait(lock, [&] { return remaining == 0; });
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
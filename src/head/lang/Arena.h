@@ -0,0 +1,91 @@
+#ifndef ARENA_DEF
+#define ARENA_DEF
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Nodes {
+    // Bump allocator that owns every node of a parsed program.
+    // Nodes are carved out of large blocks and linked with plain pointers. Nothing is freed one node at a time:
+    // reset() (or the destructor) runs the destructors that are needed and releases all blocks at once.
+    class Arena {
+        public:
+            explicit Arena(std::size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+            ~Arena() {
+                reset();
+            }
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            template<typename T, typename... Args>
+            T* make(Args&&... args) {
+                if constexpr (!std::is_trivially_destructible_v<T>) {
+                    // Only types that need it get a cleanup record, and the record lives in the arena too. It is
+                    // allocated first, so once the object is made nothing can fail before it is registered.
+                    void* record = allocate(sizeof(Cleanup), alignof(Cleanup));
+                    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+                    cleanups = new (record) Cleanup{&destroy<T>, object, cleanups};
+                    objects++;
+                    return object;
+                } else {
+                    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+                    objects++;
+                    return object;
+                }
+            }
+
+            void* allocate(std::size_t size, std::size_t alignment) {
+                uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+                if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+                    return allocateSlow(size, alignment);
+                }
+                cursor = reinterpret_cast<char*>(aligned + size);
+                return reinterpret_cast<void*>(aligned);
+            }
+
+            // Destroys every object and frees every block. Pointers into the arena are invalid afterwards.
+            void reset();
+
+            // Bytes handed out so far, including alignment padding and cleanup records.
+            std::size_t bytesUsed() const {
+                return used + (cursor ? static_cast<std::size_t>(cursor - currentStart) : 0);
+            }
+            // Bytes reserved from the system.
+            std::size_t bytesReserved() const {
+                return reserved;
+            }
+            std::size_t objectCount() const {
+                return objects;
+            }
+
+        private:
+            struct Block {
+                Block* next;
+            };
+            struct Cleanup {
+                void (*run)(void*);
+                void* object;
+                Cleanup* next;
+            };
+            template<typename T>
+            static void destroy(void* object) {
+                static_cast<T*>(object)->~T();
+            }
+
+            std::size_t blockSize;
+            Block* blocks = nullptr;
+            char* currentStart = nullptr;
+            char* cursor = nullptr;
+            char* limit = nullptr;
+            Cleanup* cleanups = nullptr;
+            std::size_t used = 0;
+            std::size_t reserved = 0;
+            std::size_t objects = 0;
+
+            void* allocateSlow(std::size_t size, std::size_t alignment);
+    };
+}
+
+#endif // ARENA_DEF
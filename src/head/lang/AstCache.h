@@ -0,0 +1,163 @@
+#ifndef AST_CACHE_DEF
+#define AST_CACHE_DEF
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "Symbols.h"
+#include "Token.h"
+
+namespace Nodes {
+    class Program;
+}
+
+// Precompiled programs (.hypec files).
+// A parsed program is written next to its source as a flat binary image: a fixed header, a pool of
+// identifier names, a pool of string constants and the nodes in preorder. Loading maps the file and
+// rebuilds the tree straight into the program's arena, so nothing is lexed or parsed again.
+// The header records the format and grammar versions and a hash of the source; any of them changing makes
+// the cache stale and it is rebuilt on the next run. Values are stored in native byte order, the cache is not portable.
+namespace AstCache {
+    // Bump whenever the node layout or the meaning of a tag changes.
+    inline constexpr uint32_t formatVersion = 1;
+    // Bump whenever the parser builds a different tree from the same tokens.
+    inline constexpr uint32_t grammarRevision = 1;
+    // Operators are stored as raw TokenKind values, so caches written by a build with other token kinds are
+    // rejected too.
+    inline constexpr uint32_t grammarVersion = grammarRevision << 16 | static_cast<uint32_t>(Tokens::tokenKindCount);
+
+    // Node tags, one byte in front of every statement and expression. Blocks and conditions are written
+    // untagged by the statement that owns them.
+    enum class NodeTag : uint8_t {
+        IfStatement,
+        ExpressionStatement,
+        BinaryExpression,
+        UnaryExpression,
+        AssignmentExpression,
+        Value,
+        ArrayList,
+        MapDictionary,
+        VariableAccessor,
+        VariableProperty,
+    };
+    // Constant tags, in front of the payload of every Value node.
+    enum class ConstantTag : uint8_t {
+        Null,
+        Bool,
+        Int,
+        Double,
+        String,
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t symbolCount;
+        uint32_t stringCount;
+        uint32_t nodeBytes;
+        uint32_t grammar; // grammarVersion of the build that wrote the cache
+    };
+
+    // Appends nodes to an in-memory image. Identifiers and strings go to pools and are written once.
+    class Writer {
+        public:
+            void tag(NodeTag t) {
+                u8(static_cast<uint8_t>(t));
+            }
+            void u8(uint8_t value) {
+                nodes.push_back(static_cast<char>(value));
+            }
+            void u32(uint32_t value) {
+                raw(&value, sizeof(value));
+            }
+            void i64(int64_t value) {
+                raw(&value, sizeof(value));
+            }
+            void f64(double value) {
+                raw(&value, sizeof(value));
+            }
+            void symbol(Symbols::SymbolId id);
+            void string(std::string_view text);
+
+            // The complete file contents for a source with the given hash and size.
+            std::string image(uint64_t sourceHash, uint64_t sourceSize) const;
+
+        private:
+            std::string nodes;
+            std::vector<Symbols::SymbolId> symbols;
+            std::unordered_map<Symbols::SymbolId, uint32_t> symbolIndex;
+            std::vector<std::string> strings;
+            std::unordered_map<std::string, uint32_t> stringIndex;
+
+            void raw(const void* data, std::size_t size) {
+                nodes.append(static_cast<const char*>(data), size);
+            }
+    };
+
+    // Reads nodes back out of a mapped image. Every read is bounds checked and throws std::runtime_error
+    // on a truncated or corrupt file.
+    class Reader {
+        public:
+            Reader(const char* begin, const char* end) : cursor(begin), end(end) {}
+
+            NodeTag tag() {
+                return static_cast<NodeTag>(u8());
+            }
+            uint8_t u8() {
+                uint8_t value;
+                raw(&value, sizeof(value));
+                return value;
+            }
+            uint32_t u32() {
+                uint32_t value;
+                raw(&value, sizeof(value));
+                return value;
+            }
+            int64_t i64() {
+                int64_t value;
+                raw(&value, sizeof(value));
+                return value;
+            }
+            double f64() {
+                double value;
+                raw(&value, sizeof(value));
+                return value;
+            }
+            // Symbols are re-interned on load, ids are only stable within one process.
+            Symbols::SymbolId symbol();
+            // Views into the mapping, valid while the cache file is mapped.
+            std::string_view string();
+
+            // Reads the pools that precede the nodes.
+            void readPools(uint32_t symbolCount, uint32_t stringCount);
+            bool atEnd() const {
+                return cursor == end;
+            }
+
+        private:
+            const char* cursor;
+            const char* end;
+            std::vector<Symbols::SymbolId> symbols;
+            std::vector<std::string_view> strings;
+
+            void raw(void* out, std::size_t size);
+            std::string_view text();
+    };
+
+    // 64-bit hash of the source text that keys the cache.
+    uint64_t hashSource(std::string_view source);
+    // The cache file that belongs to a source file: "script.hype" -> "script.hypec".
+    std::string cachePath(const std::string& sourcePath);
+
+    // Writes `program`, parsed from `source`, to `path`. The file is replaced atomically.
+    void save(const Nodes::Program& program, std::string_view source, const std::string& path);
+    // Loads the cache at `path` into an empty `program`. Returns false if the file is missing, stale or
+    // corrupt, in which case the program is left empty and the source has to be parsed.
+    bool load(Nodes::Program& program, std::string_view source, const std::string& path);
+}
+
+#endif // AST_CACHE_DEF
@@ -0,0 +1,44 @@
+#ifndef BENCHMARKS_DEF
+#define BENCHMARKS_DEF
+#include <string>
+#include <cstddef>
+#include <chrono>
+
+namespace ProcessorBenchmarks {
+    // Generates a syntactically plausible .hype script of roughly `bytes` bytes,
+    // mixing statements, literals, strings, line comments and multiline comments.
+    std::string generateScript(std::size_t bytes);
+    // Generates `depth` if statements nested inside each other, each with a statement before the inner block.
+    std::string generateNestedScript(std::size_t depth);
+
+    // Runs `work` `runs` times and returns the fastest run in milliseconds.
+    template<typename F>
+    double bestOf(int runs, F work) {
+        double best = 1e300;
+        for (int i = 0; i < runs; i++) {
+            auto start = std::chrono::steady_clock::now();
+            work();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = elapsed.count() < best ? elapsed.count() : best;
+        }
+        return best;
+    }
+    void report(const std::string& label, double ms, std::size_t bytes);
+
+    void benchTokenizer();
+    void benchParallelTokenizer();
+    void benchNestedParser();
+    void benchAstCache();
+    void benchOperators();
+    void benchExecutionModes();
+    void benchContainers();
+    void benchTypedArrays();
+    void benchPropertyAccess();
+    void benchMethodLookup();
+    void benchGarbageCollector();
+    void benchObjectPools();
+
+    void runBenchmarks();
+}
+
+#endif // BENCHMARKS_DEF
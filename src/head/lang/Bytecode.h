@@ -0,0 +1,184 @@
+#ifndef BYTECODE_DEF
+#define BYTECODE_DEF
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "Processor.h"
+#include "Operators.h"
+
+// The Executor.
+// Programs compile to a register-based bytecode: every instruction names the registers it reads and writes, so
+// an expression like a + b * c is three instructions with no stack traffic. Instructions are 32 bits, an 8-bit
+// opcode followed by three 8-bit operands A, B and C, or by A and one 16-bit operand Bx (sBx when signed, for
+// jumps). Constants and variable slots live in per-chunk pools indexed by Bx.
+// The nodes emit their own code, see Expression::emit, the same way they write themselves to the AST cache.
+namespace Jit {
+    struct Code;
+}
+namespace Bytecode {
+    // Every opcode, with its operands. R[x] is a register, K[x] a constant, S[x] a variable slot.
+    #define BYTECODE_OPS(X) \
+        X(LoadConst)    /* R[A] = K[Bx] */ \
+        X(Move)         /* R[A] = R[B] */ \
+        X(GetVar)       /* R[A] = S[Bx] */ \
+        X(SetVar)       /* S[Bx] = R[A] */ \
+        X(Add)          /* R[A] = R[B] + R[C], and so on for every binary operator */ \
+        X(Subtract) \
+        X(Multiply) \
+        X(Divide) \
+        X(Modulo) \
+        X(BitAnd) \
+        X(BitOr) \
+        X(BitXor) \
+        X(ShiftLeft) \
+        X(ShiftRight) \
+        X(Equal) \
+        X(NotEqual) \
+        X(Less) \
+        X(Greater) \
+        X(LessEqual) \
+        X(GreaterEqual) \
+        X(And) \
+        X(Or) \
+        X(Negate)       /* R[A] = -R[B], and so on for every unary operator */ \
+        X(Not) \
+        X(BitNot) \
+        X(NewArray)     /* R[A] = [R[B], ..., R[B+C-1]] */ \
+        X(NewDict)      /* R[A] = {R[B]: R[B+1], ...} with C pairs */ \
+        X(Jump)         /* pc += sBx */ \
+        X(JumpIfFalse)  /* if (!R[A]) pc += sBx */ \
+        X(Evaluate)     /* R[A] = N[Bx]->evaluate(), for nodes that have no bytecode of their own */ \
+        X(Return)       /* Leaves the current frame */
+
+    enum class Op : uint8_t {
+        #define BYTECODE_ENUM(name) name,
+        BYTECODE_OPS(BYTECODE_ENUM)
+        #undef BYTECODE_ENUM
+    };
+    const char* opName(Op op);
+
+    // The binary operators come in Operators::Opcode order, so the two convert by offset.
+    constexpr Op binaryOp(Operators::Opcode code) {
+        return static_cast<Op>(static_cast<uint8_t>(Op::Add) + static_cast<uint8_t>(code));
+    }
+    constexpr Op unaryOp(Operators::UnaryOpcode code) {
+        return static_cast<Op>(static_cast<uint8_t>(Op::Negate) + static_cast<uint8_t>(code));
+    }
+
+    using Instruction = uint32_t;
+    using Register = uint8_t;
+    inline constexpr std::size_t maxRegisters = 256;
+
+    constexpr Instruction encode(Op op, uint8_t a, uint8_t b = 0, uint8_t c = 0) {
+        return static_cast<Instruction>(op) | (Instruction(a) << 8) | (Instruction(b) << 16) | (Instruction(c) << 24);
+    }
+    constexpr Instruction encodeBx(Op op, uint8_t a, uint16_t bx) {
+        return static_cast<Instruction>(op) | (Instruction(a) << 8) | (Instruction(bx) << 16);
+    }
+    constexpr Op opOf(Instruction i) {
+        return static_cast<Op>(i & 0xFF);
+    }
+    constexpr uint8_t argA(Instruction i) {
+        return static_cast<uint8_t>(i >> 8);
+    }
+    constexpr uint8_t argB(Instruction i) {
+        return static_cast<uint8_t>(i >> 16);
+    }
+    constexpr uint8_t argC(Instruction i) {
+        return static_cast<uint8_t>(i >> 24);
+    }
+    constexpr uint16_t argBx(Instruction i) {
+        return static_cast<uint16_t>(i >> 16);
+    }
+    constexpr int16_t argSBx(Instruction i) {
+        return static_cast<int16_t>(static_cast<uint16_t>(i >> 16));
+    }
+
+    // The compiled code of one program.
+    struct Chunk {
+        std::vector<Instruction> code;
+        std::vector<DataTypes::Data> constants;
+        std::vector<Nodes::VariableSlot> slots;
+        std::vector<Nodes::Expression*> nodes; // Evaluate fallbacks, owned by the program's arena
+        std::size_t registerCount = 0; // Frame size
+
+        // Tiering state, see Jit::run
+        uint32_t runs = 0; // Runs since the chunk was built or its native code was dropped
+        uint8_t recompiles = 0;
+        bool interpretOnly = false; // Set when the JIT cannot compile the chunk
+        std::shared_ptr<Jit::Code> native;
+    };
+
+    // Builds a chunk. Registers are allocated like a stack: an expression leaves its result in a fresh register
+    // on top, and a statement releases everything it allocated when it ends.
+    class Compiler {
+        public:
+            Chunk chunk;
+
+            Register allocate();
+            Register top() const {
+                return static_cast<Register>(next);
+            }
+            // Frees every register from `from` up.
+            void release(Register from) {
+                next = from;
+            }
+            std::size_t emit(Instruction instruction) {
+                chunk.code.push_back(instruction);
+                return chunk.code.size() - 1;
+            }
+            // Pool indices. Scalars and strings are pooled once per chunk.
+            uint16_t constant(const DataTypes::Data& value);
+            // Sites in the same block share the slot of a name, since they always resolve to the same variable.
+            uint16_t slot(Nodes::Base* site, Symbols::SymbolId symbol, const Nodes::Address& address);
+            uint16_t node(Nodes::Expression* expression);
+            // Emits a forward jump to be patched once the target is known. Returns its index.
+            std::size_t jump(Op op, Register condition = 0) {
+                return emit(encodeBx(op, condition, 0));
+            }
+            // Points the jump at `index` to the next instruction.
+            void patch(std::size_t index);
+
+        private:
+            std::size_t next = 0;
+            std::unordered_map<std::string, uint16_t> constantIndex;
+            std::unordered_map<Nodes::Base*, std::unordered_map<Symbols::SymbolId, uint16_t>> slotIndex;
+    };
+
+    // Compiles a program body. Throws std::runtime_error if an expression needs more than 256 registers or a
+    // jump spans more than 32767 instructions.
+    Chunk compile(Nodes::Block& body);
+
+    // A chunk being run: its code, where it is, and its window of registers on the VM's register stack.
+    struct Frame {
+        Chunk* chunk;
+        const Instruction* pc;
+        std::size_t base;
+    };
+
+    // The interpreter loop. Dispatches with computed goto where the compiler supports it (GCC and Clang),
+    // with a switch otherwise.
+    class VM {
+        public:
+            // Runs the chunk in a new frame on top of the current ones. Slots bind to their variables as it runs.
+            void run(Chunk& chunk);
+            // Continues a run from the instruction at `pc`, with the frame's first registers set to `live`.
+            // Used by the JIT to hand a run back to the interpreter.
+            void resume(Chunk& chunk, std::size_t pc, const std::vector<DataTypes::Data>& live);
+
+        private:
+            std::vector<DataTypes::Data> registers;
+            std::vector<Frame> frames;
+
+            void execute();
+    };
+
+    // One instruction per line, with constants and variable names resolved:
+    //   0003  Add           r0, r0, r1
+    std::string disassemble(const Chunk& chunk);
+}
+
+#endif // BYTECODE_DEF
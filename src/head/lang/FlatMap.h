@@ -0,0 +1,236 @@
+#ifndef FLAT_MAP_DEF
+#define FLAT_MAP_DEF
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLAT_MAP_SSE2 1
+#else
+#define FLAT_MAP_SSE2 0
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace DataTypes {
+    // Open addressing hash map in the style of SwissTable, used for script dictionaries.
+    // Entries are stored densely in insertion order, so iterating a map always gives the same order, together
+    // with their full hashes. The table itself only holds a control byte and an entry index per slot: the control
+    // byte is empty or the low 7 bits of the hash, and lookups compare 16 control bytes at once (with SSE2 where
+    // it is available) before they look at a key. Growing reuses the cached hashes and never hashes a key again.
+    //
+    // Unlike std::unordered_map, inserting can move entries, so references and iterators into the map are only
+    // valid until the next insert. Erasing keeps the order and is linear in the size of the map.
+    template<typename K, typename V, typename Hash, typename Equal>
+    class FlatMap {
+        public:
+            using key_type = K;
+            using mapped_type = V;
+            using value_type = std::pair<K, V>;
+            using iterator = typename std::vector<value_type>::iterator;
+            using const_iterator = typename std::vector<value_type>::const_iterator;
+
+            FlatMap() {}
+            FlatMap(std::initializer_list<value_type> values) {
+                reserve(values.size());
+                for (const value_type& value : values) {
+                    insert(value);
+                }
+            }
+
+            iterator begin() {
+                return entries.begin();
+            }
+            iterator end() {
+                return entries.end();
+            }
+            const_iterator begin() const {
+                return entries.begin();
+            }
+            const_iterator end() const {
+                return entries.end();
+            }
+            std::size_t size() const {
+                return entries.size();
+            }
+            bool empty() const {
+                return entries.empty();
+            }
+            // Slots in the table, a power of two (0 before the first insert).
+            std::size_t capacity() const {
+                return slots.size();
+            }
+
+            iterator find(const K& key) {
+                std::size_t index = lookup(key, hashOf(key));
+                return index == npos ? entries.end() : entries.begin() + index;
+            }
+            const_iterator find(const K& key) const {
+                std::size_t index = lookup(key, hashOf(key));
+                return index == npos ? entries.end() : entries.begin() + index;
+            }
+            std::size_t count(const K& key) const {
+                return lookup(key, hashOf(key)) == npos ? 0 : 1;
+            }
+            V& operator[](const K& key) {
+                std::size_t hash = hashOf(key);
+                std::size_t index = lookup(key, hash);
+                if (index == npos) {
+                    index = append(key, V(), hash);
+                }
+                return entries[index].second;
+            }
+            // Adds the entry if the key is not in the map yet. Returns the entry for the key and whether it was added.
+            std::pair<iterator, bool> insert(const value_type& value) {
+                std::size_t hash = hashOf(value.first);
+                std::size_t index = lookup(value.first, hash);
+                if (index != npos) {
+                    return {entries.begin() + index, false};
+                }
+                return {entries.begin() + append(value.first, value.second, hash), true};
+            }
+            std::size_t erase(const K& key) {
+                std::size_t index = lookup(key, hashOf(key));
+                if (index == npos) {
+                    return 0;
+                }
+                entries.erase(entries.begin() + index);
+                hashes.erase(hashes.begin() + index);
+                rebuild(slots.size());
+                return 1;
+            }
+            void clear() {
+                entries.clear();
+                hashes.clear();
+                control.clear();
+                slots.clear();
+            }
+            // Makes room for `count` entries without growing the table again.
+            void reserve(std::size_t count) {
+                std::size_t wanted = minimumCapacity;
+                while (wanted - wanted / 8 < count) {
+                    wanted *= 2;
+                }
+                if (wanted > slots.size()) {
+                    entries.reserve(count);
+                    hashes.reserve(count);
+                    rebuild(wanted);
+                }
+            }
+
+        private:
+            static constexpr std::size_t groupWidth = 16;
+            static constexpr std::size_t minimumCapacity = groupWidth;
+            static constexpr std::size_t npos = ~std::size_t(0);
+            static constexpr int8_t emptySlot = -128; // Full slots hold 0..127, the low bits of their hash
+
+            std::vector<value_type> entries;
+            std::vector<std::size_t> hashes; // hashes[i] belongs to entries[i]
+            std::vector<int8_t> control; // One byte per slot, then a copy of the first group so loads never wrap
+            std::vector<uint32_t> slots; // The entry index of every full slot
+
+            // Masks of the slots in the group starting at `at` whose control byte is `byte`. Bit i is slot at + i.
+            static uint32_t match(const int8_t* at, int8_t byte) {
+#if FLAT_MAP_SSE2
+                __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte))));
+#else
+                uint32_t bits = 0;
+                for (std::size_t i = 0; i < groupWidth; i++) {
+                    bits |= static_cast<uint32_t>(at[i] == byte) << i;
+                }
+                return bits;
+#endif
+            }
+            static unsigned lowestBit(uint32_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+                unsigned long index;
+                _BitScanForward(&index, bits);
+                return static_cast<unsigned>(index);
+#else
+                return static_cast<unsigned>(__builtin_ctz(bits));
+#endif
+            }
+            static std::size_t hashOf(const K& key) {
+                return Hash()(key);
+            }
+            // Where a key's probe sequence starts. The low 4 bits of the hash pick the slot within a group and the
+            // rest, scrambled, pick the group: keys whose hashes only differ in the low bits, like runs of ints,
+            // share a group and sit next to each other, while everything else is spread over the table.
+            static std::size_t start(std::size_t hash, std::size_t mask) {
+                uint64_t group = static_cast<uint64_t>(hash >> 4) * 0x9E3779B97F4A7C15ull;
+                group ^= group >> 29;
+                return (static_cast<std::size_t>(group << 4) | (hash & (groupWidth - 1))) & mask;
+            }
+            // The control byte of a full slot: the low 7 bits of the hash, so keys in the same group differ.
+            static int8_t tag(std::size_t hash) {
+                return static_cast<int8_t>(hash & 0x7F);
+            }
+
+            std::size_t lookup(const K& key, std::size_t hash) const {
+                if (slots.empty()) {
+                    return npos;
+                }
+                std::size_t mask = slots.size() - 1;
+                std::size_t position = start(hash, mask);
+                for (std::size_t step = groupWidth;; step += groupWidth) {
+                    for (uint32_t bits = match(&control[position], tag(hash)); bits != 0; bits &= bits - 1) {
+                        uint32_t index = slots[(position + lowestBit(bits)) & mask];
+                        if (Equal()(entries[index].first, key)) {
+                            return index;
+                        }
+                    }
+                    if (match(&control[position], emptySlot) != 0) {
+                        return npos;
+                    }
+                    position = (position + step) & mask;
+                }
+            }
+            // Claims the first empty slot on the key's probe sequence for entry `index`.
+            void place(std::size_t hash, uint32_t index) {
+                std::size_t capacity = slots.size();
+                std::size_t mask = capacity - 1;
+                std::size_t position = start(hash, mask);
+                for (std::size_t step = groupWidth;; step += groupWidth) {
+                    uint32_t empty = match(&control[position], emptySlot);
+                    if (empty != 0) {
+                        std::size_t slot = (position + lowestBit(empty)) & mask;
+                        control[slot] = tag(hash);
+                        if (slot < groupWidth) {
+                            control[capacity + slot] = tag(hash);
+                        }
+                        slots[slot] = index;
+                        return;
+                    }
+                    position = (position + step) & mask;
+                }
+            }
+            std::size_t append(const K& key, const V& value, std::size_t hash) {
+                std::size_t capacity = slots.size();
+                if (entries.size() + 1 > capacity - capacity / 8) {
+                    rebuild(capacity == 0 ? minimumCapacity : capacity * 2);
+                }
+                std::size_t index = entries.size();
+                entries.emplace_back(key, value);
+                hashes.push_back(hash);
+                place(hash, static_cast<uint32_t>(index));
+                return index;
+            }
+            // Makes a table of `capacity` slots for the current entries, from their cached hashes.
+            void rebuild(std::size_t capacity) {
+                if (capacity == 0) {
+                    return;
+                }
+                control.assign(capacity + groupWidth, emptySlot);
+                slots.assign(capacity, 0);
+                for (std::size_t i = 0; i < entries.size(); i++) {
+                    place(hashes[i], static_cast<uint32_t>(i));
+                }
+            }
+    };
+}
+
+#endif // FLAT_MAP_DEF
@@ -0,0 +1,38 @@
+#ifndef GARBAGE_COLLECTOR_DEF
+#define GARBAGE_COLLECTOR_DEF
+#include <cstddef>
+#include "Processor.h"
+
+// Generational cycle collector for the script heap.
+// Values count their references, which frees almost every object the moment it is dropped; what counting cannot
+// free are cycles, like an instance whose property holds an array that holds the instance. The collector tracks
+// the objects that can be part of one (DataTypes::TracedObject) in two generations. Objects start young, and the
+// young generation is collected when it reaches its limit; survivors move to the old generation, which is only
+// collected once it has grown by a quarter since it was last collected, so pauses stay short in loops that keep
+// many objects alive.
+//
+// Collection is precise and needs no root scan: an object is live if more references point to it than come from
+// the other collected objects, which covers scope slots, the evaluator's temporaries and values held by the host
+// alike, or if it is reachable from such an object. Script execution is not thread safe, and neither is
+// collecting while another thread runs a script.
+namespace GarbageCollector {
+    struct Stats {
+        std::size_t youngObjects; // Live traced objects, by generation
+        std::size_t oldObjects;
+        std::size_t youngCollections;
+        std::size_t fullCollections;
+        std::size_t freed; // Objects freed by collections
+        double lastPauseMs;
+        double longestPauseMs;
+        double totalPauseMs;
+    };
+
+    // Frees the unreachable cycles among the young objects, or among all of them with `full`. Returns the number
+    // of objects freed.
+    std::size_t collect(bool full = true);
+    Stats stats();
+    // Collect when this many young objects are live, 4096 by default. 0 turns automatic collection off.
+    void setYoungLimit(std::size_t objects);
+}
+
+#endif // GARBAGE_COLLECTOR_DEF
@@ -0,0 +1,72 @@
+#ifndef JIT_DEF
+#define JIT_DEF
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include "Bytecode.h"
+
+// The baseline JIT.
+// Chunks that keep running are compiled to x86-64 machine code, written straight into executable memory. The
+// compiler specializes on the variable types it sees when the chunk gets hot: ints, bools and doubles, with the
+// same promotion and wrapping rules as the operator engine. Chunks that use anything else (strings, containers,
+// Evaluate fallbacks) stay on the interpreter.
+//
+// The code checks its speculation once on entry, since nothing but the chunk itself can change its variables
+// while it runs. When a variable has another type the run goes to the interpreter instead and the code is
+// dropped, to be compiled again for the new types. Integer divisions by 0 or -1 also leave the native code, in
+// the middle of a run: the registers are rebuilt as values and the interpreter continues from that instruction.
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64 1
+#else
+#define JIT_X86_64 0
+#endif
+
+namespace Jit {
+    inline constexpr bool supported = JIT_X86_64;
+    inline constexpr uint32_t hotThreshold = 64; // Interpreted runs before a chunk is compiled
+    inline constexpr uint8_t recompileLimit = 3; // Type changes a chunk survives before it stays interpreted
+
+    struct JitStats {
+        std::size_t compiled = 0; // Chunks compiled to native code
+        std::size_t rejected = 0; // Chunks that use something the JIT does not compile
+        std::size_t guardFailures = 0; // Entries whose variables had other types, each drops the code
+        std::size_t deopts = 0; // Runs handed to the interpreter part way through
+    };
+    inline JitStats stats;
+
+    // Where the native code can hand a run back to the interpreter, and the types of the registers there.
+    struct DeoptPoint {
+        std::size_t pc;
+        std::vector<DataTypes::Type> registers; // Null for registers that are not live
+    };
+
+    // The machine code of one chunk. Owns its executable mapping.
+    struct Code {
+        using Entry = uint32_t (*)(uint64_t* registers, DataTypes::Data* const* slots);
+
+        void* memory = nullptr;
+        std::size_t mapped = 0;
+        std::size_t length = 0; // Bytes of code
+        Entry entry = nullptr; // Returns 0 when the run is done, else 1 + the index of the deopt point it left at
+        std::vector<DataTypes::Data*> slots; // The chunk's variables, by slot index
+        std::vector<DataTypes::Type> slotTypes; // The types the code was compiled for
+        std::vector<DeoptPoint> deopts; // deopts[0] is the entry guard
+        std::vector<uint64_t> frame; // Raw registers: ints and bools zero extended, doubles as their bits
+
+        Code() = default;
+        Code(const Code&) = delete;
+        Code& operator=(const Code&) = delete;
+        ~Code();
+    };
+
+    // Compiles a chunk for the current types of its variables. Returns nullptr if the chunk uses an instruction
+    // or a type the JIT does not handle, or on platforms without a JIT.
+    std::shared_ptr<Code> compile(Bytecode::Chunk& chunk);
+
+    // Counts a run of the chunk and runs it natively if it is hot, compiling it first if needed. Returns false
+    // if the caller should interpret the run instead.
+    bool run(Bytecode::Chunk& chunk, Bytecode::VM& vm);
+}
+
+#endif // JIT_DEF
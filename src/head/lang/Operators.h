@@ -0,0 +1,298 @@
+#ifndef OPERATORS_DEF
+#define OPERATORS_DEF
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include "Processor.h"
+#include "Token.h"
+
+// The operator engine.
+// Every binary operator is a table of kernels indexed by (opcode, left type, right type), and every unary
+// operator a table indexed by (opcode, operand type). A kernel is specialized for its exact operand types and
+// returns its result by value; numbers never allocate. Pairs without a kernel are type errors.
+//
+// Numeric promotion follows the usual arithmetic conversions, ranked bool < int < float < double: both
+// operands are converted to the higher rank, and never to less than int. So bool + bool is an int,
+// int + float is a float and anything with a double is a double. Int arithmetic wraps on overflow and
+// integer division or modulo by zero throws. Bitwise operators and shifts only take bools and ints.
+// Equality never throws: numbers compare by value across int, float and double, everything else through
+// Data::equals. Relational operators compare numbers by value and strings lexicographically.
+namespace Operators {
+    enum class Opcode : uint8_t {
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        BitAnd,
+        BitOr,
+        BitXor,
+        ShiftLeft,
+        ShiftRight,
+        Equal,
+        NotEqual,
+        Less,
+        Greater,
+        LessEqual,
+        GreaterEqual,
+        And,
+        Or,
+    };
+    enum class UnaryOpcode : uint8_t {
+        Negate,
+        Not,
+        BitNot,
+    };
+    inline constexpr std::size_t opcodeCount = static_cast<std::size_t>(Opcode::Or) + 1;
+    inline constexpr std::size_t unaryOpcodeCount = static_cast<std::size_t>(UnaryOpcode::BitNot) + 1;
+    inline constexpr std::size_t typeCount = static_cast<std::size_t>(DataTypes::Type::TypedArray) + 1;
+
+    using Kernel = DataTypes::Data (*)(const DataTypes::Data&, const DataTypes::Data&);
+    using UnaryKernel = DataTypes::Data (*)(const DataTypes::Data&);
+
+    // The building blocks of the tables: operator functors and kernel templates. They are in the header so that
+    // specialized call sites can inline a kernel instead of going through the table.
+    namespace Kernels {
+        using DataTypes::Data;
+        using DataTypes::Type;
+
+        // Reads the payload of a value whose type is known to be T.
+        template<Type T>
+        auto read(const Data& data) {
+            if constexpr (T == Type::Bool) {
+                return data.boolean;
+            } else if constexpr (T == Type::Int) {
+                return data.integer;
+            } else if constexpr (T == Type::Float) {
+                return data.single;
+            } else {
+                static_assert(T == Type::Double, "Not a numeric type.");
+                return data.real;
+            }
+        }
+
+        inline Data wrap(bool value) {
+            return DataTypes::Bool(value);
+        }
+        inline Data wrap(int value) {
+            return DataTypes::Int(value);
+        }
+        inline Data wrap(float value) {
+            return DataTypes::Float(value);
+        }
+        inline Data wrap(double value) {
+            return DataTypes::Double(value);
+        }
+
+        // The type both operands are converted to: the higher of the two, and at least int.
+        constexpr Type promote(Type left, Type right) {
+            Type higher = left > right ? left : right;
+            return higher > Type::Int ? higher : Type::Int;
+        }
+        template<Type T>
+        using Native = decltype(read<T>(std::declval<const Data&>()));
+
+        // Int arithmetic goes through unsigned so that overflow wraps instead of being undefined.
+        inline int wrapping(unsigned value) {
+            return static_cast<int>(value);
+        }
+
+        struct Add {
+            static constexpr Opcode code = Opcode::Add;
+            static constexpr const char* label = "Add";
+            static int apply(int a, int b) { return wrapping(static_cast<unsigned>(a) + static_cast<unsigned>(b)); }
+            template<typename N> static N apply(N a, N b) { return a + b; }
+        };
+        struct Subtract {
+            static constexpr Opcode code = Opcode::Subtract;
+            static constexpr const char* label = "Subtract";
+            static int apply(int a, int b) { return wrapping(static_cast<unsigned>(a) - static_cast<unsigned>(b)); }
+            template<typename N> static N apply(N a, N b) { return a - b; }
+        };
+        struct Multiply {
+            static constexpr Opcode code = Opcode::Multiply;
+            static constexpr const char* label = "Multiply";
+            static int apply(int a, int b) { return wrapping(static_cast<unsigned>(a) * static_cast<unsigned>(b)); }
+            template<typename N> static N apply(N a, N b) { return a * b; }
+        };
+        struct Divide {
+            static constexpr Opcode code = Opcode::Divide;
+            static constexpr const char* label = "Divide";
+            static int apply(int a, int b) {
+                if (b == 0) {
+                    throw std::runtime_error("Division by zero.");
+                }
+                return b == -1 ? wrapping(0u - static_cast<unsigned>(a)) : a / b; // INT_MIN / -1 wraps
+            }
+            template<typename N> static N apply(N a, N b) { return a / b; }
+        };
+        struct Modulo {
+            static constexpr Opcode code = Opcode::Modulo;
+            static constexpr const char* label = "Modulo";
+            static int apply(int a, int b) {
+                if (b == 0) {
+                    throw std::runtime_error("Division by zero.");
+                }
+                return b == -1 ? 0 : a % b;
+            }
+            template<typename N> static N apply(N a, N b) { return std::fmod(a, b); }
+        };
+        struct BitAnd {
+            static constexpr Opcode code = Opcode::BitAnd;
+            static constexpr const char* label = "BitAnd";
+            static int apply(int a, int b) { return a & b; }
+        };
+        struct BitOr {
+            static constexpr Opcode code = Opcode::BitOr;
+            static constexpr const char* label = "BitOr";
+            static int apply(int a, int b) { return a | b; }
+        };
+        struct BitXor {
+            static constexpr Opcode code = Opcode::BitXor;
+            static constexpr const char* label = "BitXor";
+            static int apply(int a, int b) { return a ^ b; }
+        };
+        struct ShiftLeft {
+            static constexpr Opcode code = Opcode::ShiftLeft;
+            static constexpr const char* label = "ShiftLeft";
+            static int apply(int a, int b) { return wrapping(static_cast<unsigned>(a) << (b & 31)); }
+        };
+        struct ShiftRight {
+            static constexpr Opcode code = Opcode::ShiftRight;
+            static constexpr const char* label = "ShiftRight";
+            static int apply(int a, int b) { return a >> (b & 31); }
+        };
+        struct Equal {
+            static constexpr Opcode code = Opcode::Equal;
+            static constexpr const char* label = "Equal";
+            template<typename N> static bool apply(N a, N b) { return a == b; }
+        };
+        struct NotEqual {
+            static constexpr Opcode code = Opcode::NotEqual;
+            static constexpr const char* label = "NotEqual";
+            template<typename N> static bool apply(N a, N b) { return a != b; }
+        };
+        struct Less {
+            static constexpr Opcode code = Opcode::Less;
+            static constexpr const char* label = "Less";
+            template<typename N> static bool apply(N a, N b) { return a < b; }
+        };
+        struct Greater {
+            static constexpr Opcode code = Opcode::Greater;
+            static constexpr const char* label = "Greater";
+            template<typename N> static bool apply(N a, N b) { return a > b; }
+        };
+        struct LessEqual {
+            static constexpr Opcode code = Opcode::LessEqual;
+            static constexpr const char* label = "LessEqual";
+            template<typename N> static bool apply(N a, N b) { return a <= b; }
+        };
+        struct GreaterEqual {
+            static constexpr Opcode code = Opcode::GreaterEqual;
+            static constexpr const char* label = "GreaterEqual";
+            template<typename N> static bool apply(N a, N b) { return a >= b; }
+        };
+        struct And {
+            static constexpr Opcode code = Opcode::And;
+            static constexpr const char* label = "And";
+            static bool apply(bool a, bool b) { return a && b; }
+        };
+        struct Or {
+            static constexpr Opcode code = Opcode::Or;
+            static constexpr const char* label = "Or";
+            static bool apply(bool a, bool b) { return a || b; }
+        };
+
+        // Kernels, each one for fixed operand types
+
+        template<typename Op, Type L, Type R>
+        Data numeric(const Data& left, const Data& right) {
+            using N = Native<promote(L, R)>;
+            return wrap(Op::apply(static_cast<N>(read<L>(left)), static_cast<N>(read<R>(right))));
+        }
+        inline Data concatenate(const Data& left, const Data& right) {
+            const std::string& a = left.asString();
+            const std::string& b = right.asString();
+            std::string result;
+            result.reserve(a.size() + b.size());
+            result.append(a).append(b);
+            return DataTypes::String(std::move(result));
+        }
+        template<typename Op>
+        Data compareStrings(const Data& left, const Data& right) {
+            return wrap(Op::apply(left.asString().compare(right.asString()), 0));
+        }
+        inline Data equal(const Data& left, const Data& right) {
+            return wrap(left.equals(right));
+        }
+        inline Data notEqual(const Data& left, const Data& right) {
+            return wrap(!left.equals(right));
+        }
+        template<typename Op>
+        Data logical(const Data& left, const Data& right) {
+            return wrap(Op::apply(left.truthy(), right.truthy()));
+        }
+
+        template<Type T>
+        Data negate(const Data& operand) {
+            if constexpr (T == Type::Int) {
+                return wrap(wrapping(0u - static_cast<unsigned>(operand.integer)));
+            } else {
+                return wrap(-read<T>(operand));
+            }
+        }
+        template<Type T>
+        Data bitNot(const Data& operand) {
+            return wrap(~static_cast<int>(read<T>(operand)));
+        }
+        inline Data logicalNot(const Data& operand) {
+            return wrap(!operand.truthy());
+        }
+    }
+
+    struct Table {
+        Kernel binary[opcodeCount][typeCount][typeCount];
+        UnaryKernel unary[unaryOpcodeCount][typeCount];
+    };
+    extern const Table table;
+
+    // The source symbol of an opcode, for error messages ("+", "<=", ...).
+    const char* symbol(Opcode op);
+    const char* symbol(UnaryOpcode op);
+    // Maps an operator token (Plus, Less, ...) to its opcode. Throws for tokens that are not binary operators.
+    Opcode binaryOpcode(Tokens::TokenKind kind);
+    // Maps a prefix operator token (Minus, Bang, Tilde) to its opcode. Throws for anything else.
+    UnaryOpcode unaryOpcode(Tokens::TokenKind kind);
+
+    [[noreturn]] void unsupported(Opcode op, const DataTypes::Data& left, const DataTypes::Data& right);
+    [[noreturn]] void unsupported(UnaryOpcode op, const DataTypes::Data& operand);
+
+    // The kernel for `op` on these operand types, or nullptr if the pair is unsupported. Executors that see
+    // the same types repeatedly can keep the kernel and call it directly.
+    inline Kernel lookup(Opcode op, DataTypes::Type left, DataTypes::Type right) {
+        return table.binary[static_cast<std::size_t>(op)][static_cast<std::size_t>(left)][static_cast<std::size_t>(right)];
+    }
+    inline UnaryKernel lookup(UnaryOpcode op, DataTypes::Type operand) {
+        return table.unary[static_cast<std::size_t>(op)][static_cast<std::size_t>(operand)];
+    }
+
+    inline DataTypes::Data apply(Opcode op, const DataTypes::Data& left, const DataTypes::Data& right) {
+        Kernel kernel = lookup(op, left.type, right.type);
+        if (!kernel) {
+            unsupported(op, left, right);
+        }
+        return kernel(left, right);
+    }
+    inline DataTypes::Data apply(UnaryOpcode op, const DataTypes::Data& operand) {
+        UnaryKernel kernel = lookup(op, operand.type);
+        if (!kernel) {
+            unsupported(op, operand);
+        }
+        return kernel(operand);
+    }
+}
+
+#endif // OPERATORS_DEF
@@ -6,7 +6,21 @@
 #include <memory>
 #include <iostream>
 #include <any>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <functional>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <variant>
 #include "stringTools.h"
+#include "Tokenizer.h"
+#include "Symbols.h"
+#include "Arena.h"
+#include "FlatMap.h"
 
 // Syntax
 // class <name> { <body> }
@@ -20,6 +34,31 @@
 
 namespace ProcessorTests {
     void testTokenizer();
+    void testTokenStream();
+    void testSymbolTable();
+    void testScanner();
+    void testSourceLoader();
+    void testParallelTokenizer();
+    void testSymbols();
+    void testArena();
+    void testPrattParser();
+    void testResolver();
+    void testAstCache();
+    void testValues();
+    void testCopyOnWrite();
+    void testDictionary();
+    void testTypedArrays();
+    void testGarbageCollector();
+    void testObjectPools();
+    void testShapes();
+    void testShapeReuse();
+    void testMethodTables();
+    void testTypeRegistry();
+    void testOperators();
+    void testSpecialization();
+    void testClosures();
+    void testBytecode();
+    void testJit();
     template<typename T>
     void assertEqual(const T& expected, const T& actual);
 
@@ -35,6 +74,18 @@ namespace ProcessorTests {
     void runTests();
 }
 
+namespace Nodes {
+    class Block;
+}
+namespace AstCache {
+    class Writer;
+    class Reader;
+}
+namespace Bytecode {
+    struct Chunk;
+    class Compiler;
+}
+
 namespace DataTypes {
     class Data;
     class Var;
@@ -47,250 +98,278 @@ namespace DataTypes {
     class Double;
     class Dict;
     class Array;
+    class TypedArrayObject;
     class Class;
     class ClassInstance;
     class Function;
-    // Variables are objects which contain data. The data can be anything. They are used to store values and can be passed around in the program.
-    class Var {
-        public:
-            Data data;
+    struct PrimitiveHash;
+    struct PrimitiveEqual;
+    using Dictionary = FlatMap<Primitive, Var, PrimitiveHash, PrimitiveEqual>;
+    using ArrayList = std::vector<Var>;
 
-            // Constructors using Lvalue ref. Used in Var(data_object_reference)
-            Var(Data& _data) : data(_data) {}
-            Var(const Data& _data) : data(_data) {}
+    // The runtime type of a value. Every Data stores it in one byte, so a type check is an integer compare.
+    enum class Type : uint8_t {
+        Null,
+        Bool,
+        Int,
+        Float,
+        Double,
+        // Types from here on are heap objects
+        String,
+        Array,
+        Dict,
+        Function,
+        ClassInstance,
+        TypedArray,
+    };
+    // The script-facing name of a type ("int", "string", ...).
+    const char* typeName(Type type);
 
-            // Constructors using Rvalue ref. Used in Var(new_data_object)
-            Var(const Data&& _data) : data(_data) {}
+    // Dense numeric id of a class type, see TypeRegistry. The built-in types come first, in Type order, so the
+    // id of a built-in value is its Type. User classes are numbered from builtinTypeCount up.
+    using TypeId = uint32_t;
+    inline constexpr TypeId noType = UINT32_MAX;
+    inline constexpr TypeId builtinTypeCount = static_cast<TypeId>(Type::Dict) + 1;
 
-            Var(const Var& other) : data(other.data) {}
-            Var(Var&& other) : data(std::move(other.data)) {}
-            Var& operator=(const Var& other) {
-                if (this != &other) {
-                    data = other.data;
-                }
+    // Base of every heap object a value can point to. Values share objects and count their references. Strings
+    // never change once made, and arrays and dicts are copied before a shared one is changed, so sharing is never
+    // visible from the language.
+    class Object {
+        public:
+            uint32_t references = 0;
+            Object() {}
+            // A copy is a new object, nothing refers to it yet.
+            Object(const Object&) {}
+            Object& operator=(const Object&) {
                 return *this;
             }
+            virtual ~Object() {}
+    };
+    // Base of the heap objects that hold values, and so can end up in a reference cycle: arrays, dicts and class
+    // instances. Counting frees them like any other object, the cycle collector frees the cycles counting cannot
+    // (see GarbageCollector.h). Made objects start in the young generation.
+    class TracedObject : public Object {
+        public:
+            TracedObject();
+            TracedObject(const TracedObject&) = delete;
+            TracedObject& operator=(const TracedObject&) = delete;
+            ~TracedObject() override;
+            // Appends the traced objects that values in this object point to.
+            virtual void trace(std::vector<TracedObject*>& children) const = 0;
+            // Drops every value in the object, which breaks the cycles it is part of.
+            virtual void clearReferences() = 0;
 
-            Var getProperty(const Primitive& label) {
-                // Dicts, Arrays and Classes are the only types that can have properties
-                if (data.type == "class_instance") {
-                    auto classInstance = std::any_cast<ClassInstance>(data.value);
-                    return classInstance.getProperty(label);
-                }
-                if (data.type == "dict") {
-                    auto dict = std::any_cast<Dict>(data.value);
-                    return dict.getProperty(label);
-                }
-                if (data.type == "array") {
-                    auto array = std::any_cast<Array>(data.value);
-                    return array.getProperty(label);
-                }
-                throw std::runtime_error("Property not found in variable.");
-            }
-
+            // Owned by the collector.
+            TracedObject* previous = nullptr;
+            TracedObject* next = nullptr;
+            uint32_t collectorReferences = 0; // References from outside the objects being collected
+            uint8_t generation = 0; // 0 young, 1 old
+            bool collecting = false;
+            bool reachable = false;
     };
+
+    class InstanceObject;
+    // Frees a class instance, or keeps it in its class's pool, see Class::setPool.
+    void freeInstance(Object* instance);
+
+    // A value: a type tag and an 8 byte payload, 16 bytes in total.
+    // Null, bool, int, float and double live inline and are read without any cast or allocation.
+    // Strings, containers, functions and class instances live in reference counted heap objects.
+    // Data has no virtual functions; the subclasses below only add constructors and accessors, so
+    // passing any of them around as a Data never slices anything away.
     class Data {
         public:
-            std::any value; 
-            std::string type;
-            Data (std::string _type,std::any _value) : type(_type), value(_value) {}
-            Data (const Data& other) = default;
-            Data& operator=(const Data& other) = default;
-            Data (Data&& other) = default;
-            Data(const Var& var) {
-                const Data& data = var.data;
-                type = data.type;
-                value = data.value;
-            }
-            virtual ~Data() {}
-            virtual const std::string toString() const {
-                return type;
-            }
-            virtual const JsonObject toJSON() const {
-                return JsonObject().add("type", type).add("value", value);
-            }
-
-            
-            virtual Data&& operator+(const Data& other) const {return Null();}
-            virtual Data&& operator-(const Data& other) const {return Null();}
-            virtual Data&& operator/(const Data& other) const {return Null();}
-            virtual Data&& operator*(const Data& other) const {return Null();}
-            virtual Data&& operator%(const Data& other) const {return Null();}
-            virtual Bool&& operator==(const Data& other) const {return Null();} 
-            virtual Bool&& operator!=(const Data& other) const {return Null();}
-            virtual Bool&& operator<(const Data& other) const {return Null();}
-            virtual Bool&& operator>(const Data& other) const {return Null();}
-            virtual Bool&& operator>=(const Data& other) const {return Null();}
-            virtual Bool&& operator<=(const Data& other) const {return Null();}
-            virtual Bool&& operator&&(const Data& other) const {return Null();}
-            virtual Bool&& operator||(const Data& other) const {return Null();}
-            virtual Data&& operator~() const {return Null();}
-            virtual Data&& operator!() const {return Null();}
-            virtual Data&& operator++() const {return Null();}
-            virtual Data&& operator--() const {return Null();}
-            virtual Data&& operator-() const {return Null();}
-
-            virtual operator bool() const {
-                return false;
-            }
-        };
-    class Primitive : public Data {
-        public:
-            Primitive() : Data("primitive", std::any()) {}
-            Primitive(std::string t, std::any v) : Data(t,v) {}
-            Primitive(const Primitive& other) : Data(other.type, other.value) {} 
-            Primitive& operator=(const Primitive& other) {
+            Type type;
+            union {
+                bool boolean;
+                int integer;
+                float single;
+                double real;
+                Object* object;
+            };
+
+            Data() : type(Type::Null), real(0) {}
+            explicit Data(bool v) : type(Type::Bool), real(0) { boolean = v; }
+            explicit Data(int v) : type(Type::Int), real(0) { integer = v; }
+            explicit Data(float v) : type(Type::Float), real(0) { single = v; }
+            explicit Data(double v) : type(Type::Double), real(v) {}
+            // Takes a reference to a heap object of the given type.
+            Data(Type t, Object* o) : type(t), object(o) {
+                retain();
+            }
+            Data(const Data& other) : type(other.type), real(other.real) {
+                retain();
+            }
+            Data(Data&& other) noexcept : type(other.type), real(other.real) {
+                other.type = Type::Null; // The reference moves with the payload
+            }
+            Data& operator=(const Data& other) {
                 if (this != &other) {
-                    type = other.type;
-                    value = other.value;
+                    Data copy(other);
+                    swap(copy);
                 }
                 return *this;
             }
-            Primitive(Primitive&& other) : Data(std::move(other)) {}
-            Primitive(const Var& var) : Data(var) {}
-            virtual std::size_t hash() const { // Default Hash function for the primitive type
-                return -1;
-            }
-            operator bool() const override {
-                return false;
-            }
-            virtual operator int() const {
-                return -1;
-            }
-            virtual operator float() const {
-                return -1.0f;
-            }
-            virtual operator double() const {
-                return -1.0;
-            }
-            virtual operator std::string() const {
-                return "abstract object";
-            }
-            Bool&& operator==(const Data& other) const override {
-                return false; 
-            }
-    };
-    // Numeric is a base class for all numeric types. It is used to define the common interface for all numeric types.
-    template<typename T>
-    class Numeric : public Primitive {
-        public:
-            Numeric(std::string t, std::any v) : Primitive(t,v) {}
-            Numeric(const Numeric& other) : Primitive(other.type, other.value) {}
-            Numeric& operator=(const Numeric& other) {
+            Data& operator=(Data&& other) noexcept {
                 if (this != &other) {
+                    release();
                     type = other.type;
-                    value = other.value;
+                    real = other.real;
+                    other.type = Type::Null;
                 }
                 return *this;
             }
-            Numeric(Numeric&& other) : Primitive(std::move(other)) {}
-            virtual std::size_t hash() const = 0;
-            operator bool() const override {
-                return std::any_cast<T>(value) != 0;
-            }
-            operator int() const override {
-                return std::any_cast<T>(value);
+            ~Data() {
+                release();
             }
-            operator float() const override {
-                return std::any_cast<T>(value);
+            void swap(Data& other) noexcept {
+                std::swap(type, other.type);
+                std::swap(real, other.real);
             }
-            operator double() const override {
-                return std::any_cast<T>(value);
+
+            bool is(Type t) const {
+                return type == t;
+            }
+            bool isHeap() const {
+                return type >= Type::String;
+            }
+            bool isNumeric() const {
+                return type >= Type::Bool && type <= Type::Double;
+            }
+            // Numeric payload widened to double (bools count as 0 and 1). Throws for non-numeric values.
+            double toDouble() const;
+            // Numeric payload narrowed to int. Throws for non-numeric values.
+            int toInt() const;
+            bool truthy() const;
+            explicit operator bool() const {
+                return truthy();
+            }
+            // Typed access to heap payloads. Throws if the value has another type.
+            const std::string& asString() const;
+            const ArrayList& asArray() const;
+            const Dictionary& asDict() const;
+            // Containers are copy-on-write: these give a container this value can change, copying it first if
+            // another value shares it. Throws if the value has another type.
+            ArrayList& mutableArray();
+            Dictionary& mutableDict();
+            const TypedArrayObject& asTypedArray() const;
+            TypedArrayObject& mutableTypedArray();
+
+            const std::string toString() const;
+            const JsonObject toJSON() const;
+            std::size_t hash() const;
+            // Structural equality, used for dictionary keys and ==.
+            bool equals(const Data& other) const;
+
+            Data operator+(const Data& other) const;
+            Data operator-(const Data& other) const;
+            Data operator*(const Data& other) const;
+            Data operator/(const Data& other) const;
+            Data operator%(const Data& other) const;
+            Data operator&(const Data& other) const;
+            Data operator|(const Data& other) const;
+            Data operator^(const Data& other) const;
+            Data operator<<(const Data& other) const;
+            Data operator>>(const Data& other) const;
+            Data operator==(const Data& other) const;
+            Data operator!=(const Data& other) const;
+            Data operator<(const Data& other) const;
+            Data operator>(const Data& other) const;
+            Data operator<=(const Data& other) const;
+            Data operator>=(const Data& other) const;
+            Data operator&&(const Data& other) const;
+            Data operator||(const Data& other) const;
+            Data operator-() const;
+            Data operator!() const;
+            Data operator~() const;
+
+        private:
+            void retain() {
+                if (isHeap()) {
+                    object->references++;
+                }
             }
-            operator std::string() const override {
-                return std::to_string(std::any_cast<T>(value));
+            void release() {
+                if (isHeap() && --object->references == 0) {
+                    if (type == Type::ClassInstance) {
+                        freeInstance(object);
+                    } else {
+                        delete object;
+                    }
+                }
             }
     };
-    class Null : public Primitive {
+    static_assert(sizeof(Data) == 16, "Data must stay a 16 byte tagged union.");
+
+    // Variables are objects which contain data. The data can be anything. They are used to store values and can be passed around in the program.
+    class Var {
         public:
-            Null() : Primitive("null",std::any()) {}
-            std::size_t hash() const override {
-                return 0;
-            }
-            operator bool() const override {
-                return false;
-            }
-            operator int() const override {
-                return 0;
-            }
-            operator float() const override {
-                return 0.0f;
-            }
-            operator double() const override {
-                return 0.0;
-            }
-            operator std::string() const override {
-                return "null";
-            }
+            Data data;
 
+            Var() {}
+            Var(const Data& _data) : data(_data) {}
+            Var(Data&& _data) : data(std::move(_data)) {}
 
+            Var getProperty(const Primitive& label);
+    };
 
+    // Primitives are the values that can be dictionary keys: null, bool, numbers and strings.
+    class Primitive : public Data {
+        public:
+            Primitive() {}
+            // Throws if `data` is a container, function or class instance.
+            Primitive(const Data& data);
     };
-    class String : public Primitive {
+    // Numeric is a base class for all numeric types. It is used to define the common interface for all numeric types.
+    template<typename T>
+    class Numeric : public Primitive {
         public:
-            String(std::string v) : Primitive("string",v) {}
-            std::size_t hash() const override {
-                return std::hash<std::string>()(std::any_cast<std::string>(value));
-            }
-            Bool&& operator==(const Data& other) const override {
-                if (other.type != "string") return Bool(false);
-                return Bool(std::any_cast<std::string>(value) == std::any_cast<std::string>(other.value));
-            }
-            operator std::string() const override {
-                return std::any_cast<std::string>(value); 
-            }
-            operator bool() const override {
-                return !std::any_cast<std::string>(value).empty();
+            explicit Numeric(T v) : Primitive(Data(v)) {}
+            T get() const {
+                if constexpr (std::is_same_v<T, bool>) {
+                    return boolean;
+                } else if constexpr (std::is_same_v<T, int>) {
+                    return integer;
+                } else if constexpr (std::is_same_v<T, float>) {
+                    return single;
+                } else {
+                    return real;
+                }
             }
     };
+    class Null : public Primitive {
+        public:
+            Null() {}
+    };
     class Bool : public Numeric<bool> {
         public:
-            Bool(bool v) : Numeric("bool", v) {}
-            Bool(const Data&& other) : Bool(bool(other)) {}
-            std::size_t hash() const override {
-                return std::hash<bool>()(std::any_cast<bool>(value));
-            }
-            Bool&& operator==(const Data& other) const override {
-                if (other.type != "bool") return Bool(false);
-                return Bool(std::any_cast<bool>(value) == std::any_cast<bool>(other.value));
-            }
+            Bool(bool v) : Numeric(v) {}
     };
-
     class Int : public Numeric<int> {
         public:
-            Int(int v) : Numeric("int", v) {}
-            std::size_t hash() const override {
-                return std::hash<int>()(std::any_cast<int>(value));
-            }
-            Bool&& operator==(const Data& other) const override {
-                if (other.type != "int") return Bool(false);
-                return std::any_cast<int>(value) == std::any_cast<int>(other.value);
-            }
+            Int(int v) : Numeric(v) {}
     };
-
     class Float : public Numeric<float> {
         public:
-            Float(float v) : Numeric("float", v) {}
-            std::size_t hash() const override {
-                return std::hash<float>()(std::any_cast<float>(value));
-            }
-            Bool&& operator==(const Data& other) const override {
-                if (other.type != "float") return Bool(false);
-                return std::any_cast<float>(value) == std::any_cast<float>(other.value);
-            }
+            Float(float v) : Numeric(v) {}
     };
-
     class Double : public Numeric<double> {
         public:
-            Double(double v) : Numeric("double", v) {}
-            std::size_t hash() const override {
-                return std::hash<double>()(std::any_cast<double>(value));
-            }
-            Bool&& operator==(const Data& other) const override {
-                if (other.type != "double") return Bool(false);
-                return std::any_cast<double>(value) == std::any_cast<double>(other.value);
+            Double(double v) : Numeric(v) {}
+    };
+    class StringObject : public Object {
+        public:
+            std::string text;
+            StringObject(std::string t) : text(std::move(t)) {}
+    };
+    class String : public Primitive {
+        public:
+            String(std::string v) : Primitive(Data(Type::String, new StringObject(std::move(v)))) {}
+            const std::string& get() const {
+                return asString();
             }
     };
+
     struct PrimitiveHash {
         std::size_t operator()(const Primitive& p) const {
             return p.hash();
@@ -298,227 +377,319 @@ namespace DataTypes {
     };
     struct PrimitiveEqual {
         bool operator()(const Primitive& p1, const Primitive& p2) const {
-            return p1 == p2;
+            return p1.equals(p2);
         }
     };
-    using Dictionary = std::unordered_map<Primitive, Var, PrimitiveHash, PrimitiveEqual>;
+
+    class DictObject : public TracedObject {
+        public:
+            Dictionary entries;
+            DictObject(Dictionary d) : entries(std::move(d)) {}
+            void trace(std::vector<TracedObject*>& children) const override;
+            void clearReferences() override;
+    };
     class Dict : public Data {
         public:
-            Dict() : Data("dict",Dictionary()) {}
-            Dict(Dictionary d) : Data("dict",d) {}
-            Dict(const Dict& other) : Data(other.type, other.value) {}
-            Dict& operator=(const Dict& other) {
-                if (this != &other) {
-                    type = other.type;
-                    value = other.value;
-                }
-                return *this;
-            }
-            Dict(Dict&& other) : Data(std::move(other)) {}
-            Var getProperty(const Primitive& label) {
-                auto dict = std::any_cast<Dictionary>(value);
-                auto it = dict.find(label);
-                if (it != dict.end()) {
-                    return it->second;
-                }
-                throw std::runtime_error("Property not found in dictionary.");
+            Dict() : Dict(Dictionary()) {}
+            Dict(Dictionary d) : Data(Type::Dict, new DictObject(std::move(d))) {}
+            const Dictionary& entries() const {
+                return asDict();
             }
-            const JsonObject toJSON() const override {
-                JsonObject json;
-                for (const auto& [key, value] : std::any_cast<Dictionary>(this->value)) {
-                    json.add(key.toString(), value.data.toJSON());
-                }
-                return json;
+            Dictionary& mutableEntries() {
+                return mutableDict();
             }
+            Var getProperty(const Primitive& label);
+    };
+    class ArrayObject : public TracedObject {
+        public:
+            ArrayList items;
+            ArrayObject(ArrayList a) : items(std::move(a)) {}
+            void trace(std::vector<TracedObject*>& children) const override;
+            void clearReferences() override;
     };
-    using ArrayList = std::vector<Var>;
     class Array : public Data {
         public:
-            Array() : Data("array",ArrayList()) {}
-            Array(ArrayList a) : Data("array",a) {}
-            Array(const Array& other) : Data(other.type, other.value) {}
-            Array& operator=(const Array& other) {
-                if (this != &other) {
-                    type = other.type;
-                    value = other.value;
-                }
-                return *this;
+            Array() : Array(ArrayList()) {}
+            Array(ArrayList a) : Data(Type::Array, new ArrayObject(std::move(a))) {}
+            const ArrayList& items() const {
+                return asArray();
             }
-            Array(Array&& other) : Data(std::move(other)) {}
-            Var getProperty(const Primitive& label) {
-                if (label.type != "int") {
-                    throw std::runtime_error("Index must be an integer.");
-                }
-                ArrayList array = std::any_cast<ArrayList>(value);
-                int index = std::any_cast<int>(label.value);
-                if (index < 0 || index >= array.size()) {
-                    throw std::runtime_error("Index out of bounds.");
-                }
-                return array[index];
+            ArrayList& mutableItems() {
+                return mutableArray();
             }
-            const JsonObject toJSON() const override {
-                JsonArray jsonArray;
-                for (const auto& item : std::any_cast<ArrayList>(this->value)) {
-                    jsonArray.append(item.data.toJSON());
-                }
-                return JsonObject().add("array", jsonArray);
+            Var getProperty(const Primitive& label);
+    };
+
+    // The element types of a typed array.
+    enum class ElementKind : uint8_t {
+        Int32,
+        Int64,
+        Float32,
+        Float64,
+    };
+    // "int32", "int64", "float32" or "float64".
+    const char* elementKindName(ElementKind kind);
+    // Converts a number to an element type, truncating it for the int kinds. Throws for values that are not
+    // numbers and for numbers an int kind cannot hold.
+    template<typename T>
+    T toElement(const Data& value);
+    // The value of an element: int32 as an int, int64 as an int when it fits and as a double otherwise, float32 as
+    // a float and float64 as a double.
+    Data elementValue(int32_t element);
+    Data elementValue(int64_t element);
+    Data elementValue(float element);
+    Data elementValue(double element);
+
+    // A homogeneous array of numbers, stored contiguously as 4 or 8 byte elements instead of as values.
+    class TypedArrayObject : public Object {
+        public:
+            // The alternative index is the ElementKind.
+            using Elements = std::variant<std::vector<int32_t>, std::vector<int64_t>, std::vector<float>, std::vector<double>>;
+            Elements elements;
+            TypedArrayObject(ElementKind kind, std::size_t length);
+            template<typename T>
+            TypedArrayObject(std::vector<T> values) : elements(std::move(values)) {}
+            explicit TypedArrayObject(Elements values) : elements(std::move(values)) {}
+
+            ElementKind kind() const {
+                return static_cast<ElementKind>(elements.index());
+            }
+            std::size_t size() const {
+                return std::visit([](const auto& values) { return values.size(); }, elements);
+            }
+            Data at(std::size_t index) const;
+            void set(std::size_t index, const Data& value);
+    };
+    class TypedArray : public Data {
+        public:
+            TypedArray(ElementKind kind, std::size_t length = 0) : Data(Type::TypedArray, new TypedArrayObject(kind, length)) {}
+            template<typename T>
+            explicit TypedArray(std::vector<T> values) : Data(Type::TypedArray, new TypedArrayObject(std::move(values))) {}
+            // Packs an array of numbers. Throws if an element is not a number or does not fit the kind.
+            TypedArray(ElementKind kind, const ArrayList& items);
+            const TypedArrayObject& elements() const {
+                return asTypedArray();
+            }
+            TypedArrayObject& mutableElements() {
+                return mutableTypedArray();
+            }
+            Var getProperty(const Primitive& label);
+    };
+
+    class FunctionObject : public Object {
+        public:
+            std::string name;
+            Symbols::SymbolId symbol; // Interned name, used for method lookup
+            std::vector<std::string> args;
+            // The body is owned by the arena of the program that defined the function.
+            Nodes::Block* body;
+            FunctionObject(std::string n, std::vector<std::string> a, Nodes::Block* b)
+                : name(std::move(n)), symbol(Symbols::intern(name)), args(std::move(a)), body(b) {}
+    };
+    class Function : public Data {
+        public:
+            Function(std::string n, std::vector<std::string> a, Nodes::Block* b)
+                : Data(Type::Function, new FunctionObject(std::move(n), std::move(a), b)) {}
+            const FunctionObject& get() const {
+                return *static_cast<FunctionObject*>(object);
             }
+            Symbols::SymbolId symbol() const {
+                return get().symbol;
+            }
+    };
+
+    // The layout of class instances: which property is in which slot. Instances that got the same properties in
+    // the same order share a shape, so code that has seen a shape once knows where a property is without looking
+    // its name up. The shapes of a class form a tree rooted at Class::rootShape(); each child adds one property
+    // to its parent's. They live as long as the class.
+    class Shape {
+        public:
+            static constexpr uint32_t missing = UINT32_MAX;
 
+            Shape() : serial(nextSerial.fetch_add(1, std::memory_order_relaxed)) {}
+            Shape(const Shape&) = delete;
+            Shape& operator=(const Shape&) = delete;
+
+            // The slot of the property, or `missing`.
+            uint32_t find(Symbols::SymbolId id) const {
+                auto it = slots.find(id);
+                return it == slots.end() ? missing : it->second;
+            }
+            // The shape with `id` added in the next slot. Made on first use and shared from then on.
+            const Shape* with(Symbols::SymbolId id) const;
+            // Property names by slot.
+            const std::vector<Symbols::SymbolId>& properties() const {
+                return names;
+            }
+            std::size_t size() const {
+                return names.size();
+            }
+            // Unique over the process: unlike the address, it is never reused after the shape's class is freed.
+            uint64_t id() const {
+                return serial;
+            }
+
+        private:
+            inline static std::atomic<uint64_t> nextSerial{1};
+            uint64_t serial;
+            std::vector<Symbols::SymbolId> names;
+            std::unordered_map<Symbols::SymbolId, uint32_t> slots;
+            mutable std::unordered_map<Symbols::SymbolId, std::unique_ptr<Shape>> transitions;
+            mutable std::mutex mutex; // Guards transitions
     };
+
+    struct PoolStats {
+        std::size_t hits; // Instances taken from the pool
+        std::size_t misses; // Instances allocated while the pool was on
+        std::size_t retained; // Instances in the pool now
+        std::size_t highWater; // Most instances the pool has held at once
+        std::size_t bytes; // Memory held by the retained instances
+        double hitRate() const {
+            return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+        }
+    };
+
     class Class {
         public:
             std::string name;
             // Methods are functions that can be called on in the class instances. This means methods have a constant reference to their body
             std::vector<Function> methods;
             // Properties are variables that are defined with their initial values in the class. In the class instance, they are instantiated as actual variables.
-            std::unordered_map<std::string, Data> properties;
+            // Keyed by interned name, see Symbols.
+            std::unordered_map<Symbols::SymbolId, Data> properties;
+            // Methods and parent are changed with addMethod and setParent, which keep the method tables current.
             std::weak_ptr<Class> parent; // Parent pointer as weak_ptr
-            Class(std::string n, std::unordered_map<std::string, Data> props = {}, std::weak_ptr<Class> parent_ref = std::weak_ptr<Class>()) : name(n), parent(parent_ref), properties(props) {}
-            Class(const Class& other) : name(other.name), methods(other.methods), properties(other.properties) {}
-            Class& operator=(const Class& other) {
-                if (this != &other) {
-                    name = other.name;
-                    methods = other.methods;
-                    properties = other.properties;
-                    parent = other.parent;
+            TypeId id = noType; // Set when the class is registered, see TypeRegistry
+            Class(std::string n, std::unordered_map<Symbols::SymbolId, Data> props = {}, std::weak_ptr<Class> parent_ref = std::weak_ptr<Class>()) : name(n), properties(props), parent(parent_ref) {}
+            // Copies get shapes and a method table of their own, so a shape always belongs to one class. They are
+            // not registered: an id names one class, and the copy gets its own when it is added.
+            Class(const Class& other)
+                : name(other.name), methods(other.methods), properties(other.properties), parent(other.parent) {}
+            // Not assignable: live instances point into the class's shapes, which have to outlive them.
+            Class& operator=(const Class&) = delete;
+            virtual ~Class();
+            // The shape of instances without properties.
+            const Shape* rootShape() const {
+                return shape.get();
+            }
+            JsonObject toJSON() const;
+            void addMethod(const Function& method) {
+                methods.push_back(method);
+                methodsChanged();
+            }
+            void setParent(std::weak_ptr<Class> parentClass) {
+                parent = std::move(parentClass);
+                methodsChanged();
+            }
+            // The flattened method table: the parent's table, with this class's overrides in the slots of the
+            // methods they override and its new methods after them. A method keeps its slot in every subclass.
+            // Tables are built on first use and again after any class adds a method or changes its parent.
+            const std::vector<Function>& methodTable() const {
+                if (tableEpoch != methodEpoch.load(std::memory_order_relaxed)) {
+                    buildMethodTable();
                 }
-                return *this;
+                return table;
             }
-            JsonObject toJSON() const {
-                JsonObject json;
-                json.add("name", name);
-                JsonArray methodsArray;
-                for (const auto& method : methods) {
-                    methodsArray.append(method.toJSON());
-                }
-                json.add("methods", methodsArray);
-                JsonObject propertiesObject;
-                for (const auto& [key, value] : properties) {
-                    propertiesObject.add(key, value.toJSON());
-                }
-                json.add("properties", propertiesObject);
-                if (!parent.expired()) {
-                    json.add("parent", parent.lock()->toJSON());
-                }
-                else {
-                    json.add("parent", "null");
-                }
-                return json;
+            // The slot of the method in methodTable(), or Shape::missing.
+            uint32_t methodSlot(Symbols::SymbolId id) const {
+                methodTable();
+                auto it = tableSlots.find(id);
+                return it == tableSlots.end() ? Shape::missing : it->second;
             }
-            void addMethod(const Function& method) {
-                methods.push_back(method);
+            // The method, own or inherited, or nullptr.
+            const Function* findMethod(Symbols::SymbolId id) const {
+                uint32_t slot = methodSlot(id);
+                return slot == Shape::missing ? nullptr : &table[slot];
             }
-            void addProperty(const std::string& name, const Data& initialValue) {
-                properties[name] = initialValue;
+            void addProperty(Symbols::SymbolId id, const Data& initialValue) {
+                properties[id] = initialValue;
+                propertiesChanged();
             }
-            Var getProperty(const Primitive& label) {
-                if (label.type != "string") {
-                    throw std::runtime_error("Property name must be a string.");
-                }
-                // Check if the property exists in the class (properties and methods)
-                // If it does, return the value of the property
-                // If it doesn't, throw an error
-                auto it = properties.find(std::any_cast<std::string>(label.value));
-                if (it != properties.end()) {
-                    return Var(it->second);
-                }
-                for (const auto& method : methods) {
-                    if (method.name == std::any_cast<std::string>(label.value)) {
-                        return Var(method);
-                    }
-                }
-                // Check if the property exists in the parent class (if any)
-                if (!parent.expired()) {
-                    auto parentClass = parent.lock();
-                    return parentClass->getProperty(label);
-                }
-                // If the property is not found in the class, throw an error
-                throw std::runtime_error("Property not found in class (or superclass).");
+            void addProperty(const std::string& name, const Data& initialValue) {
+                addProperty(Symbols::intern(name), initialValue);
             }
+            // Dynamic access by a runtime string. Property sites in scripts use the SymbolId overload.
+            Var getProperty(const Primitive& label);
+            Var getProperty(Symbols::SymbolId id);
+
+            virtual Data instantiate();
 
-            const virtual Data& instantiate() {
-                ClassInstance instance(*this);
-                return instance;
+            // Opt-in instance pool, for classes whose instances are made and dropped all the time, like bullets
+            // and particles. Dropped instances are reset to the class's properties and kept, up to `capacity` of
+            // them, and new instances are taken from the pool before any are allocated. 0 turns pooling off.
+            // Instances made while the pool is on go back to the class when they are dropped, so they must not
+            // outlive it; other instances never touch their class when they are freed.
+            void setPool(std::size_t capacity);
+            PoolStats poolStats() const;
+            // A new instance with the class's properties, from the pool if it has one. Used by ClassInstance.
+            InstanceObject* makeInstance();
+            // Takes a pooled instance nothing refers to anymore, into the pool or freed.
+            void recycle(InstanceObject* instance);
+
+        private:
+            std::unique_ptr<Shape> shape = std::make_unique<Shape>();
+            // Instances start as a copy of this template: the shape and slots of the properties. Built on first use.
+            const Shape* templateShape = nullptr;
+            std::vector<Var> templateSlots;
+            std::vector<InstanceObject*> pool;
+            std::size_t poolCapacity = 0;
+            PoolStats pooling{};
+
+            void buildTemplate();
+            // Pooled instances were reset to the old properties, so they are freed.
+            void propertiesChanged() {
+                templateShape = nullptr;
+                trimPool(0);
+            }
+            void trimPool(std::size_t size);
+            using MethodSlots = FlatMap<Symbols::SymbolId, uint32_t, std::hash<Symbols::SymbolId>, std::equal_to<Symbols::SymbolId>>;
+            mutable std::vector<Function> table;
+            mutable MethodSlots tableSlots;
+            mutable uint64_t tableEpoch = 0; // The methodEpoch the table was built in, 0 before the first build
+            // Bumped whenever any class changes, since that can change the tables of all its subclasses.
+            inline static std::atomic<uint64_t> methodEpoch{1};
+
+            static void methodsChanged() {
+                methodEpoch.fetch_add(1, std::memory_order_relaxed);
             }
+            void buildMethodTable() const;
+    };
+    class InstanceObject : public TracedObject {
+        public:
+            Class* classType;
+            const Shape* shape;
+            std::vector<Var> slots; // Property values, by the shape's slots
+            bool pooled = false; // Made while the class pooled instances, and returned to it when dropped
+            InstanceObject(Class* c) : classType(c), shape(c->rootShape()) {}
+            // The property's variable, or nullptr if the instance does not have it.
+            Var* find(Symbols::SymbolId id) {
+                uint32_t slot = shape->find(id);
+                return slot == Shape::missing ? nullptr : &slots[slot];
+            }
+            // Sets a property, moving the instance to the next shape if it does not have it yet.
+            void set(Symbols::SymbolId id, const Data& value);
+            void trace(std::vector<TracedObject*>& children) const override;
+            void clearReferences() override;
     };
     // A Class Instance is a variable that is an instance of a class.
     // It has a reference to the class and can access its methods and properties.
     class ClassInstance : public Data {
         public:
-            std::unordered_map<std::string, Var> properties;
-            ClassInstance(Class& c) : Data("class_instance",c) {
-                for (const auto& [key, value] : c.properties) {
-                    properties[key] = Var(value);
-                }
-            }
-            ClassInstance(const ClassInstance& other) : Data(other.type, other.value), properties(other.properties) {}
-            ClassInstance& operator=(const ClassInstance& other) {
-                if (this != &other) {
-                    type = other.type;
-                    value = other.value;
-                    properties = other.properties;
-                }
-                return *this;
-            }
-            Var getProperty(const Primitive& label) {
-                if (label.type != "string") {
-                    throw std::runtime_error("Property name must be a string.");
-                }
-                // Check if the property exists in the class instance
-                // If it does, return the value of the property
-                // If it doesn't, throw an error
-                auto it = properties.find(std::any_cast<std::string>(label.value));
-                if (it != properties.end()) {
-                    return it->second;
-                } 
-                // Check if the property exists in the class (just methods)
-                // If it does, return the value of the property
-                // If it doesn't, throw an error
-                for (const auto& method : std::any_cast<Class&>(value).methods) {
-                    if (method.name == std::any_cast<std::string>(label.value)) {
-                        return Var(method);
-                    }
-                }
-                // If the property is not found in the class instance, throw an error
-                throw std::runtime_error("Property not found in class instance.");
-            }
-            const JsonObject toJSON() const override {
-                JsonObject json;
-                json.add("class", std::any_cast<Class&>(value).toJSON());
-                JsonObject propertiesObject;
-                for (const auto& [key, value] : properties) {
-                    propertiesObject.add(key, value.data.toJSON());
-                }
-                json.add("properties", propertiesObject);
-                return json;
-            }
-    };
-    class Function : public Data {
-        public:
-            Function(std::string n, std::vector<std::string> a, std::shared_ptr<Nodes::Block> b) : Data("function",b), name(n), args(a) {}
-            Function(const Function& other) : Data(other.type, other.value), name(other.name), args(other.args) {}
-            Function& operator=(const Function& other) {
-                if (this != &other) {
-                    type = other.type;
-                    value = other.value;
-                    name = other.name;
-                    args = other.args;
-                }
-                return *this;
+            ClassInstance(Class& c);
+            InstanceObject& get() const {
+                return *static_cast<InstanceObject*>(object);
             }
-            Function(Function&& other) : Data(std::move(other)), name(std::move(other.name)), args(std::move(other.args)) {}
-            std::string name;
-            std::vector<std::string> args;
-            // Body is stored in the the superclass's "value" field.
+            // Dynamic access by a runtime string. Property sites in scripts use the SymbolId overload.
+            Var getProperty(const Primitive& label);
+            Var getProperty(Symbols::SymbolId id);
     };
 
     class IntClassType : public Class {
         public:
             IntClassType() : Class("int") {
             }
-            const Data& instantiate() override {
-                Int instance(0);
-                return instance;
+            Data instantiate() override {
+                return Int(0);
             }
     };
 
@@ -526,86 +697,136 @@ namespace DataTypes {
         public:
             StringClassType() : Class("string") {
             }
-            const Data& instantiate() override {
-                String instance("");
-                return instance;
+            Data instantiate() override {
+                return String("");
             }
     };
     class BoolClassType : public Class {
         public:
             BoolClassType() : Class("bool") {
             }
-            const Data& instantiate() override {
-                Bool instance(false);
-                return instance;
+            Data instantiate() override {
+                return Bool(false);
             }
     };
     class FloatClassType : public Class {
         public:
             FloatClassType() : Class("float") {
             }
-            const Data& instantiate() override {
-                Float instance(0.0f);
-                return instance;
+            Data instantiate() override {
+                return Float(0.0f);
             }
     };
     class DoubleClassType : public Class {
         public:
             DoubleClassType() : Class("double") {
             }
-            const  Data& instantiate() override {
-                Double instance(0.0);
-                return instance;
+            Data instantiate() override {
+                return Double(0.0);
             }
     };
     class NullClassType : public Class {
         public:
             NullClassType() : Class("null") {
             }
-            const Data& instantiate() override {
-                Null instance;
-                return instance;
+            Data instantiate() override {
+                return Null();
             }
     };
     class ArrayClassType : public Class {
         public:
             ArrayClassType() : Class("array") {
             }
-            const Data& instantiate() override {
-                Array instance;
-                return instance;
+            Data instantiate() override {
+                return Array();
             }
     };
     class DictClassType : public Class {
         public:
             DictClassType() : Class("dict") {
             }
-            const Data& instantiate() override {
-                Dict instance;
-                return instance;
+            Data instantiate() override {
+                return Dict();
             }
     };
 
-    std::vector<Class> defaultClassTypes = {
-        IntClassType(),
-        StringClassType(),
-        BoolClassType(),
-        FloatClassType(),
-        DoubleClassType(),
-        NullClassType(),
-        ArrayClassType(),
-        DictClassType()
+    // The class types of the process. The built-in types are made once, on first use, and never change, so they
+    // are looked up without a lock and no scope keeps a copy of them. User classes are registered by
+    // Block::addClass and keep their id for the life of the process. The registry does not own them; whoever
+    // defines a class keeps it alive while scripts can reach it. A destroyed class leaves its id unused, so get()
+    // throws for it rather than returning the freed class.
+    class TypeRegistry {
+        public:
+            static TypeRegistry& instance();
+
+            // The id of the built-in type with that name ("int", "dict", ...), or noType. User classes are found
+            // through the blocks that define them, since two scripts may each have a class with the same name.
+            TypeId find(Symbols::SymbolId name) const;
+            // Throws std::runtime_error for ids that are not registered or whose class was destroyed.
+            Class& get(TypeId id) const;
+            // Gives the class the next id and returns it. Classes that already have an id keep it.
+            TypeId add(Class& classType);
+            // Called by ~Class, the id is never given out again.
+            void remove(Class& classType);
+            std::size_t size() const;
+
+            TypeRegistry(const TypeRegistry&) = delete;
+            TypeRegistry& operator=(const TypeRegistry&) = delete;
+
+        private:
+            TypeRegistry();
+
+            std::array<Class*, builtinTypeCount> builtins;
+            std::unordered_map<Symbols::SymbolId, TypeId> builtinNames;
+            mutable std::mutex mutex; // Guards the user classes
+            std::deque<Class*> users;
     };
-    // The default class types are the primitive types. They are used to define the primitive types in the language.
+    // The class id of a value: its Type for built-in values, its class's id for instances, noType for functions and typed arrays.
+    TypeId typeIdOf(const Data& value);
 }
 
+// Nodes are allocated in the Arena of the Program that parsed them and link to each other with plain pointers.
+// A node never owns another node; the whole tree is released in one go when the arena is reset.
 namespace Nodes {
-    class Base : public std::enable_shared_from_this<Base> {
+    class Expression;
+    class Resolver;
+
+    // Closure-compiled code, see Expression::compile. Operators, variable slots and constants are bound when
+    // the closure is built, so running it does no lookups by name and no dispatch on the node kind.
+    using CompiledExpression = std::function<DataTypes::Data()>;
+    using CompiledStatement = std::function<void()>;
+
+    // How a program runs: by walking the tree with evaluate() and execute(), through compiled closures, or as
+    // bytecode on the VM (see Bytecode). All give the same results, the tree stays the reference.
+    enum class ExecutionMode : uint8_t {
+        Tree,
+        Closures,
+        Bytecode,
+    };
+
+    // Operator sites rewrite themselves into variants specialized for the operand types they see, see
+    // BinaryExpression in Processor.cpp. The counters are global and count rewrites, not evaluations.
+    struct SpecializationStats {
+        std::size_t specialized = 0; // Sites rewritten into a variant for one type pair
+        std::size_t guardFailures = 0; // Variants that saw other operand types and gave their site back
+        std::size_t generalized = 0; // Sites that saw too many type pairs and stay generic for good
+    };
+    inline SpecializationStats specializationStats;
+
+    // Property reads (`enemy.hp`) cache where they found the property, see PropertyCache.
+    struct PropertyCacheStats {
+        std::size_t misses = 0; // Reads that looked the property up by name
+        std::size_t polymorphic = 0; // Sites that have seen more than one shape
+        std::size_t megamorphic = 0; // Sites that saw too many shapes and stopped caching
+    };
+    inline PropertyCacheStats propertyCacheStats;
+
+    class Base {
         public:
-            std::weak_ptr<Base> parent; // Parent pointer as weak_ptr
-            std::string name;
+            Base* parent; // Enclosing node, nullptr for the root or until the node is attached
+            const char* name; // Static description of the node kind
 
-            Base(std::weak_ptr<Base> parentPointer, std::string n) 
+            Base(Base* parentPointer, const char* n) 
                 : parent(parentPointer), name(n) {}
 
             virtual ~Base() {
@@ -613,54 +834,95 @@ namespace Nodes {
 
             const std::string toString() const;
             virtual const JsonObject toJSON() const;
-            virtual void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end);
-            virtual const DataTypes::Var& getVar(const std::string& label) const;
-            virtual const DataTypes::Class& getClass(const std::string& label) const;
+            virtual void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end);
+            virtual const DataTypes::Var& getVar(Symbols::SymbolId label) const;
+            virtual const DataTypes::Class& getClass(Symbols::SymbolId label) const;
             virtual void execute() {}
+            // Swaps the child `from` for `to` in place. Returns false if `from` is not a child or the node cannot
+            // swap children, in which case nothing changes.
+            virtual bool replaceChild(Expression* /*from*/, Expression* /*to*/) {
+                return false;
+            }
+            // Binds the names in the node and its children to slots, see Resolver.
+            virtual void resolve(Resolver& /*resolver*/) {}
+            // Writes the node and its children to a .hypec image, see AstCache. Throws for nodes that cannot be cached.
+            virtual void serialize(AstCache::Writer& writer) const;
     };
 
     class Expression : public Base {
         public:
-            Expression(std::weak_ptr<Base> parentPointer, std::string n) 
+            Expression(Base* parentPointer, const char* n) 
                 : Base(parentPointer, n) {}
             virtual DataTypes::Data evaluate(); // Default evaluate method
+            // Lowers the node and its children to a closure that computes the same value as evaluate().
+            // Nodes without their own lowering fall back to calling evaluate() on themselves.
+            virtual CompiledExpression compile();
+            // Emits bytecode that leaves the value in a new register on top, and returns that register.
+            // Nodes without their own code emit an instruction that calls evaluate().
+            virtual uint8_t emit(Bytecode::Compiler& compiler);
     };
 
     class Statement : public Expression {
         public:
-            std::shared_ptr<Expression> expression; // Child pointer as shared_ptr
-            Statement(std::weak_ptr<Base> parentPointer, std::string n, std::shared_ptr<Expression> expr = nullptr) 
+            Expression* expression; // Child node
+            Statement(Base* parentPointer, const char* n, Expression* expr = nullptr) 
                 : Expression(parentPointer, n), expression(expr) {}
             const JsonObject toJSON() const override;
+            bool replaceChild(Expression* from, Expression* to) override;
+            void resolve(Resolver& resolver) override;
+            // The closure counterpart of execute(). Defaults to compiling the statement as an expression.
+            virtual CompiledStatement compileStatement();
+            // Emits the statement's bytecode. Registers it allocates are released when it ends.
+            virtual void emitStatement(Bytecode::Compiler& compiler);
     };
 
     class Block : public Base {
         public:
-            std::vector<std::shared_ptr<Statement>> stmts; // Child pointers as shared_ptr
-            std::unordered_map<std::string, DataTypes::Var> variables;
-            std::unordered_map<std::string, DataTypes::Class&> classTypes; // Class types are the primitive types.
+            std::vector<Statement*> stmts; // Child nodes
+            // Variables the resolver found in the block, addressed by slot. The array only grows while the block
+            // is resolved, so compiled code can keep pointers into it until the program is processed again.
+            std::vector<DataTypes::Var> slots;
+            std::unordered_map<Symbols::SymbolId, uint32_t> slotNames; // Slot of each name, for access by name
+            // Variables that only appear at run time: set by the host after the block was resolved, or named
+            // dynamically. Keyed by interned name, see Symbols.
+            std::unordered_map<Symbols::SymbolId, DataTypes::Var> variables;
+            Block* enclosing = nullptr; // The next block out, set by the resolver
+            // Classes defined in this block. Built-in types are found in the shared TypeRegistry.
+            std::unordered_map<Symbols::SymbolId, DataTypes::Class&> classTypes;
 
-            Block(std::weak_ptr<Base> parentPointer, std::string n) 
-                : Base(parentPointer, n) {
-                for (const auto& classType : DataTypes::defaultClassTypes) {
-                    classTypes[classType.name] = classType;
-                }
-            }
+            Block(Base* parentPointer, const char* n) 
+                : Base(parentPointer, n) {}
 
-            void setVar(const std::string& label, DataTypes::Data value);
+            void setVar(Symbols::SymbolId label, DataTypes::Data value);
+            void setVar(const std::string& label, DataTypes::Data value) {
+                setVar(Symbols::intern(label), value);
+            }
+            // Registers the class, see TypeRegistry, and makes it visible in this block and the ones inside it.
             void addClass(DataTypes::Class& classType);
+            // The variable of this block with that name, in a slot or declared at run time, or nullptr.
+            DataTypes::Var* findVar(Symbols::SymbolId label);
 
-            const DataTypes::Var& getVar(const std::string& label) const override;
-            const DataTypes::Class& getClass(const std::string& label) const override;
-            void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end);
+            const DataTypes::Var& getVar(Symbols::SymbolId label) const override;
+            const DataTypes::Class& getClass(Symbols::SymbolId label) const override;
+            // Runs the statements in order.
+            void execute() override;
+            CompiledStatement compile();
+            void emit(Bytecode::Compiler& compiler);
+            void resolve(Resolver& resolver) override;
+            // Parses statements in place until the end of the tokens or the '}' closing this block, which is left for the caller.
+            void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override;
 
             const JsonObject toJSON() const override;
+            // Blocks are written as a statement count followed by the statements.
+            void serialize(AstCache::Writer& writer) const override;
+            void deserialize(Arena& arena, AstCache::Reader& reader);
     };
 
     namespace Expressions {
         class StatementCondition;
         class BinaryExpression;
         class UnaryExpression;
+        class AssignmentExpression;
 
         class Value; // A constant value, must be a primitive type.
             class ArrayList; // A list of values, must be a primitive type.
@@ -683,21 +945,39 @@ namespace Nodes {
     namespace Statements {
         class IfStatement : public Statement {
             public:
-                std::shared_ptr<Block> body; // Child pointer as shared_ptr
+                Block* body = nullptr; // Child node
     
-                IfStatement(std::weak_ptr<Base> parentPointer)
+                IfStatement(Base* parentPointer)
                     : Statement(parentPointer, "IfStatement") {
                 }
-                void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end);
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override;
+                void execute() override;
+                CompiledStatement compileStatement() override;
+                void emitStatement(Bytecode::Compiler& compiler) override;
+                void resolve(Resolver& resolver) override;
 
                 const JsonObject toJSON() const override;
+                void serialize(AstCache::Writer& writer) const override;
+        };
+
+        // An expression used as a statement, such as an assignment: <expression>;
+        class ExpressionStatement : public Statement {
+            public:
+                ExpressionStatement(Base* parentPointer)
+                    : Statement(parentPointer, "ExpressionStatement") {
+                }
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override;
+                void execute() override;
+                CompiledStatement compileStatement() override;
+                void emitStatement(Bytecode::Compiler& compiler) override;
+                void serialize(AstCache::Writer& writer) const override;
         };
 
         class ElseStatement : public Statement {
             public:
-                std::shared_ptr<Block> body; // Child pointer as shared_ptr
+                Block* body = nullptr; // Child node
     
-                ElseStatement(std::weak_ptr<Base> parentPointer, std::string n)
+                ElseStatement(Base* parentPointer, const char* n)
                     : Statement(parentPointer, n) {
                 }
         };
@@ -725,23 +1005,194 @@ namespace Nodes {
     namespace Blocks {
         class StatementBlock : public Block {
             public:
-                StatementBlock(std::weak_ptr<Base> p) : Block(p, "Statement Block") {}
-                void process(std::vector<std::string>::iterator& start, std::vector<std::string>::iterator end);
+                StatementBlock(Base* p) : Block(p, "Statement Block") {}
+                void process(Arena& arena, Tokens::Iterator& start, Tokens::Iterator end) override;
         };
     }
 
     class Body : public Block {
         public:
-            Body() : Block(std::weak_ptr<Base>(), "Main Body") {}
-            const DataTypes::Var& getVar(const std::string& label) const override;
-            const DataTypes::Class& getClass(const std::string& label) const override;
+            Arena* arena; // The arena of the program, where nodes rewritten at run time are allocated
+
+            Body(Arena* owner = nullptr) : Block(nullptr, "Main Body"), arena(owner) {}
+            const DataTypes::Var& getVar(Symbols::SymbolId label) const override;
+            const DataTypes::Class& getClass(Symbols::SymbolId label) const override;
     };
-}
 
-class Tokenizer {
-    public:
-        static std::vector<std::string> process(const std::string input);
-};
+    // Where a name resolved to: `slot` in the block `depth` blocks out from the innermost block around the site.
+    struct Address {
+        Block* scope = nullptr; // Innermost block around the site, nullptr if the name is not resolved
+        uint16_t depth = 0;
+        uint32_t slot = 0;
+
+        bool resolved() const {
+            return scope != nullptr;
+        }
+        Block* block() const {
+            Block* block = scope;
+            for (uint16_t i = 0; i < depth; i++) {
+                block = block->enclosing;
+            }
+            return block;
+        }
+        DataTypes::Var& var() const {
+            return block()->slots[slot];
+        }
+    };
+
+    // Binds every name to an Address before the program runs. Blocks are walked in source order; an assignment
+    // in the outermost block gives its name a slot there unless it already has one. Assignments in nested blocks
+    // only get the slot of an enclosing block that already has the name: the host may add the name to an outer
+    // block after parsing, so a new variable is declared by name when it runs, as the tree does. A name read
+    // before any block has a slot for it stays unresolved and is looked up by name when it runs, so variables
+    // the host sets later are still found.
+    class Resolver {
+        public:
+            std::vector<Block*> scopes; // Enclosing blocks, innermost last
+
+            // Makes `block` the innermost scope. Variables the host set in it become slots.
+            void enter(Block& block);
+            void leave();
+            // The address of the name as seen from the innermost scope, unresolved if no scope has it.
+            Address lookup(Symbols::SymbolId symbol) const;
+            // Like lookup, but gives the name a slot if no scope has it and the innermost scope is the outermost one.
+            Address declare(Symbols::SymbolId symbol);
 
+        private:
+            // The (scope index, slot) of every visible declaration of a name, innermost last, so a lookup does not
+            // depend on how deep the blocks nest.
+            std::unordered_map<Symbols::SymbolId, std::vector<std::pair<uint32_t, uint32_t>>> visible;
+
+            void show(Symbols::SymbolId symbol, uint32_t slot) {
+                visible[symbol].emplace_back(static_cast<uint32_t>(scopes.size() - 1), slot);
+            }
+    };
+
+    // A variable bound for compiled code. Resolved names bind when the slot is made. Others search the blocks
+    // once: when the slot is made if the variable exists by then, otherwise on the first access that finds or
+    // declares it. Variables declared at run time live in a node-based map, so the pointer stays valid while
+    // other variables are added.
+    struct VariableSlot {
+        Base* site; // The node the search starts above
+        Symbols::SymbolId symbol;
+        DataTypes::Var* var;
+
+        VariableSlot(Base* node, Symbols::SymbolId id, const Address& address = Address());
+
+        // The variable in the innermost enclosing block that has it, or nullptr.
+        DataTypes::Var* find() const;
+        const DataTypes::Data& read() {
+            return var ? var->data : bindForRead();
+        }
+        // Like AssignmentExpression::evaluate, a variable that does not exist yet is declared in the innermost block.
+        DataTypes::Var& write() {
+            return var ? *var : bindForWrite();
+        }
+
+        private:
+            const DataTypes::Data& bindForRead();
+            DataTypes::Var& bindForWrite();
+    };
+
+    // The inline cache of a property read site. It keeps the instance shapes the site has seen with where the
+    // property was in each, so a read from a known shape is a compare and a load. Shapes are told apart by their
+    // id, which outlives the class, so a site never mistakes a new shape for a freed one at the same address. A
+    // site that sees one shape is monomorphic, one that sees up to `ways` shapes is polymorphic and checks them in
+    // turn. Sites that see more are megamorphic and look every read up by name from then on.
+    class PropertyCache {
+        public:
+            static constexpr std::size_t ways = 4;
+
+            // The property of an instance, or the entry of a dict with the name as key. Throws if there is none.
+            DataTypes::Var read(const DataTypes::Data& object, Symbols::SymbolId name) {
+                if (object.is(DataTypes::Type::ClassInstance)) {
+                    const DataTypes::InstanceObject& instance = *static_cast<DataTypes::InstanceObject*>(object.object);
+                    for (std::size_t i = 0; i < size(); i++) {
+                        if (entries[i].shape == instance.shape->id()) {
+                            if (!entries[i].method) {
+                                return instance.slots[entries[i].index];
+                            }
+                            // A slot of the method table holds the same method until the class gets a new parent
+                            const std::vector<DataTypes::Function>& table = instance.classType->methodTable();
+                            if (entries[i].index < table.size() && table[entries[i].index].symbol() == name) {
+                                return DataTypes::Var(table[entries[i].index]);
+                            }
+                            break;
+                        }
+                    }
+                }
+                return miss(object, name);
+            }
+            // Shapes the site has cached.
+            std::size_t size() const {
+                return count > ways ? ways : count;
+            }
+            bool megamorphic() const {
+                return count > ways;
+            }
+
+        private:
+            struct Entry {
+                uint64_t shape; // Shape::id(), 0 for none
+                uint32_t index; // A slot of the shape, or with `method` set a slot of the class's method table
+                bool method;
+            };
+            std::array<Entry, ways> entries{};
+            std::size_t count = 0; // ways + 1 once megamorphic
+
+            DataTypes::Var miss(const DataTypes::Data& object, Symbols::SymbolId name);
+    };
+
+    // A compilation unit: the arena that owns every node of one script, and the script's root body.
+    class Program {
+        public:
+            Arena arena;
+            Body* body;
+            ExecutionMode mode = ExecutionMode::Tree;
+            CompiledStatement compiled; // Built on the first run in closure mode
+            std::shared_ptr<Bytecode::Chunk> chunk; // Built on the first run in bytecode mode
+
+            Program() : body(arena.make<Body>(&arena)) {}
+            Program(const Program&) = delete;
+            Program& operator=(const Program&) = delete;
+
+            void process(Tokens::Iterator& start, Tokens::Iterator end) {
+                body->process(arena, start, end);
+                if (start != end) {
+                    throw std::runtime_error("Unmatched '}'.");
+                }
+                resolve();
+            }
+            void process(const Tokens::TokenStream& tokens) {
+                Tokens::Iterator start = tokens.begin();
+                process(start, tokens.end());
+            }
+            // Binds the names of the whole body to slots. Compiled code points into the slots, so it is dropped and
+            // built again with the new addresses on the next run.
+            void resolve() {
+                compiled = nullptr;
+                chunk.reset();
+                Resolver resolver;
+                body->resolve(resolver);
+            }
+            // Runs the script in its execution mode. Variables persist between runs.
+            void run() {
+                if (mode == ExecutionMode::Tree) {
+                    body->execute();
+                    return;
+                }
+                if (mode == ExecutionMode::Bytecode) {
+                    runBytecode();
+                    return;
+                }
+                if (!compiled) {
+                    compiled = body->compile();
+                }
+                compiled();
+            }
+            // Compiles the body on the first call and runs it on the VM, see Bytecode.cpp.
+            void runBytecode();
+    };
+}
 
 #endif // PROCESSOR_DEF
\ No newline at end of file
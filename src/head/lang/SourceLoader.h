@@ -0,0 +1,47 @@
+#ifndef SOURCE_LOADER_DEF
+#define SOURCE_LOADER_DEF
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace Sources {
+    // A read-only memory mapping of a source file (.hype).
+    // The file is never copied into the heap: tokens point straight into the mapping, and pages the lexer
+    // has finished with can be handed back to the OS because they are clean and reloadable from the file.
+    class MappedFile {
+        public:
+            explicit MappedFile(const std::string& path);
+            ~MappedFile();
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            std::string_view view() const {
+                return std::string_view(data, length);
+            }
+            std::size_t size() const {
+                return length;
+            }
+            const std::string& getPath() const {
+                return path;
+            }
+
+            // Hints that the mapping will be read front to back.
+            void adviseSequential() const;
+            // Drops the resident pages fully inside [offset, offset + bytes). They fault back in from the file if touched again.
+            void release(std::size_t offset, std::size_t bytes) const;
+
+        private:
+            std::string path;
+            const char* data = nullptr;
+            std::size_t length = 0;
+#ifdef _WIN32
+            void* fileHandle = nullptr;
+            void* mappingHandle = nullptr;
+#endif
+    };
+
+    // Size of the slices the lexer is fed while streaming a mapped file.
+    inline constexpr std::size_t defaultChunkSize = 4 * 1024 * 1024;
+}
+
+#endif // SOURCE_LOADER_DEF
@@ -0,0 +1,29 @@
+#ifndef SYMBOLS_DEF
+#define SYMBOLS_DEF
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Process-wide identifier interning.
+// Every identifier is turned into a dense 32-bit id once, at lex time. Scopes, class properties and
+// method tables key on the id, so runtime variable and property access never hashes or compares strings.
+// All functions are thread-safe; the parallel lexer interns from several threads at once.
+namespace Symbols {
+    using SymbolId = uint32_t;
+
+    // Returned by find() for names that were never interned.
+    inline constexpr SymbolId none = UINT32_MAX;
+
+    // Returns the id of `name`, adding it if it is new. Ids are never reused or freed.
+    SymbolId intern(std::string_view name);
+    // Returns the id of `name` without adding it, or Symbols::none.
+    SymbolId find(std::string_view name);
+    // The text of an interned id. The view stays valid for the lifetime of the process.
+    std::string_view name(SymbolId id);
+    std::string toString(SymbolId id);
+    // Number of interned symbols.
+    std::size_t count();
+}
+
+#endif // SYMBOLS_DEF
@@ -0,0 +1,144 @@
+#ifndef TOKEN_DEF
+#define TOKEN_DEF
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Symbols.h"
+
+namespace Tokens {
+    // Every kind of token the lexer can produce. Literal kinds carry a pre-parsed payload in the token.
+    enum class TokenKind : uint8_t {
+        Unknown,
+        Identifier,
+        Int,
+        Double,
+        String,
+
+        // Punctuation
+        LeftParen,      // (
+        RightParen,     // )
+        LeftBrace,      // {
+        RightBrace,     // }
+        LeftBracket,    // [
+        RightBracket,   // ]
+        Comma,          // ,
+        Colon,          // :
+        DoubleColon,    // ::
+        Semicolon,      // ;
+        Dot,            // .
+
+        // Operators
+        Plus,           // +
+        Minus,          // -
+        Star,           // *
+        Slash,          // /
+        Percent,        // %
+        Power,          // **
+        Bang,           // !
+        Tilde,          // ~
+        Assign,         // =
+        Less,           // <
+        Greater,        // >
+        Equal,          // ==
+        NotEqual,       // !=
+        LessEqual,      // <=
+        GreaterEqual,   // >=
+        And,            // &&
+        Or,             // ||
+        PlusAssign,     // +=
+        MinusAssign,    // -=
+        StarAssign,     // *=
+        SlashAssign,    // /=
+        PercentAssign,  // %=
+        Increment,      // ++
+        Decrement,      // --
+        Ampersand,      // &
+        Pipe,           // |
+        Caret,          // ^
+        ShiftLeft,      // <<
+        ShiftRight,     // >>
+        AmpersandAssign,    // &=
+        PipeAssign,         // |=
+        CaretAssign,        // ^=
+        ShiftLeftAssign,    // <<=
+        ShiftRightAssign,   // >>=
+
+        // Keywords (keep If first and Null last, SymbolTable::isKeyword relies on the range)
+        If,
+        Else,
+        While,
+        For,
+        Break,
+        Continue,
+        Return,
+        Class,
+        Switch,
+        Case,
+        Import,
+        True,
+        False,
+        Null,
+    };
+    // Number of token kinds, for tables indexed by kind.
+    inline constexpr std::size_t tokenKindCount = static_cast<std::size_t>(TokenKind::Null) + 1;
+
+    // A token is a view into the source buffer plus its kind and, for literals, the parsed value.
+    // Tokens never own text: the buffer passed to the lexer must outlive every token made from it.
+    struct Token {
+        std::string_view text; // The exact characters of the token (strings keep their quotes)
+        uint32_t offset;       // Byte offset of the token in the source buffer
+        TokenKind kind;
+        union {
+            int64_t integer;   // TokenKind::Int
+            Symbols::SymbolId symbol; // TokenKind::Identifier
+            double real;       // TokenKind::Double
+        };
+
+        Token() : Token(TokenKind::Unknown, std::string_view(), 0) {}
+        Token(TokenKind k, std::string_view t, uint32_t o) : text(t), offset(o), kind(k), integer(0) {}
+
+        uint32_t length() const {
+            return static_cast<uint32_t>(text.size());
+        }
+        bool is(TokenKind k) const {
+            return kind == k;
+        }
+        // The contents of a string literal without its surrounding quotes.
+        std::string_view stringValue() const {
+            return text.substr(1, text.size() - 2);
+        }
+    };
+
+    using TokenList = std::vector<Token>;
+    using Iterator = TokenList::const_iterator;
+
+    // The result of lexing a source buffer. The source view is kept so tokens can be mapped back to lines.
+    class TokenStream {
+        public:
+            std::string_view source;
+            TokenList tokens;
+            // Keeps the source buffer alive when the stream owns it (e.g. a mapped file). Empty when the caller owns the source.
+            std::shared_ptr<const void> storage;
+
+            TokenStream() {}
+            TokenStream(std::string_view src) : source(src) {}
+
+            Iterator begin() const {
+                return tokens.begin();
+            }
+            Iterator end() const {
+                return tokens.end();
+            }
+            std::size_t size() const {
+                return tokens.size();
+            }
+            // The token texts as strings, mainly for tests and debugging.
+            std::vector<std::string> toStrings() const;
+    };
+
+    const char* kindName(TokenKind kind);
+}
+
+#endif // TOKEN_DEF
@@ -0,0 +1,29 @@
+#ifndef TOKENIZER_DEF
+#define TOKENIZER_DEF
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Token.h"
+#include "SourceLoader.h"
+
+class Tokenizer {
+    public:
+        // Legacy tokenizer. Returns every token as its own string (numbers like 10.5 are split into "10", ".", "5").
+        static std::vector<std::string> process(const std::string input);
+        // Zero-copy lexer. Tokens reference `input`, which must stay alive as long as the returned stream.
+        static Tokens::TokenStream lex(std::string_view input);
+        // Maps the file read-only and lexes it in chunks of `chunkSize` bytes. The stream keeps the mapping alive.
+        static Tokens::TokenStream lexFile(const std::string& path, std::size_t chunkSize = Sources::defaultChunkSize);
+        // Lexes stream.source[from, to) and appends the tokens to the stream.
+        // Unless `final` is set, a token that might continue past `to` is not emitted; lexing stops at its first byte,
+        // and that offset is returned so the next chunk can start there. Returns `to` when the whole range was consumed.
+        static std::size_t lexChunk(Tokens::TokenStream& stream, std::size_t from, std::size_t to, bool final);
+        // Splits the input at newlines outside strings and comments and lexes the parts on the shared thread pool.
+        // The result is identical to lex(input). Inputs smaller than two chunks are lexed on the calling thread.
+        static Tokens::TokenStream lexParallel(std::string_view input, unsigned threads = 0, std::size_t minChunkSize = 1024 * 1024);
+        // Offsets (after a newline) where the lexer is in its initial state, at or after each multiple of size / parts.
+        // The first offset is always 0 and the last is always input.size().
+        static std::vector<std::size_t> splitPoints(std::string_view input, std::size_t parts);
+};
+
+#endif // TOKENIZER_DEF
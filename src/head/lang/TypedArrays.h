@@ -0,0 +1,29 @@
+#ifndef TYPED_ARRAYS_DEF
+#define TYPED_ARRAYS_DEF
+#include "Processor.h"
+
+// Bulk operations on typed arrays, for particle and physics buffers.
+// The element-wise operations change the first array in place, copying it first if it is shared. Arrays that are
+// combined must have the same kind and length, and scalars are converted to the element kind. Int arithmetic wraps
+// like the script operators do. With GCC and Clang the loops run on SIMD vectors, so float sums and dot
+// products add in lanes and can differ in the last bits from a left to right loop.
+namespace TypedArrays {
+    // target[i] += other[i]
+    void add(DataTypes::Data& target, const DataTypes::Data& other);
+    // target[i] *= other[i]
+    void multiply(DataTypes::Data& target, const DataTypes::Data& other);
+    // target[i] += left[i] * right[i]
+    void fma(DataTypes::Data& target, const DataTypes::Data& left, const DataTypes::Data& right);
+    // target[i] *= factor
+    void scale(DataTypes::Data& target, const DataTypes::Data& factor);
+    // target[i] = min(max(target[i], low), high)
+    void clamp(DataTypes::Data& target, const DataTypes::Data& low, const DataTypes::Data& high);
+
+    DataTypes::Data sum(const DataTypes::Data& array);
+    // Throw for an empty array.
+    DataTypes::Data min(const DataTypes::Data& array);
+    DataTypes::Data max(const DataTypes::Data& array);
+    DataTypes::Data dot(const DataTypes::Data& left, const DataTypes::Data& right);
+}
+
+#endif // TYPED_ARRAYS_DEF
@@ -0,0 +1,37 @@
+#ifndef SCANNER_DEF
+#define SCANNER_DEF
+
+// Vectorized scanning primitives for the lexer.
+// Each function starts at `p` and returns the first position in [p, end) that stops the scan (or `end`).
+// The implementation is picked once at runtime: AVX2 (32 bytes per step) and SSE2 (16 bytes per step)
+// on x86-64, and a scalar fallback everywhere else.
+namespace Scanner {
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // First character that is not whitespace (space, \t, \n, \v, \f, \r).
+    const char* skipWhitespace(const char* p, const char* end);
+    // First character that is not part of an identifier ([A-Za-z0-9_]).
+    const char* scanIdentifier(const char* p, const char* end);
+    // First character that is not a decimal digit.
+    const char* scanDigits(const char* p, const char* end);
+    // First occurrence of `c`, used for closing quotes and line ends.
+    const char* findChar(const char* p, const char* end, char c);
+    // First occurrence of either `a` or `b`.
+    const char* findEither(const char* p, const char* end, char a, char b);
+    // Start of the first "*/", used to skip multiline comment bodies.
+    const char* findCommentEnd(const char* p, const char* end);
+
+    // The level chosen from the CPU features.
+    Level detectedLevel();
+    // The level currently in use.
+    Level activeLevel();
+    // Forces a level, clamped to what the CPU supports. Used by tests and benchmarks to compare implementations.
+    void setLevel(Level level);
+    const char* levelName(Level level);
+}
+
+#endif // SCANNER_DEF
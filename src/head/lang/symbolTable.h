@@ -0,0 +1,156 @@
+#ifndef SYMBOL_TABLE_DEF
+#define SYMBOL_TABLE_DEF
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "Token.h"
+
+// Compile-time perfect hash of every operator, combined symbol and keyword in the language.
+// The tokenizer uses it to classify symbols and keywords, and the parser uses the resulting kinds,
+// so neither side compares strings. Adding an entry below is all that is needed; the seed is searched
+// for at compile time and the build fails if no collision-free seed exists.
+namespace SymbolTable {
+    struct Entry {
+        std::string_view text;
+        Tokens::TokenKind kind;
+    };
+
+    inline constexpr Entry entries[] = {
+        // Punctuation
+        {"(", Tokens::TokenKind::LeftParen},
+        {")", Tokens::TokenKind::RightParen},
+        {"{", Tokens::TokenKind::LeftBrace},
+        {"}", Tokens::TokenKind::RightBrace},
+        {"[", Tokens::TokenKind::LeftBracket},
+        {"]", Tokens::TokenKind::RightBracket},
+        {",", Tokens::TokenKind::Comma},
+        {":", Tokens::TokenKind::Colon},
+        {"::", Tokens::TokenKind::DoubleColon},
+        {";", Tokens::TokenKind::Semicolon},
+        {".", Tokens::TokenKind::Dot},
+
+        // Operators
+        {"+", Tokens::TokenKind::Plus},
+        {"-", Tokens::TokenKind::Minus},
+        {"*", Tokens::TokenKind::Star},
+        {"/", Tokens::TokenKind::Slash},
+        {"%", Tokens::TokenKind::Percent},
+        {"**", Tokens::TokenKind::Power},
+        {"!", Tokens::TokenKind::Bang},
+        {"~", Tokens::TokenKind::Tilde},
+        {"=", Tokens::TokenKind::Assign},
+        {"<", Tokens::TokenKind::Less},
+        {">", Tokens::TokenKind::Greater},
+        {"==", Tokens::TokenKind::Equal},
+        {"!=", Tokens::TokenKind::NotEqual},
+        {"<=", Tokens::TokenKind::LessEqual},
+        {">=", Tokens::TokenKind::GreaterEqual},
+        {"&&", Tokens::TokenKind::And},
+        {"||", Tokens::TokenKind::Or},
+        {"+=", Tokens::TokenKind::PlusAssign},
+        {"-=", Tokens::TokenKind::MinusAssign},
+        {"*=", Tokens::TokenKind::StarAssign},
+        {"/=", Tokens::TokenKind::SlashAssign},
+        {"%=", Tokens::TokenKind::PercentAssign},
+        {"++", Tokens::TokenKind::Increment},
+        {"--", Tokens::TokenKind::Decrement},
+        {"&", Tokens::TokenKind::Ampersand},
+        {"|", Tokens::TokenKind::Pipe},
+        {"^", Tokens::TokenKind::Caret},
+        {"<<", Tokens::TokenKind::ShiftLeft},
+        {">>", Tokens::TokenKind::ShiftRight},
+        {"&=", Tokens::TokenKind::AmpersandAssign},
+        {"|=", Tokens::TokenKind::PipeAssign},
+        {"^=", Tokens::TokenKind::CaretAssign},
+        {"<<=", Tokens::TokenKind::ShiftLeftAssign},
+        {">>=", Tokens::TokenKind::ShiftRightAssign},
+
+        // Keywords
+        {"if", Tokens::TokenKind::If},
+        {"else", Tokens::TokenKind::Else},
+        {"while", Tokens::TokenKind::While},
+        {"for", Tokens::TokenKind::For},
+        {"break", Tokens::TokenKind::Break},
+        {"continue", Tokens::TokenKind::Continue},
+        {"return", Tokens::TokenKind::Return},
+        {"class", Tokens::TokenKind::Class},
+        {"switch", Tokens::TokenKind::Switch},
+        {"case", Tokens::TokenKind::Case},
+        {"import", Tokens::TokenKind::Import},
+        {"true", Tokens::TokenKind::True},
+        {"false", Tokens::TokenKind::False},
+        {"null", Tokens::TokenKind::Null},
+    };
+    inline constexpr std::size_t entryCount = sizeof(entries) / sizeof(entries[0]);
+
+    // Longest text in the table. Anything longer can be rejected without hashing.
+    inline constexpr std::size_t maxLength = [] {
+        std::size_t longest = 0;
+        for (const Entry& entry : entries) {
+            longest = entry.text.size() > longest ? entry.text.size() : longest;
+        }
+        return longest;
+    }();
+
+    inline constexpr std::size_t tableSize = 256; // Must be a power of two
+    static_assert(entryCount < 255, "Slots store entry indices in a byte.");
+
+    constexpr uint32_t hash(std::string_view text, uint32_t seed) {
+        uint32_t h = seed ^ static_cast<uint32_t>(text.size());
+        for (char c : text) {
+            h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return (h ^ (h >> 15)) & (tableSize - 1);
+    }
+
+    // Finds the first seed for which no two entries share a slot.
+    constexpr uint32_t findSeed() {
+        for (uint32_t seed = 1; seed < 100000; seed++) {
+            bool used[tableSize] = {};
+            bool collision = false;
+            for (std::size_t i = 0; i < entryCount && !collision; i++) {
+                uint32_t slot = hash(entries[i].text, seed);
+                collision = used[slot];
+                used[slot] = true;
+            }
+            if (!collision) {
+                return seed;
+            }
+        }
+        return 0;
+    }
+    inline constexpr uint32_t seed = findSeed();
+    static_assert(seed != 0, "No perfect hash seed found for the symbol table; increase tableSize.");
+
+    // Slot -> entry index + 1 (0 means the slot is empty).
+    inline constexpr std::array<uint8_t, tableSize> slots = [] {
+        std::array<uint8_t, tableSize> table = {};
+        for (std::size_t i = 0; i < entryCount; i++) {
+            table[hash(entries[i].text, seed)] = static_cast<uint8_t>(i + 1);
+        }
+        return table;
+    }();
+
+    // Returns the kind of `text` if it is an operator, symbol or keyword, otherwise TokenKind::Unknown.
+    constexpr Tokens::TokenKind lookup(std::string_view text) {
+        if (text.empty() || text.size() > maxLength) {
+            return Tokens::TokenKind::Unknown;
+        }
+        uint8_t index = slots[hash(text, seed)];
+        if (index == 0 || entries[index - 1].text != text) {
+            return Tokens::TokenKind::Unknown;
+        }
+        return entries[index - 1].kind;
+    }
+
+    constexpr bool isKeyword(Tokens::TokenKind kind) {
+        return kind >= Tokens::TokenKind::If && kind <= Tokens::TokenKind::Null;
+    }
+
+    static_assert(lookup("<=") == Tokens::TokenKind::LessEqual);
+    static_assert(lookup("<<=") == Tokens::TokenKind::ShiftLeftAssign);
+    static_assert(lookup("while") == Tokens::TokenKind::While);
+    static_assert(lookup("whale") == Tokens::TokenKind::Unknown);
+}
+
+#endif // SYMBOL_TABLE_DEF
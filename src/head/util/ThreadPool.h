@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_DEF
+#define THREAD_POOL_DEF
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+// A fixed set of worker threads that run queued jobs.
+// The shared pool is created on first use with one worker per hardware thread.
+class ThreadPool {
+    public:
+        explicit ThreadPool(unsigned threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static ThreadPool& shared();
+
+        unsigned size() const {
+            return static_cast<unsigned>(workers.size());
+        }
+        void submit(std::function<void()> job);
+        // Runs job(0) .. job(count - 1) on the pool and blocks until all are done.
+        // At most `parallelism` jobs run at once (0 means the whole pool). The first exception thrown by a job is rethrown here.
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)>& job, unsigned parallelism = 0);
+
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable available;
+        bool stopping = false;
+
+        void work();
+};
+
+#endif // THREAD_POOL_DEF